@@ -37,7 +37,7 @@
 
 //#include "mbed.h"
 
-ADXL345::ADXL345(PinName sda, PinName scl) : i2c_(sda, scl) {
+ADXL345::ADXL345(PinName sda, PinName scl, int address) : i2c_(sda, scl), address_(address << 1) {
 
     //400kHz, allowing us to use the fastest data rates.
     //there are other chips on board, sorry
@@ -48,7 +48,7 @@ ADXL345::ADXL345(PinName sda, PinName scl) : i2c_(sda, scl) {
     tx[0] = ADXL345_BW_RATE_REG;
     //tx[1] = ADXL345_1600HZ; //value greater than or equal to 0x0A is written into the rate bits (Bit D3 through Bit D0) in the BW_RATE register 
     tx[1] = ADXL345_400HZ;
-    i2c_.write( ADXL345_WRITE , tx, 2);  
+    i2c_.write( address_ , tx, 2);  
 
     //Data format (for +-16g) - This is done by setting Bit D3 of the DATA_FORMAT register (Address 0x31) and writing a value of 0x03 to the range bits (Bit D1 and Bit D0) of the DATA_FORMAT register (Address 0x31).
    
@@ -56,7 +56,7 @@ ADXL345::ADXL345(PinName sda, PinName scl) : i2c_(sda, scl) {
     rx[0] = ADXL345_DATA_FORMAT_REG;
     // rx[1] = 0x0B; // full res and +-16g
     rx[1] = 0x08; // full res and +-2g
-    i2c_.write( ADXL345_WRITE , rx, 2); 
+    i2c_.write( address_ , rx, 2); 
  
     // Set Offset  - programmed into the OFSX, OFSY, and OFSZ registers, respectively, as 0xFD, 0x03 and 0xFE.
     // char x[2];
@@ -79,11 +79,17 @@ ADXL345::ADXL345(PinName sda, PinName scl) : i2c_(sda, scl) {
 }
 
 
+int ADXL345::getAddress(void) {
+
+    return address_;
+
+}
+
 char ADXL345::SingleByteRead(char address){   
     char tx = address;
     char output; 
-    i2c_.write( ADXL345_WRITE , &tx, 1);  //tell it what you want to read
-    i2c_.read( ADXL345_READ , &output, 1);    //tell it where to store the data
+    i2c_.write( address_ , &tx, 1);  //tell it what you want to read
+    i2c_.read( address_ | 0x01 , &output, 1);    //tell it where to store the data
     return output;  
 }
 
@@ -102,22 +108,22 @@ int ADXL345::SingleByteWrite(char address, char data){
    char tx[2];
    tx[0] = address;
    tx[1] = data;
-   return   ack | i2c_.write( ADXL345_WRITE , tx, 2);   
+   return   ack | i2c_.write( address_ , tx, 2);   
 }
 
 
 
 void ADXL345::multiByteRead(char address, char* output, int size) {
-    i2c_.write( ADXL345_WRITE, &address, 1);  //tell it where to read from
-    i2c_.read( ADXL345_READ , output, size);      //tell it where to store the data read
+    i2c_.write( address_, &address, 1);  //tell it where to read from
+    i2c_.read( address_ | 0x01 , output, size);      //tell it where to store the data read
 }
 
 
 int ADXL345::multiByteWrite(char address, char* ptr_data, int size) {
         int ack;
    
-               ack = i2c_.write( ADXL345_WRITE, &address, 1);  //tell it where to write to
-        return ack | i2c_.write( ADXL345_READ, ptr_data, size);  //tell it what data to write
+               ack = i2c_.write( address_, &address, 1);  //tell it where to write to
+        return ack | i2c_.write( address_, ptr_data, size);  //tell it what data to write
                                     
 }
 
@@ -134,6 +140,27 @@ void ADXL345::getOutput(int* readings){
 
 
 
+char ADXL345::getOutputWithSource(int* readings){
+    //INT_SOURCE, DATA_FORMAT, then the data registers.
+    char buffer[ADXL345_OUTPUT_WITH_SOURCE_SIZE];
+    multiByteRead(ADXL345_INT_SOURCE_REG, buffer, ADXL345_OUTPUT_WITH_SOURCE_SIZE);
+
+    return decodeOutputWithSource(buffer, readings);
+
+}
+
+char ADXL345::decodeOutputWithSource(const char* buffer, int* readings){
+
+    readings[0] = (int)buffer[3] << 8 | (int)buffer[2];
+    readings[1] = (int)buffer[5] << 8 | (int)buffer[4];
+    readings[2] = (int)buffer[7] << 8 | (int)buffer[6];
+
+    return buffer[0];
+
+}
+
+
+
 char ADXL345::getDeviceID() {  
     return SingleByteRead(ADXL345_DEVID_REG);
     }
@@ -77,6 +77,9 @@
 #define ADXL345_FIFO_CTL           0x38
 #define ADXL345_FIFO_STATUS        0x39
 
+//Bytes from INT_SOURCE through DATAZ1, see getOutputWithSource().
+#define ADXL345_OUTPUT_WITH_SOURCE_SIZE 8
+
 //Data rate codes.
 #define ADXL345_3200HZ      0x0F
 #define ADXL345_1600HZ      0x0E
@@ -95,11 +98,7 @@
  // The ADXL345 7-bit address is 0x53 when ALT ADDRESS is low as it is on the sparkfun chip. 
  // when ALT ADDRESS is high the address is 0x1D
 #define ADXL345_ADDRESS 0x53   
-
-/////////////when ALT ADDRESS pin is high:
-//#define ADXL345_READ    0x3B   
-//#define ADXL345_WRITE   0x3A
-//#define ADXL345_ADDRESS 0x1D 
+#define ADXL345_ALT_ADDRESS 0x1D
 
 #define ADXL345_X           0x00
 #define ADXL345_Y           0x01
@@ -125,8 +124,17 @@ public:
      *
      * @param mosi mbed pin to use for SDA line of I2C interface.
      * @param sck mbed pin to use for SCL line of I2C interface.
+     * @param address 7-bit address: ADXL345_ADDRESS, or ADXL345_ALT_ADDRESS
+     *        when the ALT ADDRESS pin is high.
+     */
+    ADXL345(PinName sda, PinName scl, int address = ADXL345_ADDRESS);
+
+    /**
+     * Get the address of the device.
+     *
+     * @return The 8-bit write address, as mbed's I2C takes it.
      */
-    ADXL345(PinName sda, PinName scl);
+    int getAddress(void);
 
     /**
      * Get the output of all three axes.
@@ -136,6 +144,33 @@ public:
      */
     void getOutput(int* readings);
 
+    /**
+     * Get the output of all three axes and the INT_SOURCE register in a
+     * single burst read.
+     *
+     * In bypass mode DATA_READY (0x80) is set if the output is new since
+     * the last read and Overrun (0x01) if an unread sample was replaced.
+     *
+     * @param Pointer to a buffer to hold the accelerometer value for the
+     *        x-axis, y-axis and z-axis [in that order].
+     *
+     * @return The contents of the INT_SOURCE register before the read.
+     */
+    char getOutputWithSource(int* readings);
+
+    /**
+     * Decode the burst read getOutputWithSource() makes, for the same read
+     * made without the driver, e.g. queued on a non-blocking bus.
+     *
+     * @param buffer ADXL345_OUTPUT_WITH_SOURCE_SIZE bytes read from
+     *        ADXL345_INT_SOURCE_REG on.
+     * @param Pointer to a buffer to hold the accelerometer value for the
+     *        x-axis, y-axis and z-axis [in that order].
+     *
+     * @return The contents of the INT_SOURCE register.
+     */
+    static char decodeOutputWithSource(const char* buffer, int* readings);
+
     /**
      * Read the device ID register on the device.
      *
@@ -517,6 +552,8 @@ public:
 private:
 
     I2C i2c_;
+    //8-bit write address; the read address has bit 0 set.
+    int address_;
     
 
     /**
@@ -0,0 +1,172 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Run-to-completion event scheduler with priorities and WFI idle.
+ */
+
+/**
+ * Includes
+ */
+#include "EventScheduler.h"
+#include "mbed.h"
+#include <string.h>
+
+EventScheduler::EventScheduler(EventClock eventClock) {
+
+    clock = eventClock;
+    count = 0;
+    pending = 0;
+    idleTime = 0;
+    idleSince = 0;
+
+}
+
+int EventScheduler::addEvent(EventHandler handler, uint8_t priority) {
+
+    if (count == EVENT_SCHEDULER_MAX_EVENTS) {
+        return -1;
+    }
+
+    Event& event = events[count];
+
+    memset(&event, 0, sizeof(event));
+    event.handler = handler;
+    event.statistics.priority = priority;
+
+    //Insert after every event of the same or higher priority.
+    int i = count;
+    while (i > 0 && events[order[i - 1]].statistics.priority < priority) {
+        order[i] = order[i - 1];
+        i--;
+    }
+    order[i] = (uint8_t) count;
+
+    return count++;
+
+}
+
+void EventScheduler::post(int event) {
+
+    Event& e = events[event];
+    uint32_t bit = 1UL << event;
+
+    __disable_irq();
+    e.statistics.posted++;
+    if (pending & bit) {
+        e.statistics.coalesced++;
+    } else {
+        pending |= bit;
+        e.postedAt = clock();
+    }
+    __enable_irq();
+
+}
+
+bool EventScheduler::dispatch(void) {
+
+    uint32_t ready = pending;
+
+    if (ready == 0) {
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int event = order[i];
+        uint32_t bit = 1UL << event;
+
+        if (ready & bit) {
+            Event& e = events[event];
+
+            __disable_irq();
+            pending &= ~bit;
+            uint32_t latency = clock() - e.postedAt;
+            e.statistics.dispatched++;
+            if (latency > e.statistics.maxLatency) {
+                e.statistics.maxLatency = latency;
+            }
+            __enable_irq();
+
+            e.handler();
+            return true;
+        }
+    }
+
+    return false;
+
+}
+
+void EventScheduler::idle(void) {
+
+    //A post after the check is held off until the core is asleep, and
+    //then wakes it.
+    __disable_irq();
+    if (pending == 0) {
+        uint32_t start = clock();
+        __WFI();
+        idleTime += clock() - start;
+    }
+    __enable_irq();
+
+}
+
+void EventScheduler::run(void) {
+
+    while (1) {
+        if (!dispatch()) {
+            idle();
+        }
+    }
+
+}
+
+void EventScheduler::getIdle(uint32_t* idle, uint32_t* elapsed) {
+
+    uint32_t now = clock();
+
+    *idle = idleTime;
+    *elapsed = now - idleSince;
+    idleTime = 0;
+    idleSince = now;
+
+}
+
+bool EventScheduler::getStatistics(int event, EventStatistics* statistics) {
+
+    if (event < 0 || event >= count) {
+        return false;
+    }
+
+    __disable_irq();
+    *statistics = events[event].statistics;
+    events[event].statistics.maxLatency = 0;
+    __enable_irq();
+
+    return true;
+
+}
+
+int EventScheduler::getEvents(void) {
+
+    return count;
+
+}
@@ -0,0 +1,178 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Run-to-completion event scheduler with priorities and WFI idle.
+ *
+ * Interrupt handlers only capture data and post() an event; the handler
+ * registered for the event runs later in thread context, from run(). The
+ * pending event with the highest priority is dispatched first, and each
+ * handler runs to completion before the next is chosen, so handlers never
+ * preempt each other and need no locking between themselves. Interrupts
+ * stay enabled while a handler runs, so their latency is bounded by the
+ * short critical sections here and in the application, not by how long a
+ * handler takes.
+ *
+ * Posting an event that is already pending does not queue it twice; the
+ * post is counted as coalesced and the handler runs once, as a periodic
+ * handler that falls behind should catch up rather than run back to back.
+ *
+ * With nothing pending the core sleeps in __WFI() with interrupts masked,
+ * so a post between the check and the sleep still wakes it. The time spent
+ * asleep is measured against the elapsed time to give the idle fraction of
+ * the CPU. Each event also keeps how often it was posted, dispatched and
+ * coalesced and the longest time from post to dispatch.
+ *
+ * Usage:
+ *
+ *   EventScheduler events(uptimeMicroseconds);
+ *   int filterEvent = events.addEvent(filter, 2);
+ *   ...
+ *   void filterTick(void) {
+ *       events.post(filterEvent);
+ *   }
+ *   ...
+ *   events.run();
+ */
+
+#ifndef EVENT_SCHEDULER_H
+#define EVENT_SCHEDULER_H
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+
+/**
+ * Defines
+ */
+//Most events a scheduler can dispatch, at most 32 for the pending mask.
+#define EVENT_SCHEDULER_MAX_EVENTS 8
+
+//Handler for an event, run in thread context.
+typedef void (*EventHandler)(void);
+//Time source in microseconds, e.g. a running Timer's read_us().
+typedef uint32_t (*EventClock)(void);
+
+//Statistics of one event.
+struct EventStatistics {
+    uint8_t priority;
+    //Since start-up. Posts that found the event already pending are
+    //coalesced and not dispatched on their own.
+    uint32_t posted;
+    uint32_t dispatched;
+    uint32_t coalesced;
+    //Longest time from the first post to dispatch since the previous
+    //getStatistics(), in microseconds.
+    uint32_t maxLatency;
+};
+
+/**
+ * Priority event scheduler.
+ */
+class EventScheduler {
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param clock Time source for the latency and idle time.
+     */
+    EventScheduler(EventClock clock);
+
+    /**
+     * Register an event.
+     *
+     * @param handler Function to run when the event is dispatched.
+     * @param priority Higher runs first; events of equal priority run in
+     *        the order they were added.
+     *
+     * @return The event number, or -1 if there are already
+     *         EVENT_SCHEDULER_MAX_EVENTS events.
+     */
+    int addEvent(EventHandler handler, uint8_t priority);
+
+    /**
+     * Make an event pending. Safe to call from interrupt handlers; it
+     * masks interrupts briefly, so must not be called with them masked.
+     */
+    void post(int event);
+
+    /**
+     * Run the handler of the highest priority pending event.
+     *
+     * @return false if no event was pending.
+     */
+    bool dispatch(void);
+
+    /**
+     * Sleep until an interrupt if no event is pending.
+     */
+    void idle(void);
+
+    /**
+     * Dispatch events for ever, sleeping whenever none is pending.
+     */
+    void run(void);
+
+    /**
+     * Time spent asleep and time elapsed since the previous call, in
+     * microseconds.
+     */
+    void getIdle(uint32_t* idle, uint32_t* elapsed);
+
+    /**
+     * Copy an event's statistics and clear its maximum latency.
+     *
+     * @return false if there is no such event.
+     */
+    bool getStatistics(int event, EventStatistics* statistics);
+
+    /**
+     * Number of registered events.
+     */
+    int getEvents(void);
+
+private:
+
+    struct Event {
+        EventHandler handler;
+        //Time of the first post since the last dispatch.
+        uint32_t postedAt;
+        EventStatistics statistics;
+    };
+
+    EventClock clock;
+    Event events[EVENT_SCHEDULER_MAX_EVENTS];
+    //Event numbers from the highest priority down.
+    uint8_t order[EVENT_SCHEDULER_MAX_EVENTS];
+    int count;
+    //Bit per pending event, set by post() and cleared by dispatch().
+    volatile uint32_t pending;
+
+    uint32_t idleTime;
+    uint32_t idleSince;
+
+};
+
+#endif /* EVENT_SCHEDULER_H */
@@ -110,27 +110,23 @@ void HMC5843::setOpMode(int mode, int ConfigA, int ConfigB) {
 
 void HMC5843::readData(int* readings) {
 
-  
     char tx[1];
-    char rx[2];
-    
-    
+    char rx[HMC5843_DATA_SIZE];
+
     tx[0]=HMC5843_X_MSB;
-    i2c_->write(HMC5843_I2C_READ,tx,1);
-    i2c_->read(HMC5843_I2C_READ,rx,2);
+    i2c_->write(HMC5843_I2C_WRITE,tx,1);
+    i2c_->read(HMC5843_I2C_READ,rx,HMC5843_DATA_SIZE);
+
+    decodeData(rx, readings);
+
+}
+
+void HMC5843::decodeData(const char* rx, int* readings) {
+
     readings[0]= (int)rx[0]<<8|(int)rx[1];
+    readings[1]= (int)rx[2]<<8|(int)rx[3];
+    readings[2]= (int)rx[4]<<8|(int)rx[5];
 
-     
-    tx[0]=HMC5843_Y_MSB;
-    i2c_->write(HMC5843_I2C_READ,tx,1);
-    i2c_->read(HMC5843_I2C_READ,rx,2);
-    readings[1]= (int)rx[0]<<8|(int)rx[1];
-     
-    tx[0]=HMC5843_Z_MSB;
-    i2c_->write(HMC5843_I2C_READ,tx,1);
-    i2c_->read(HMC5843_I2C_READ,rx,2);
-    readings[2]= (int)rx[0]<<8|(int)rx[1];
-    
 }
 
 int HMC5843::getMx() {
@@ -108,6 +108,9 @@
 #define HMC5843_IDENT_B      0x0B
 #define HMC5843_IDENT_C      0x0C
 
+//Bytes from X_MSB through Z_LSB, see readData().
+#define HMC5843_DATA_SIZE    6
+
 
 
 /**
@@ -171,12 +174,23 @@ public:
     void write(int address, int data);
 
      /**
-     * Get the output of all three axes.
+     * Get the output of all three axes, in a single burst read; the
+     * register pointer moves on through the data registers by itself.
      *
      * @param Pointer to a buffer to hold the magnetics value for the
      *        x-axis, y-axis and z-axis [in that order].
      */
     void readData(int* readings);
+
+    /**
+     * Decode the burst read readData() makes, for the same read made
+     * without the driver, e.g. queued on a non-blocking bus.
+     *
+     * @param rx HMC5843_DATA_SIZE bytes read from HMC5843_X_MSB on.
+     * @param Pointer to a buffer to hold the magnetics value for the
+     *        x-axis, y-axis and z-axis [in that order].
+     */
+    static void decodeData(const char* rx, int* readings);
     
     /**
      * Get the output of X axis.
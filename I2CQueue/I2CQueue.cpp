@@ -0,0 +1,332 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * I2C bus with a non-blocking transaction queue.
+ */
+
+/**
+ * Includes
+ */
+#include "I2CQueue.h"
+#include <string.h>
+
+/**
+ * Defines
+ */
+#ifdef I2C_QUEUE_PERIPHERALS
+//I2CONSET and I2CONCLR bits.
+#define I2C_AA  0x04
+#define I2C_SI  0x08
+#define I2C_STO 0x10
+#define I2C_STA 0x20
+//The LPC408x header drops the I2 prefix of the register names.
+#ifdef TARGET_LPC4088
+#define I2C_CONSET(i2c) ((i2c)->CONSET)
+#define I2C_CONCLR(i2c) ((i2c)->CONCLR)
+#define I2C_STAT(i2c)   ((i2c)->STAT)
+#define I2C_DAT(i2c)    ((i2c)->DAT)
+#else
+#define I2C_CONSET(i2c) ((i2c)->I2CONSET)
+#define I2C_CONCLR(i2c) ((i2c)->I2CONCLR)
+#define I2C_STAT(i2c)   ((i2c)->I2STAT)
+#define I2C_DAT(i2c)    ((i2c)->I2DAT)
+#endif
+#endif
+
+//Transfers finish in an interrupt, rather than before start() returns.
+#if defined(I2C_QUEUE_PERIPHERALS) || defined(DEVICE_I2C_ASYNCH)
+#define I2C_QUEUE_ASYNCHRONOUS
+#endif
+
+//Compile time check that the queue depth is a power of two.
+typedef char I2CQueueDepthIsPowerOfTwo[((I2C_QUEUE_DEPTH & (I2C_QUEUE_DEPTH - 1)) == 0) ? 1 : -1];
+
+#ifdef I2C_QUEUE_PERIPHERALS
+I2CQueue* I2CQueue::queues[I2C_QUEUE_PERIPHERALS];
+#endif
+
+I2CQueue::I2CQueue(PinName sda, PinName scl, I2CClock i2cClock) : I2C(sda, scl) {
+
+    head = 0;
+    tail = 0;
+    clock = i2cClock;
+    began = 0;
+    //The clock may not be running yet, so the first window counts from 0.
+    sampled = 0;
+    memset(&statistics, 0, sizeof(statistics));
+
+#ifdef I2C_QUEUE_PERIPHERALS
+    index = 0;
+    reading = false;
+
+    uint32_t handler;
+    if (_i2c.i2c == LPC_I2C0) {
+        irq = I2C0_IRQn;
+        queues[0] = this;
+        handler = (uint32_t) (uintptr_t) &I2CQueue::interrupt0;
+    } else if (_i2c.i2c == LPC_I2C1) {
+        irq = I2C1_IRQn;
+        queues[1] = this;
+        handler = (uint32_t) (uintptr_t) &I2CQueue::interrupt1;
+    } else {
+        irq = I2C2_IRQn;
+        queues[2] = this;
+        handler = (uint32_t) (uintptr_t) &I2CQueue::interrupt2;
+    }
+    //Enabled only while a transaction runs, see start().
+    NVIC_DisableIRQ(irq);
+    NVIC_SetVector(irq, handler);
+#endif
+
+}
+
+bool I2CQueue::submit(I2CTransaction* transaction) {
+
+    bool accepted = false;
+
+    __disable_irq();
+    uint32_t waiting = head - tail;
+    if (transaction->queued || waiting == I2C_QUEUE_DEPTH) {
+        statistics.rejected++;
+    } else {
+        transaction->queued = true;
+        transaction->queuedAt = clock();
+        queue[head & (I2C_QUEUE_DEPTH - 1)] = transaction;
+        head = head + 1;
+        if (waiting + 1 > statistics.maxQueued) {
+            statistics.maxQueued = (uint8_t) (waiting + 1);
+        }
+        accepted = true;
+    }
+    __enable_irq();
+
+    //With the bus idle no completion is coming to start it, so start it
+    //here; anything submitted meanwhile queues behind.
+    if (accepted && waiting == 0) {
+#ifdef I2C_QUEUE_ASYNCHRONOUS
+        start();
+#else
+        //Blocking transfers: run this one and whatever queued behind it.
+        while (tail != head) {
+            start();
+        }
+#endif
+    }
+
+    return accepted;
+
+}
+
+bool I2CQueue::idle(void) {
+
+    return head == tail;
+
+}
+
+void I2CQueue::getStatistics(I2CQueueStatistics* taken) {
+
+    uint32_t now = clock();
+
+    *taken = statistics;
+    taken->elapsed = now - sampled;
+
+    sampled = now;
+    statistics.maxQueued = 0;
+    statistics.maxWait = 0;
+    statistics.maxDuration = 0;
+    statistics.busy = 0;
+
+}
+
+void I2CQueue::start(void) {
+
+    I2CTransaction* transaction = queue[tail & (I2C_QUEUE_DEPTH - 1)];
+
+    began = clock();
+    uint32_t wait = began - transaction->queuedAt;
+    if (wait > statistics.maxWait) {
+        statistics.maxWait = wait;
+    }
+
+#ifdef I2C_QUEUE_PERIPHERALS
+    index = 0;
+    reading = transaction->txLength == 0;
+    //A start after a stop that is still going out follows it on the bus.
+    NVIC_EnableIRQ(irq);
+    I2C_CONSET(_i2c.i2c) = I2C_STA;
+#elif defined(DEVICE_I2C_ASYNCH)
+    if (transfer(transaction->address, transaction->tx, transaction->txLength, transaction->rx, transaction->rxLength,
+                 event_callback_t(this, &I2CQueue::transferred), I2C_EVENT_ALL) != 0) {
+        complete(1);
+    }
+#else
+    int status = 0;
+    if (transaction->txLength > 0) {
+        status = write(transaction->address, transaction->tx, transaction->txLength, transaction->rxLength > 0);
+    }
+    if (status == 0 && transaction->rxLength > 0) {
+        status = read(transaction->address, transaction->rx, transaction->rxLength);
+    }
+    complete(status);
+#endif
+
+}
+
+void I2CQueue::complete(int status) {
+
+    I2CTransaction* transaction = queue[tail & (I2C_QUEUE_DEPTH - 1)];
+    uint32_t duration = clock() - began;
+
+    statistics.transactions++;
+    if (status != 0) {
+        statistics.errors++;
+    }
+    if (duration > statistics.maxDuration) {
+        statistics.maxDuration = duration;
+    }
+    statistics.busy += duration;
+
+    transaction->status = status;
+
+    //Masked so a submit() from a higher priority sees either the bus
+    //still running or idle, and starts it exactly once.
+    __disable_irq();
+    transaction->queued = false;
+    tail = tail + 1;
+#ifdef I2C_QUEUE_ASYNCHRONOUS
+    bool more = tail != head;
+#endif
+#ifdef I2C_QUEUE_PERIPHERALS
+    if (!more) {
+        NVIC_DisableIRQ(irq);
+    }
+#endif
+    __enable_irq();
+
+#ifdef I2C_QUEUE_ASYNCHRONOUS
+    //Keep the bus going while the completion runs.
+    if (more) {
+        start();
+    }
+#endif
+
+    transaction->done(transaction);
+
+}
+
+#ifdef I2C_QUEUE_PERIPHERALS
+void I2CQueue::interrupt(void) {
+
+    LPC_I2C_TypeDef* i2c = _i2c.i2c;
+    I2CTransaction* transaction = queue[tail & (I2C_QUEUE_DEPTH - 1)];
+    int status = 0;
+    bool done = false;
+
+    switch (I2C_STAT(i2c)) {
+        //Start or repeated start sent: address the device.
+        case 0x08:
+        case 0x10:
+            I2C_DAT(i2c) = reading ? (transaction->address | 0x01) : (transaction->address & 0xFE);
+            I2C_CONCLR(i2c) = I2C_STA;
+            break;
+        //Address for writing or a data byte acknowledged.
+        case 0x18:
+        case 0x28:
+            if (index < transaction->txLength) {
+                I2C_DAT(i2c) = transaction->tx[index++];
+            } else if (transaction->rxLength > 0) {
+                index = 0;
+                reading = true;
+                I2C_CONSET(i2c) = I2C_STA;
+            } else {
+                I2C_CONSET(i2c) = I2C_STO;
+                done = true;
+            }
+            break;
+        //Address for reading acknowledged: acknowledge every byte but the
+        //last, which tells the device to let go of the bus.
+        case 0x40:
+            if (transaction->rxLength > 1) {
+                I2C_CONSET(i2c) = I2C_AA;
+            } else {
+                I2C_CONCLR(i2c) = I2C_AA;
+            }
+            break;
+        case 0x50:
+            transaction->rx[index++] = (char) I2C_DAT(i2c);
+            if (index < transaction->rxLength - 1) {
+                I2C_CONSET(i2c) = I2C_AA;
+            } else {
+                I2C_CONCLR(i2c) = I2C_AA;
+            }
+            break;
+        //Last byte read.
+        case 0x58:
+            transaction->rx[index++] = (char) I2C_DAT(i2c);
+            I2C_CONSET(i2c) = I2C_STO;
+            done = true;
+            break;
+        //Arbitration lost; the peripheral has already let go of the bus.
+        case 0x38:
+            status = 1;
+            done = true;
+            break;
+        //Address or data not acknowledged, or a bus error.
+        default:
+            I2C_CONSET(i2c) = I2C_STO;
+            status = 1;
+            done = true;
+            break;
+    }
+    I2C_CONCLR(i2c) = I2C_SI;
+
+    if (done) {
+        complete(status);
+    }
+
+}
+
+void I2CQueue::interrupt0(void) {
+
+    queues[0]->interrupt();
+
+}
+
+void I2CQueue::interrupt1(void) {
+
+    queues[1]->interrupt();
+
+}
+
+void I2CQueue::interrupt2(void) {
+
+    queues[2]->interrupt();
+
+}
+#elif defined(DEVICE_I2C_ASYNCH)
+void I2CQueue::transferred(int event) {
+
+    complete((event & I2C_EVENT_TRANSFER_COMPLETE) ? 0 : 1);
+
+}
+#endif
@@ -0,0 +1,214 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * I2C bus with a non-blocking transaction queue.
+ *
+ * A transaction writes some bytes and then, after a repeated start, reads
+ * some: a register read is one transaction. Interrupt handlers submit()
+ * transactions and return at once; the bus runs them in order and calls
+ * each one's completion function from its own interrupt when the stop has
+ * gone out. Each peripheral has its own queue and interrupt, so sensors on
+ * different buses are read concurrently and a slow device only holds up
+ * the devices on its own bus.
+ *
+ * On the LPC1768/LPC4088 the transfer is driven from the I2C interrupt
+ * through the peripheral's state machine. Where mbed has asynchronous I2C
+ * (DEVICE_I2C_ASYNCH) it goes through I2C::transfer(); anywhere else
+ * submit() falls back to a blocking transfer and completes before
+ * returning.
+ *
+ * The I2C interrupt is only enabled while a transaction is running, so the
+ * drivers' blocking reads can still be used on the same bus while its
+ * queue is idle, e.g. for set-up and calibration. Completion functions run
+ * at the I2C interrupt's priority; leaving it at the default, the same as
+ * the Ticker's, a completion never preempts a sensor callback or the
+ * other way round.
+ *
+ * Each bus keeps its transaction, error and rejection counts, the most
+ * transactions it has had waiting, the longest wait and transfer time and
+ * how long it was busy.
+ *
+ * Usage:
+ *
+ *   I2CQueue bus(p28, p27, uptimeMicroseconds);
+ *   char reg = INT_STATUS;
+ *   char data[9];
+ *   I2CTransaction read = {ITG3200_I2C_ADDRESS << 1, &reg, 1, data, 9, readDone};
+ *   ...
+ *   void sampleTick(void) {
+ *       bus.submit(&read);
+ *   }
+ *   void readDone(I2CTransaction* transaction) {
+ *       if (transaction->status == 0) {
+ *           //Use data.
+ *       }
+ *   }
+ */
+
+#ifndef I2C_QUEUE_H
+#define I2C_QUEUE_H
+
+/**
+ * Includes
+ */
+#include "mbed.h"
+
+/**
+ * Defines
+ */
+//Transactions that can wait on one bus; must be a power of two.
+#ifndef I2C_QUEUE_DEPTH
+#define I2C_QUEUE_DEPTH 4
+#endif
+//Buses with an interrupt driven queue.
+#if defined(TARGET_LPC1768) || defined(TARGET_LPC4088)
+#define I2C_QUEUE_PERIPHERALS 3
+#endif
+
+struct I2CTransaction;
+
+//Called from the bus's interrupt when a transaction has finished.
+typedef void (*I2CCompletion)(I2CTransaction* transaction);
+//Time source in microseconds, e.g. a running Timer's read_us().
+typedef uint32_t (*I2CClock)(void);
+
+/**
+ * One write then read. The buffers must stay valid until it completes.
+ */
+struct I2CTransaction {
+    //8-bit write address, as for mbed's I2C.
+    int address;
+    //Bytes to write first, usually the register to read from.
+    const char* tx;
+    int txLength;
+    //Bytes to read after a repeated start; 0 for a plain write.
+    char* rx;
+    int rxLength;
+    I2CCompletion done;
+    //0 once completed, non-0 if the device did not acknowledge or the bus
+    //was lost.
+    volatile int status;
+    //Between submit() and completion; only the queue writes these.
+    volatile bool queued;
+    uint32_t queuedAt;
+};
+
+//Statistics of one bus.
+struct I2CQueueStatistics {
+    //Since start-up.
+    uint32_t transactions;
+    uint32_t errors;
+    //Submitted to a full queue, or while still queued from before.
+    uint32_t rejected;
+    //The rest since the previous getStatistics(). Most transactions
+    //waiting at once, the running one included.
+    uint8_t maxQueued;
+    //Longest time from submit() to the start, and from the start to
+    //completion, in microseconds.
+    uint32_t maxWait;
+    uint32_t maxDuration;
+    //Microseconds the bus was busy out of elapsed.
+    uint32_t busy;
+    uint32_t elapsed;
+};
+
+/**
+ * I2C bus with an interrupt driven transaction queue.
+ */
+class I2CQueue : public I2C {
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param sda Data pin.
+     * @param scl Clock pin.
+     * @param clock Time source for the statistics.
+     */
+    I2CQueue(PinName sda, PinName scl, I2CClock clock);
+
+    /**
+     * Queue a transaction, without waiting.
+     *
+     * Safe to call from interrupt handlers; it masks interrupts briefly, so
+     * must not be called with them masked.
+     *
+     * @param transaction The transaction; its done function is called when
+     *        it has finished.
+     *
+     * @return false if the queue was full or the transaction is still
+     *         queued from before; it is then not run.
+     */
+    bool submit(I2CTransaction* transaction);
+
+    /**
+     * Whether no transaction is running or waiting.
+     */
+    bool idle(void);
+
+    /**
+     * Take the statistics, clearing the maxima and the busy time. Call
+     * with interrupts masked, or at the bus interrupt's priority.
+     */
+    void getStatistics(I2CQueueStatistics* statistics);
+
+private:
+
+    //Start the transaction at the head of the queue.
+    void start(void);
+    //The running transaction has finished with the given status; start
+    //the next one.
+    void complete(int status);
+
+#ifdef I2C_QUEUE_PERIPHERALS
+    //Master state machine, on each change of I2C state.
+    void interrupt(void);
+    static void interrupt0(void);
+    static void interrupt1(void);
+    static void interrupt2(void);
+    static I2CQueue* queues[I2C_QUEUE_PERIPHERALS];
+
+    IRQn_Type irq;
+    //Next byte to write or read, and whether the read has begun.
+    int index;
+    bool reading;
+#elif defined(DEVICE_I2C_ASYNCH)
+    //I2C::transfer() event.
+    void transferred(int event);
+#endif
+
+    I2CTransaction* queue[I2C_QUEUE_DEPTH];
+    //Free running indices; the tail is the running transaction. Both are
+    //written with interrupts masked.
+    volatile uint32_t head;
+    volatile uint32_t tail;
+
+    I2CClock clock;
+    uint32_t began;
+    uint32_t sampled;
+    I2CQueueStatistics statistics;
+
+};
+
+#endif /* I2C_QUEUE_H */
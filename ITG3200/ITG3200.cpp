@@ -37,7 +37,7 @@
  */
 #include "ITG3200.h"
 
-ITG3200::ITG3200(PinName sda, PinName scl) : i2c_(sda, scl) {
+ITG3200::ITG3200(PinName sda, PinName scl, int address) : i2c_(sda, scl), address_(address << 1) {
 
     //100kHz, mode.
     i2c_.frequency(100000);
@@ -49,7 +49,13 @@ ITG3200::ITG3200(PinName sda, PinName scl) : i2c_(sda, scl) {
     //FS_SEL bits sit in bits 4 and 3 of DLPF_FS register.
     tx[1] = 0x03 << 3;
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, tx, 2);
+    i2c_.write(address_, tx, 2);
+
+}
+
+int ITG3200::getAddress(void) {
+
+    return address_;
 
 }
 
@@ -59,9 +65,9 @@ char ITG3200::getWhoAmI(void){
     char tx = WHO_AM_I_REG;
     char rx;
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, &tx, 1);
+    i2c_.write(address_, &tx, 1);
     
-    i2c_.read((ITG3200_I2C_ADDRESS << 1) | 0x01, &rx, 1);
+    i2c_.read(address_ | 0x01, &rx, 1);
     
     return rx;
 
@@ -73,7 +79,7 @@ void ITG3200::setWhoAmI(char address){
     tx[0] = WHO_AM_I_REG;
     tx[1] = address;
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, tx, 2);
+    i2c_.write(address_, tx, 2);
 
 }
 
@@ -82,9 +88,9 @@ char ITG3200::getSampleRateDivider(void){
     char tx = SMPLRT_DIV_REG;
     char rx;
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, &tx, 1);
+    i2c_.write(address_, &tx, 1);
     
-    i2c_.read((ITG3200_I2C_ADDRESS << 1) | 0x01, &rx, 1);
+    i2c_.read(address_ | 0x01, &rx, 1);
 
     return rx;
 
@@ -96,7 +102,7 @@ void ITG3200::setSampleRateDivider(char divider){
     tx[0] = SMPLRT_DIV_REG;
     tx[1] = divider;
 
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, tx, 2);
+    i2c_.write(address_, tx, 2);
 
 }
 
@@ -105,9 +111,9 @@ int ITG3200::getInternalSampleRate(void){
     char tx = DLPF_FS_REG;
     char rx;
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, &tx, 1);
+    i2c_.write(address_, &tx, 1);
     
-    i2c_.read((ITG3200_I2C_ADDRESS << 1) | 0x01, &rx, 1);
+    i2c_.read(address_ | 0x01, &rx, 1);
     
     //DLPF_CFG == 0 -> sample rate = 8kHz.
     if(rx == 0){
@@ -131,7 +137,7 @@ void ITG3200::setLpBandwidth(char bandwidth){
     //Bits 4,3 are required to be 0x03 for proper operation.
     tx[1] = bandwidth | (0x03 << 3);
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, tx, 2);
+    i2c_.write(address_, tx, 2);
 
 }
 
@@ -140,9 +146,9 @@ char ITG3200::getInterruptConfiguration(void){
     char tx = INT_CFG_REG;
     char rx;
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, &tx, 1);
+    i2c_.write(address_, &tx, 1);
     
-    i2c_.read((ITG3200_I2C_ADDRESS << 1) | 0x01, &rx, 1);
+    i2c_.read(address_ | 0x01, &rx, 1);
     
     return rx;
 
@@ -154,7 +160,7 @@ void ITG3200::setInterruptConfiguration(char config){
     tx[0] = INT_CFG_REG;
     tx[1] = config;
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, tx, 2);
+    i2c_.write(address_, tx, 2);
 
 }
 
@@ -163,9 +169,9 @@ bool ITG3200::isPllReady(void){
     char tx = INT_STATUS;
     char rx;
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, &tx, 1);
+    i2c_.write(address_, &tx, 1);
     
-    i2c_.read((ITG3200_I2C_ADDRESS << 1) | 0x01, &rx, 1);
+    i2c_.read(address_ | 0x01, &rx, 1);
     
     //ITG_RDY bit is bit 4 of INT_STATUS register.
     if(rx & 0x04){
@@ -182,9 +188,9 @@ bool ITG3200::isRawDataReady(void){
     char tx = INT_STATUS;
     char rx;
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, &tx, 1);
+    i2c_.write(address_, &tx, 1);
     
-    i2c_.read((ITG3200_I2C_ADDRESS << 1) | 0x01, &rx, 1);
+    i2c_.read(address_ | 0x01, &rx, 1);
     
     //RAW_DATA_RDY bit is bit 1 of INT_STATUS register.
     if(rx & 0x01){
@@ -201,9 +207,9 @@ float ITG3200::getTemperature(void){
     char tx = TEMP_OUT_H_REG;
     char rx[2];
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, &tx, 1);
+    i2c_.write(address_, &tx, 1);
     
-    i2c_.read((ITG3200_I2C_ADDRESS << 1) | 0x01, rx, 2);
+    i2c_.read(address_ | 0x01, rx, 2);
     
     int16_t temperature = ((int) rx[0] << 8) | ((int) rx[1]);
     //Offset = -35 degrees, 13200 counts. 280 counts/degrees C.
@@ -216,9 +222,9 @@ int ITG3200::getGyroX(void){
     char tx = GYRO_XOUT_H_REG;
     char rx[2];
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, &tx, 1);
+    i2c_.write(address_, &tx, 1);
     
-    i2c_.read((ITG3200_I2C_ADDRESS << 1) | 0x01, rx, 2);
+    i2c_.read(address_ | 0x01, rx, 2);
     
     int16_t output = ((int) rx[0] << 8) | ((int) rx[1]);
 
@@ -231,9 +237,9 @@ int ITG3200::getGyroY(void){
     char tx = GYRO_YOUT_H_REG;
     char rx[2];
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, &tx, 1);
+    i2c_.write(address_, &tx, 1);
     
-    i2c_.read((ITG3200_I2C_ADDRESS << 1) | 0x01, rx, 2);
+    i2c_.read(address_ | 0x01, rx, 2);
     
     int16_t output = ((int) rx[0] << 8) | ((int) rx[1]);
 
@@ -246,9 +252,9 @@ int ITG3200::getGyroZ(void){
     char tx = GYRO_ZOUT_H_REG;
     char rx[2];
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, &tx, 1);
+    i2c_.write(address_, &tx, 1);
     
-    i2c_.read((ITG3200_I2C_ADDRESS << 1) | 0x01, rx, 2);
+    i2c_.read(address_ | 0x01, rx, 2);
     
     int16_t output = ((int) rx[0] << 8) | ((int) rx[1]);
 
@@ -256,14 +262,38 @@ int ITG3200::getGyroZ(void){
     
 }
 
+char ITG3200::getGyroOutput(int* readings){
+
+    //INT_STATUS, the temperature, then the gyroscope outputs.
+    char tx = INT_STATUS;
+    char rx[ITG3200_GYRO_OUTPUT_SIZE];
+
+    i2c_.write(address_, &tx, 1);
+
+    i2c_.read(address_ | 0x01, rx, ITG3200_GYRO_OUTPUT_SIZE);
+
+    return decodeGyroOutput(rx, readings);
+
+}
+
+char ITG3200::decodeGyroOutput(const char* rx, int* readings){
+
+    readings[0] = (int16_t) (((int) rx[3] << 8) | ((int) rx[4]));
+    readings[1] = (int16_t) (((int) rx[5] << 8) | ((int) rx[6]));
+    readings[2] = (int16_t) (((int) rx[7] << 8) | ((int) rx[8]));
+
+    return rx[0];
+
+}
+
 char ITG3200::getPowerManagement(void){
 
     char tx = PWR_MGM_REG;
     char rx;
     
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, &tx, 1);
+    i2c_.write(address_, &tx, 1);
     
-    i2c_.read((ITG3200_I2C_ADDRESS << 1) | 0x01, &rx, 1);
+    i2c_.read(address_ | 0x01, &rx, 1);
     
     return rx;
 
@@ -275,6 +305,6 @@ void ITG3200::setPowerManagement(char config){
     tx[0] = PWR_MGM_REG;
     tx[1] = config;
 
-    i2c_.write((ITG3200_I2C_ADDRESS << 1) & 0xFE, tx, 2);
+    i2c_.write(address_, tx, 2);
 
 }
@@ -44,7 +44,8 @@
 /**
  * Defines
  */
-#define ITG3200_I2C_ADDRESS 0x68 //7-bit address.
+#define ITG3200_I2C_ADDRESS 0x68 //7-bit address, AD0 low.
+#define ITG3200_I2C_ALT_ADDRESS 0x69 //7-bit address, AD0 high.
 
 //-----------
 // Registers
@@ -64,6 +65,9 @@
 #define GYRO_ZOUT_L_REG 0x22
 #define PWR_MGM_REG     0x3E
 
+//Bytes from INT_STATUS through GYRO_ZOUT_L, see getGyroOutput().
+#define ITG3200_GYRO_OUTPUT_SIZE 9
+
 //----------------------------
 // Low Pass Filter Bandwidths
 //----------------------------
@@ -89,8 +93,17 @@ public:
      *
      * @param sda - mbed pin to use for the SDA I2C line.
      * @param scl - mbed pin to use for the SCL I2C line.
+     * @param address - 7-bit address: ITG3200_I2C_ADDRESS, or
+     *        ITG3200_I2C_ALT_ADDRESS when AD0 is high.
+     */
+    ITG3200(PinName sda, PinName scl, int address = ITG3200_I2C_ADDRESS);
+
+    /**
+     * Get the address of the device.
+     *
+     * @return The 8-bit write address, as mbed's I2C takes it.
      */
-    ITG3200(PinName sda, PinName scl);
+    int getAddress(void);
 
     /**
      * Get the identity of the device.
@@ -257,6 +270,30 @@ public:
      */
     int getGyroZ(void);
 
+    /**
+     * Get the output of all three gyroscope axes and the INT_STATUS
+     * register in a single burst read, instead of a transfer per axis.
+     *
+     * @param readings Pointer to a buffer to hold the x, y and z outputs
+     *        in raw ADC counts.
+     *
+     * @return The contents of the INT_STATUS register before the read;
+     *         RAW_DATA_RDY (0x01) is set if the outputs are new.
+     */
+    char getGyroOutput(int* readings);
+
+    /**
+     * Decode the burst read getGyroOutput() makes, for the same read made
+     * without the driver, e.g. queued on a non-blocking bus.
+     *
+     * @param rx ITG3200_GYRO_OUTPUT_SIZE bytes read from INT_STATUS on.
+     * @param readings Pointer to a buffer to hold the x, y and z outputs
+     *        in raw ADC counts.
+     *
+     * @return The contents of the INT_STATUS register.
+     */
+    static char decodeGyroOutput(const char* rx, int* readings);
+
     /**
      * Get the power management configuration.
      *
@@ -334,6 +371,8 @@ public:
 private:
 
     I2C i2c_;
+    //8-bit write address; the read address has bit 0 set.
+    int address_;
 
 };
 
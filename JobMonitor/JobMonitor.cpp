@@ -0,0 +1,172 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Deadline and overrun monitor for periodic jobs.
+ */
+
+/**
+ * Includes
+ */
+#include "JobMonitor.h"
+#include <string.h>
+
+JobMonitor::JobMonitor(JobClock jobClock) {
+
+    clock = jobClock;
+    count = 0;
+
+}
+
+int JobMonitor::addJob(uint32_t period, uint32_t samplePeriod) {
+
+    if (count == JOB_MONITOR_MAX_JOBS) {
+        return -1;
+    }
+
+    Job& job = jobs[count];
+
+    memset(&job, 0, sizeof(job));
+    job.period = period > 0 ? period : 1;
+    job.samplePeriod = samplePeriod;
+    job.statistics.period = job.period;
+    job.due = clock();
+
+    return count++;
+
+}
+
+void JobMonitor::start(int job) {
+
+    Job& j = jobs[job];
+    uint32_t now = clock();
+
+    if (j.running) {
+        //Started again before finishing, from a higher priority.
+        j.statistics.overruns++;
+    }
+
+    j.due += j.period;
+
+    //Early runs count as on time.
+    int32_t late = (int32_t) (now - j.due);
+    uint32_t lateness = late > 0 ? (uint32_t) late : 0;
+
+    //A whole period late: those runs never happened.
+    if (lateness >= j.period) {
+        uint32_t missed = lateness / j.period;
+        j.statistics.skipped += missed;
+        j.due += missed * j.period;
+        lateness -= missed * j.period;
+    }
+
+    int bin = 31 - __builtin_clz(lateness | 1);
+    if (bin >= JOB_MONITOR_BINS) {
+        bin = JOB_MONITOR_BINS - 1;
+    }
+    if (j.statistics.lateness[bin] != 0xFFFF) {
+        j.statistics.lateness[bin]++;
+    }
+    if (lateness > j.statistics.maxLateness) {
+        j.statistics.maxLateness = lateness;
+    }
+
+    j.statistics.runs++;
+    j.began = now;
+    j.running = true;
+
+}
+
+void JobMonitor::finish(int job) {
+
+    Job& j = jobs[job];
+    uint32_t now = clock();
+    uint32_t duration = now - j.began;
+
+    if (duration > j.statistics.maxDuration) {
+        j.statistics.maxDuration = duration;
+    }
+    //Still running when the next run was due.
+    if ((int32_t) (now - (j.due + j.period)) > 0) {
+        j.statistics.overruns++;
+    }
+
+    j.running = false;
+
+}
+
+void JobMonitor::sample(int job, int status) {
+
+    Job& j = jobs[job];
+    uint32_t now = clock();
+    uint32_t interval = now - j.readAt;
+
+    j.readAt = now;
+    if (!j.sampled) {
+        j.sampled = true;
+        return;
+    }
+
+    if (status == JOB_SAMPLE_STALE || (status == JOB_SAMPLE_UNKNOWN && interval < j.samplePeriod / 2)) {
+        j.statistics.duplicates++;
+    } else {
+        j.fresh++;
+    }
+
+    if (j.samplePeriod > 0) {
+        j.elapsed += interval;
+        j.periods += j.elapsed / j.samplePeriod;
+        j.elapsed %= j.samplePeriod;
+        //One period of slack for reads jittering around the sensor's.
+        if (j.periods > j.fresh + 1 + j.statistics.lost) {
+            j.statistics.lost = j.periods - j.fresh - 1;
+        }
+    }
+
+}
+
+bool JobMonitor::getStatistics(int job, JobStatistics* statistics) {
+
+    if (job < 0 || job >= count) {
+        return false;
+    }
+
+    *statistics = jobs[job].statistics;
+    clearWindow(jobs[job]);
+
+    return true;
+
+}
+
+int JobMonitor::getJobs(void) {
+
+    return count;
+
+}
+
+void JobMonitor::clearWindow(Job& job) {
+
+    job.statistics.maxLateness = 0;
+    job.statistics.maxDuration = 0;
+    memset(job.statistics.lateness, 0, sizeof(job.statistics.lateness));
+
+}
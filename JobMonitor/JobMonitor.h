@@ -0,0 +1,195 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Deadline and overrun monitor for periodic jobs, e.g. Ticker callbacks.
+ *
+ * Each job is registered with its period when its Ticker is attached, so
+ * its first run is due one period later. A job calls start() when it
+ * begins and finish() when it ends; the monitor keeps the time each run
+ * was due and
+ * records how late every run started as a log2 histogram, the longest
+ * lateness and run time, the periods in which the job did not run at all
+ * and its overruns: runs still going when the next one was due.
+ *
+ * A job that reads a sensor also calls sample() for each reading, with
+ * what the sensor's status register said about it where it has one. A
+ * reading flagged as not new is a duplicate; without a flag, a reading
+ * less than half an output period after the previous one is. Lost
+ * samples are the sensor's output periods since the first reading that
+ * did not produce a new one, give or take one for the jitter of the reads.
+ * That assumes the sensor runs at its nominal rate: one running slow shows
+ * the difference as losses.
+ *
+ * Counters are kept from start-up; the histogram and the maxima are per
+ * window, cleared by getStatistics(). Nothing is masked, so a job's
+ * statistics must be taken at the priority it runs at, or with interrupts
+ * masked if it runs in one.
+ *
+ * Usage:
+ *
+ *   JobMonitor jobs(uptimeMicroseconds);
+ *   int gyroscopeJob = jobs.addJob(5000, 5000);
+ *   ...
+ *   void sampleGyroscope(void) {
+ *       jobs.start(gyroscopeJob);
+ *       //Read the gyroscope.
+ *       jobs.sample(gyroscopeJob, JOB_SAMPLE_NEW);
+ *       jobs.finish(gyroscopeJob);
+ *   }
+ */
+
+#ifndef JOB_MONITOR_H
+#define JOB_MONITOR_H
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+
+/**
+ * Defines
+ */
+//Most jobs a monitor can watch: enough for an array of four IMUs, with a
+//job per sensor of each, and three more.
+#define JOB_MONITOR_MAX_JOBS 12
+//Sensor status for JobMonitor::sample().
+#define JOB_SAMPLE_UNKNOWN 0 //No status, go by the time since the last.
+#define JOB_SAMPLE_NEW     1 //Flagged as new.
+#define JOB_SAMPLE_STALE   2 //Flagged as not new since the last read.
+
+//Lateness histogram bin i counts runs that started 2^i up to 2^(i + 1)
+//microseconds late; bin 0 also takes runs on time, the last bin
+//everything later.
+#define JOB_MONITOR_BINS 16
+
+/**
+ * Microseconds since start-up, wrapping at 2^32.
+ */
+typedef uint32_t (*JobClock)(void);
+
+/**
+ * What the monitor knows about a job.
+ */
+struct JobStatistics {
+    //Period in microseconds.
+    uint32_t period;
+    //Since start-up.
+    uint32_t runs;
+    //Periods in which the job did not start at all.
+    uint32_t skipped;
+    //Runs still going when the next one was due.
+    uint32_t overruns;
+    //Sensor readings repeated, and sensor samples never read.
+    uint32_t duplicates;
+    uint32_t lost;
+    //Since the previous getStatistics(), in microseconds.
+    uint32_t maxLateness;
+    uint32_t maxDuration;
+    uint16_t lateness[JOB_MONITOR_BINS];
+};
+
+/**
+ * Periodic job monitor.
+ */
+class JobMonitor {
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param clock Time source for the start and finish times.
+     */
+    JobMonitor(JobClock clock);
+
+    /**
+     * Register a job, due one period from now.
+     *
+     * @param period Time between runs, in microseconds.
+     * @param samplePeriod Output period of the sensor the job reads, in
+     *        microseconds, or 0 if it does not read one.
+     *
+     * @return The job number, or -1 if there are already
+     *         JOB_MONITOR_MAX_JOBS jobs.
+     */
+    int addJob(uint32_t period, uint32_t samplePeriod = 0);
+
+    /**
+     * A run of the job begins.
+     */
+    void start(int job);
+
+    /**
+     * The run of the job ends.
+     */
+    void finish(int job);
+
+    /**
+     * The running job read its sensor.
+     *
+     * @param status What the sensor flagged, JOB_SAMPLE_*.
+     */
+    void sample(int job, int status = JOB_SAMPLE_UNKNOWN);
+
+    /**
+     * Copy a job's statistics and start a new window.
+     *
+     * @return false if there is no such job.
+     */
+    bool getStatistics(int job, JobStatistics* statistics);
+
+    /**
+     * Number of registered jobs.
+     */
+    int getJobs(void);
+
+private:
+
+    struct Job {
+        uint32_t period;
+        uint32_t samplePeriod;
+        //Whether it is running and has read its sensor.
+        bool running;
+        bool sampled;
+        //When the current or last run was due and when it began.
+        uint32_t due;
+        uint32_t began;
+        //When the sensor was last read, the time since then that is not
+        //yet a whole output period, whole output periods and new readings
+        //since the first reading.
+        uint32_t readAt;
+        uint32_t elapsed;
+        uint32_t periods;
+        uint32_t fresh;
+        JobStatistics statistics;
+    };
+
+    void clearWindow(Job& job);
+
+    JobClock clock;
+    Job jobs[JOB_MONITOR_MAX_JOBS];
+    int count;
+
+};
+
+#endif /* JOB_MONITOR_H */
@@ -40,20 +40,6 @@
 
 MARGfilter::MARGfilter(double rate, double gyroscopeMeasurementError, double gyroscopeMeasurementDrift){
 
-    firstUpdate = 0;
-
-    //Quaternion orientation of earth frame relative to auxiliary frame.
-    AEq_1 = 1;
-    AEq_2 = 0;
-    AEq_3 = 0;
-    AEq_4 = 0;
-
-    //Estimated orientation quaternion elements with initial conditions.
-    SEq_1 = 1;
-    SEq_2 = 0;
-    SEq_3 = 0;
-    SEq_4 = 0;
-
     //Sampling period (typical value is ~0.1s).
     deltat = rate;
 
@@ -64,218 +50,359 @@ MARGfilter::MARGfilter(double rate, double gyroscopeMeasurementError, double gyr
     b_x = 1;
     b_z = 0;
 
-    w_bx = 0;
-    w_by = 0;
-    w_bz = 0;
+    w_b = Vec3<MARGreal>();
 
     //Compute beta.
     beta = sqrt(3.0 / 4.0) * (PI * (gyroMeasError / 180.0));
     zeta = sqrt(3.0 / 4.0) * (PI * (gyroMeasDrift / 180.0));
 
+    //Fixed gain until adaptive scheduling is enabled.
+    adaptive = 0;
+    betaInitial = beta;
+    betaDecay = 0;
+    annealing = 0;
+    betaEffective = beta;
+    gravityRef = 1;
+    fluxRef = 0;
+    dipRef = 0;
+
+}
+
+void MARGfilter::setAdaptiveGain(double initialGain, double annealingTime, double gravity) {
+
+    betaInitial = initialGain;
+    //Per-update decay of the extra gain, exp(-deltat / annealingTime).
+    betaDecay = exp(-deltat / annealingTime);
+    gravityRef = gravity;
+
+    //Start at the high gain and learn the magnetic references again.
+    annealing = 1;
+    fluxRef = 0;
+    dipRef = 0;
+
+    adaptive = 1;
+
+}
+
+void MARGfilter::setFixedGain(void) {
+
+    adaptive = 0;
+    betaEffective = beta;
+
+}
+
+double MARGfilter::getBeta(void) {
+
+    return betaEffective;
+
+}
+
+void MARGfilter::getGyroBias(double* bias) {
+
+    bias[0] = w_b.x;
+    bias[1] = w_b.y;
+    bias[2] = w_b.z;
+
+}
+
+void MARGfilter::getSnapshot(MARGsnapshot* snapshot) {
+
+    snapshot->SEq[0] = SEq.w;
+    snapshot->SEq[1] = SEq.x;
+    snapshot->SEq[2] = SEq.y;
+    snapshot->SEq[3] = SEq.z;
+    snapshot->AEq[0] = AEq.w;
+    snapshot->AEq[1] = AEq.x;
+    snapshot->AEq[2] = AEq.y;
+    snapshot->AEq[3] = AEq.z;
+    snapshot->w_b[0] = w_b.x;
+    snapshot->w_b[1] = w_b.y;
+    snapshot->w_b[2] = w_b.z;
+    snapshot->b_x = b_x;
+    snapshot->b_z = b_z;
+    snapshot->annealing = annealing;
+    snapshot->fluxRef = fluxRef;
+    snapshot->dipRef = dipRef;
+    snapshot->betaEffective = betaEffective;
+    snapshot->firstUpdate = firstUpdate;
+    snapshot->reserved = 0;
+
+}
+
+void MARGfilter::restoreSnapshot(const MARGsnapshot* snapshot) {
+
+    SEq = Quaternion<MARGreal>(snapshot->SEq[0], snapshot->SEq[1], snapshot->SEq[2], snapshot->SEq[3]);
+    AEq = Quaternion<MARGreal>(snapshot->AEq[0], snapshot->AEq[1], snapshot->AEq[2], snapshot->AEq[3]);
+    w_b = Vec3<MARGreal>(snapshot->w_b[0], snapshot->w_b[1], snapshot->w_b[2]);
+    b_x = snapshot->b_x;
+    b_z = snapshot->b_z;
+    annealing = snapshot->annealing;
+    fluxRef = snapshot->fluxRef;
+    dipRef = snapshot->dipRef;
+    betaEffective = snapshot->betaEffective;
+    firstUpdate = snapshot->firstUpdate;
+
 }
 
-void MARGfilter::updateFilter(double w_x, double w_y, double w_z, double a_x, double a_y, double a_z, double m_x, double m_y, double m_z) {
+RAMFUNC MARGreal MARGfilter::trust(MARGreal deviation, MARGreal tolerance, MARGreal reject) {
+
+    if (deviation <= tolerance) {
+        return 1;
+    }
+    if (deviation >= reject) {
+        return 0;
+    }
+    return (reject - deviation) / (reject - tolerance);
+
+}
+
+MARG_ALWAYS_INLINE void MARGfilter::step(State& state, const MARGreal* w_in, const MARGreal* a_in, const MARGreal* m_in) const {
 
     // local system variables
-    double norm; // vector norm
-    double SEqDot_omega_1, SEqDot_omega_2, SEqDot_omega_3, SEqDot_omega_4; // quaternion rate from gyroscopes elements
-    double f_1, f_2, f_3, f_4, f_5, f_6; // objective function elements
-    double J_11or24, J_12or23, J_13or22, J_14or21, J_32, J_33, // objective function Jacobian elements
+    Quaternion<MARGreal> q = state.q; // estimated orientation, kept in registers
+    Vec3<MARGreal> w(w_in[0], w_in[1], w_in[2]); // gyroscope measurement
+    Vec3<MARGreal> a(a_in[0], a_in[1], a_in[2]); // accelerometer measurement
+    Vec3<MARGreal> m(m_in[0], m_in[1], m_in[2]); // magnetometer measurement
+    Vec3<MARGreal> w_err; // estimated direction of the gyroscope error (angular)
+    Vec3<MARGreal> h; // computed flux in the earth frame
+    Quaternion<MARGreal> SEqHatDot; // estimated direction of the gyroscope error
+    MARGreal norm; // vector norm
+    MARGreal f_1, f_2, f_3, f_4, f_5, f_6; // objective function elements
+    MARGreal J_11or24, J_12or23, J_13or22, J_14or21, J_32, J_33, // objective function Jacobian elements
     J_41, J_42, J_43, J_44, J_51, J_52, J_53, J_54, J_61, J_62, J_63, J_64; //
-    double SEqHatDot_1, SEqHatDot_2, SEqHatDot_3, SEqHatDot_4; // estimated direction of the gyroscope error
-    double w_err_x, w_err_y, w_err_z; // estimated direction of the gyroscope error (angular)
-    double h_x, h_y, h_z; // computed flux in the earth frame
     // axulirary variables to avoid reapeated calcualtions
-    double halfSEq_1 = 0.5 * SEq_1;
-    double halfSEq_2 = 0.5 * SEq_2;
-    double halfSEq_3 = 0.5 * SEq_3;
-    double halfSEq_4 = 0.5 * SEq_4;
-    double twoSEq_1 = 2.0 * SEq_1;
-    double twoSEq_2 = 2.0 * SEq_2;
-    double twoSEq_3 = 2.0 * SEq_3;
-    double twoSEq_4 = 2.0 * SEq_4;
-    double twob_x = 2.0 * b_x;
-    double twob_z = 2.0 * b_z;
-    double twob_xSEq_1 = 2.0 * b_x * SEq_1;
-    double twob_xSEq_2 = 2.0 * b_x * SEq_2;
-    double twob_xSEq_3 = 2.0 * b_x * SEq_3;
-    double twob_xSEq_4 = 2.0 * b_x * SEq_4;
-    double twob_zSEq_1 = 2.0 * b_z * SEq_1;
-    double twob_zSEq_2 = 2.0* b_z * SEq_2;
-    double twob_zSEq_3 = 2.0 * b_z * SEq_3;
-    double twob_zSEq_4 = 2.0 * b_z * SEq_4;
-    double SEq_1SEq_2;
-    double SEq_1SEq_3 = SEq_1 * SEq_3;
-    double SEq_1SEq_4;
-    double SEq_2SEq_3;
-    double SEq_2SEq_4 = SEq_2 * SEq_4;
-    double SEq_3SEq_4;
-    double twom_x = 2.0 * m_x;
-    double twom_y = 2.0 * m_y;
-    double twom_z = 2.0 * m_z;
+    MARGreal twoSEq_1 = 2 * q.w;
+    MARGreal twoSEq_2 = 2 * q.x;
+    MARGreal twoSEq_3 = 2 * q.y;
+    MARGreal twoSEq_4 = 2 * q.z;
+    MARGreal twob_x = 2 * state.b_x;
+    MARGreal twob_z = 2 * state.b_z;
+    MARGreal twob_xSEq_1 = 2 * state.b_x * q.w;
+    MARGreal twob_xSEq_2 = 2 * state.b_x * q.x;
+    MARGreal twob_xSEq_3 = 2 * state.b_x * q.y;
+    MARGreal twob_xSEq_4 = 2 * state.b_x * q.z;
+    MARGreal twob_zSEq_1 = 2 * state.b_z * q.w;
+    MARGreal twob_zSEq_2 = 2 * state.b_z * q.x;
+    MARGreal twob_zSEq_3 = 2 * state.b_z * q.y;
+    MARGreal twob_zSEq_4 = 2 * state.b_z * q.z;
+    MARGreal SEq_1SEq_3 = q.w * q.y;
+    MARGreal SEq_2SEq_4 = q.x * q.z;
+    // measurement weights and effective gain for the adaptive mode
+    MARGreal w_a = 1;
+    MARGreal w_m = 1;
+    MARGreal gain = beta;
+    MARGreal cosDip;
     // normalise the accelerometer measurement
-    norm = sqrt(a_x * a_x + a_y * a_y + a_z * a_z);
-    a_x /= norm;
-    a_y /= norm;
-    a_z /= norm;
+    norm = a.norm();
+    if (adaptive) {
+        w_a = trust(std::fabs(norm - gravityRef) / gravityRef, MARG_ACCEL_TOLERANCE, MARG_ACCEL_REJECT);
+    }
+    if (w_a > 0) {
+        a = a / norm;
+    }
     // normalise the magnetometer measurement
-    norm = sqrt(m_x * m_x + m_y * m_y + m_z * m_z);
-    m_x /= norm;
-    m_y /= norm;
-    m_z /= norm;
+    norm = m.norm();
+    if (adaptive) {
+        if (norm == 0) {
+            w_m = 0;
+        } else {
+            m = m / norm;
+            // the dip angle only makes sense against a valid gravity vector
+            cosDip = a.dot(m);
+            if (state.fluxRef == 0 && w_a == 1) {
+                state.fluxRef = norm;
+                state.dipRef = cosDip;
+            }
+            if (state.fluxRef != 0) {
+                w_m = trust(std::fabs(norm - state.fluxRef) / state.fluxRef, MARG_MAG_TOLERANCE, MARG_MAG_REJECT);
+                if (w_a > 0) {
+                    MARGreal w_dip = trust(std::fabs(cosDip - state.dipRef), MARG_DIP_TOLERANCE, MARG_DIP_REJECT);
+                    if (w_dip < w_m) {
+                        w_m = w_dip;
+                    }
+                }
+                // follow slow changes of the local field while undisturbed
+                if (w_a == 1 && w_m == 1) {
+                    state.fluxRef += MARGreal(MARG_REFERENCE_RATE) * (norm - state.fluxRef);
+                    state.dipRef += MARGreal(MARG_REFERENCE_RATE) * (cosDip - state.dipRef);
+                }
+            }
+        }
+    } else {
+        m = m / norm;
+    }
     // compute the objective function and Jacobian
-    f_1 = twoSEq_2 * SEq_4 - twoSEq_1 * SEq_3 - a_x;
-    f_2 = twoSEq_1 * SEq_2 + twoSEq_3 * SEq_4 - a_y;
-    f_3 = 1.0 - twoSEq_2 * SEq_2 - twoSEq_3 * SEq_3 - a_z;
-    f_4 = twob_x * (0.5 - SEq_3 * SEq_3 - SEq_4 * SEq_4) + twob_z * (SEq_2SEq_4 - SEq_1SEq_3) - m_x;
-    f_5 = twob_x * (SEq_2 * SEq_3 - SEq_1 * SEq_4) + twob_z * (SEq_1 * SEq_2 + SEq_3 * SEq_4) - m_y;
-    f_6 = twob_x * (SEq_1SEq_3 + SEq_2SEq_4) + twob_z * (0.5 - SEq_2 * SEq_2 - SEq_3 * SEq_3) - m_z;
+    f_1 = twoSEq_2 * q.z - twoSEq_1 * q.y - a.x;
+    f_2 = twoSEq_1 * q.x + twoSEq_3 * q.z - a.y;
+    f_3 = 1 - twoSEq_2 * q.x - twoSEq_3 * q.y - a.z;
+    f_4 = twob_x * (MARGreal(0.5) - q.y * q.y - q.z * q.z) + twob_z * (SEq_2SEq_4 - SEq_1SEq_3) - m.x;
+    f_5 = twob_x * (q.x * q.y - q.w * q.z) + twob_z * (q.w * q.x + q.y * q.z) - m.y;
+    f_6 = twob_x * (SEq_1SEq_3 + SEq_2SEq_4) + twob_z * (MARGreal(0.5) - q.x * q.x - q.y * q.y) - m.z;
+    if (adaptive) {
+        // weight each sensor's part of the objective function by its trust
+        f_1 *= w_a;
+        f_2 *= w_a;
+        f_3 *= w_a;
+        f_4 *= w_m;
+        f_5 *= w_m;
+        f_6 *= w_m;
+    }
     J_11or24 = twoSEq_3; // J_11 negated in matrix multiplication
-    J_12or23 = 2.0 * SEq_4;
+    J_12or23 = twoSEq_4;
     J_13or22 = twoSEq_1; // J_12 negated in matrix multiplication
     J_14or21 = twoSEq_2;
-    J_32 = 2.0 * J_14or21; // negated in matrix multiplication
-    J_33 = 2.0 * J_11or24; // negated in matrix multiplication
+    J_32 = 2 * J_14or21; // negated in matrix multiplication
+    J_33 = 2 * J_11or24; // negated in matrix multiplication
     J_41 = twob_zSEq_3; // negated in matrix multiplication
     J_42 = twob_zSEq_4;
-    J_43 = 2.0 * twob_xSEq_3 + twob_zSEq_1; // negated in matrix multiplication
-    J_44 = 2.0 * twob_xSEq_4 - twob_zSEq_2; // negated in matrix multiplication
+    J_43 = 2 * twob_xSEq_3 + twob_zSEq_1; // negated in matrix multiplication
+    J_44 = 2 * twob_xSEq_4 - twob_zSEq_2; // negated in matrix multiplication
     J_51 = twob_xSEq_4 - twob_zSEq_2; // negated in matrix multiplication
     J_52 = twob_xSEq_3 + twob_zSEq_1;
     J_53 = twob_xSEq_2 + twob_zSEq_4;
     J_54 = twob_xSEq_1 - twob_zSEq_3; // negated in matrix multiplication
     J_61 = twob_xSEq_3;
-    J_62 = twob_xSEq_4 - 2.0 * twob_zSEq_2;
-    J_63 = twob_xSEq_1 - 2.0 * twob_zSEq_3;
+    J_62 = twob_xSEq_4 - 2 * twob_zSEq_2;
+    J_63 = twob_xSEq_1 - 2 * twob_zSEq_3;
     J_64 = twob_xSEq_2;
     // compute the gradient (matrix multiplication)
-    SEqHatDot_1 = J_14or21 * f_2 - J_11or24 * f_1 - J_41 * f_4 - J_51 * f_5 + J_61 * f_6;
-    SEqHatDot_2 = J_12or23 * f_1 + J_13or22 * f_2 - J_32 * f_3 + J_42 * f_4 + J_52 * f_5 + J_62 * f_6;
-    SEqHatDot_3 = J_12or23 * f_2 - J_33 * f_3 - J_13or22 * f_1 - J_43 * f_4 + J_53 * f_5 + J_63 * f_6;
-    SEqHatDot_4 = J_14or21 * f_1 + J_11or24 * f_2 - J_44 * f_4 - J_54 * f_5 + J_64 * f_6;
+    SEqHatDot.w = J_14or21 * f_2 - J_11or24 * f_1 - J_41 * f_4 - J_51 * f_5 + J_61 * f_6;
+    SEqHatDot.x = J_12or23 * f_1 + J_13or22 * f_2 - J_32 * f_3 + J_42 * f_4 + J_52 * f_5 + J_62 * f_6;
+    SEqHatDot.y = J_12or23 * f_2 - J_33 * f_3 - J_13or22 * f_1 - J_43 * f_4 + J_53 * f_5 + J_63 * f_6;
+    SEqHatDot.z = J_14or21 * f_1 + J_11or24 * f_2 - J_44 * f_4 - J_54 * f_5 + J_64 * f_6;
     // normalise the gradient to estimate direction of the gyroscope error
-    norm = sqrt(SEqHatDot_1 * SEqHatDot_1 + SEqHatDot_2 * SEqHatDot_2 + SEqHatDot_3 * SEqHatDot_3 + SEqHatDot_4 * SEqHatDot_4);
-    SEqHatDot_1 = SEqHatDot_1 / norm;
-    SEqHatDot_2 = SEqHatDot_2 / norm;
-    SEqHatDot_3 = SEqHatDot_3 / norm;
-    SEqHatDot_4 = SEqHatDot_4 / norm;
-    // compute angular estimated direction of the gyroscope error
-    w_err_x = twoSEq_1 * SEqHatDot_2 - twoSEq_2 * SEqHatDot_1 - twoSEq_3 * SEqHatDot_4 + twoSEq_4 * SEqHatDot_3;
-    w_err_y = twoSEq_1 * SEqHatDot_3 + twoSEq_2 * SEqHatDot_4 - twoSEq_3 * SEqHatDot_1 - twoSEq_4 * SEqHatDot_2;
-    w_err_z = twoSEq_1 * SEqHatDot_4 - twoSEq_2 * SEqHatDot_3 + twoSEq_3 * SEqHatDot_2 - twoSEq_4 * SEqHatDot_1;
+    norm = SEqHatDot.norm();
+    if (adaptive) {
+        // a large gradient against trusted measurements means a large
+        // error: re-arm the convergence gain
+        MARGreal boost = norm / MARGreal(MARG_GRADIENT_SCALE);
+        if (w_a == 1 && w_m == 1 && boost > state.annealing) {
+            state.annealing = (boost > 1) ? 1 : boost;
+        }
+        gain = (beta + (betaInitial - beta) * state.annealing) * ((w_a > w_m) ? w_a : w_m);
+        state.annealing *= betaDecay;
+    }
+    if (norm == 0) {
+        // an exact fit, or both measurements rejected: integrate the
+        // gyroscopes only
+        norm = 1;
+    }
+    state.gain = gain;
+    SEqHatDot = SEqHatDot / norm;
+    // compute angular estimated direction of the gyroscope error, 2 q* dq
+    w_err = (q.conjugate() * SEqHatDot).vec() * MARGreal(2);
     // compute and remove the gyroscope baises
-    w_bx += w_err_x * deltat * zeta;
-    w_by += w_err_y * deltat * zeta;
-    w_bz += w_err_z * deltat * zeta;
-    w_x -= w_bx;
-    w_y -= w_by;
-    w_z -= w_bz;
-    // compute the quaternion rate measured by gyroscopes
-    SEqDot_omega_1 = -halfSEq_2 * w_x - halfSEq_3 * w_y - halfSEq_4 * w_z;
-    SEqDot_omega_2 = halfSEq_1 * w_x + halfSEq_3 * w_z - halfSEq_4 * w_y;
-    SEqDot_omega_3 = halfSEq_1 * w_y - halfSEq_2 * w_z + halfSEq_4 * w_x;
-    SEqDot_omega_4 = halfSEq_1 * w_z + halfSEq_2 * w_y - halfSEq_3 * w_x;
+    state.w_b = state.w_b + w_err * deltat * zeta;
+    w = w - state.w_b;
     // compute then integrate the estimated quaternion rate
-    SEq_1 += (SEqDot_omega_1 - (beta * SEqHatDot_1)) * deltat;
-    SEq_2 += (SEqDot_omega_2 - (beta * SEqHatDot_2)) * deltat;
-    SEq_3 += (SEqDot_omega_3 - (beta * SEqHatDot_3)) * deltat;
-    SEq_4 += (SEqDot_omega_4 - (beta * SEqHatDot_4)) * deltat;
+    q = q + (q.derivative(w) - SEqHatDot * gain) * deltat;
     // normalise quaternion
-    norm = sqrt(SEq_1 * SEq_1 + SEq_2 * SEq_2 + SEq_3 * SEq_3 + SEq_4 * SEq_4);
-    SEq_1 /= norm;
-    SEq_2 /= norm;
-    SEq_3 /= norm;
-    SEq_4 /= norm;
-    // compute flux in the earth frame
-    SEq_1SEq_2 = SEq_1 * SEq_2; // recompute axulirary variables
-    SEq_1SEq_3 = SEq_1 * SEq_3;
-    SEq_1SEq_4 = SEq_1 * SEq_4;
-    SEq_3SEq_4 = SEq_3 * SEq_4;
-    SEq_2SEq_3 = SEq_2 * SEq_3;
-    SEq_2SEq_4 = SEq_2 * SEq_4;
-    h_x = twom_x * (0.5 - SEq_3 * SEq_3 - SEq_4 * SEq_4) + twom_y * (SEq_2SEq_3 - SEq_1SEq_4) + twom_z * (SEq_2SEq_4 + SEq_1SEq_3);
-    h_y = twom_x * (SEq_2SEq_3 + SEq_1SEq_4) + twom_y * (0.5 - SEq_2 * SEq_2 - SEq_4 * SEq_4) + twom_z * (SEq_3SEq_4 - SEq_1SEq_2);
-    h_z = twom_x * (SEq_2SEq_4 - SEq_1SEq_3) + twom_y * (SEq_3SEq_4 + SEq_1SEq_2) + twom_z * (0.5 - SEq_2 * SEq_2 - SEq_3 * SEq_3);
-    // normalise the flux vector to have only components in the x and z
-    b_x = sqrt((h_x * h_x) + (h_y * h_y));
-    b_z = h_z;
-
-    if (firstUpdate == 0) {
-        //Store orientation of auxiliary frame.
-        AEq_1 = SEq_1;
-        AEq_2 = SEq_2;
-        AEq_3 = SEq_3;
-        AEq_4 = SEq_4;
-        firstUpdate = 1;
+    q = q.normalized();
+    // keep the previous flux reference while the field is disturbed
+    if (w_m > 0) {
+        // compute flux in the earth frame
+        h = q.toEarth(m);
+        // normalise the flux vector to have only components in the x and z
+        state.b_x = std::sqrt((h.x * h.x) + (h.y * h.y));
+        state.b_z = h.z;
     }
+    state.q = q;
 
 }
 
-void MARGfilter::computeEuler(void){
+MARG_ALWAYS_INLINE void MARGfilter::load(State& state) const {
 
-    //Quaternion describing orientation of sensor relative to earth.
-    double ESq_1, ESq_2, ESq_3, ESq_4;
-    //Quaternion describing orientation of sensor relative to auxiliary frame.
-    double ASq_1, ASq_2, ASq_3, ASq_4;
+    state.q = SEq;
+    state.w_b = w_b;
+    state.b_x = b_x;
+    state.b_z = b_z;
+    state.annealing = annealing;
+    state.fluxRef = fluxRef;
+    state.dipRef = dipRef;
+    state.gain = betaEffective;
 
-    //Compute the quaternion conjugate.
-    ESq_1 = SEq_1;
-    ESq_2 = -SEq_2;
-    ESq_3 = -SEq_3;
-    ESq_4 = -SEq_4;
+}
 
-    //Compute the quaternion product.
-    ASq_1 = ESq_1 * AEq_1 - ESq_2 * AEq_2 - ESq_3 * AEq_3 - ESq_4 * AEq_4;
-    ASq_2 = ESq_1 * AEq_2 + ESq_2 * AEq_1 + ESq_3 * AEq_4 - ESq_4 * AEq_3;
-    ASq_3 = ESq_1 * AEq_3 - ESq_2 * AEq_4 + ESq_3 * AEq_1 + ESq_4 * AEq_2;
-    ASq_4 = ESq_1 * AEq_4 + ESq_2 * AEq_3 - ESq_3 * AEq_2 + ESq_4 * AEq_1;
+MARG_ALWAYS_INLINE void MARGfilter::store(const State& state) {
 
-    //Compute the Euler angles from the quaternion.
-    phi = atan2(2 * ASq_3 * ASq_4 - 2 * ASq_1 * ASq_2, 2 * ASq_1 * ASq_1 + 2 * ASq_4 * ASq_4 - 1);
-    theta = asin(2 * ASq_2 * ASq_3 - 2 * ASq_1 * ASq_3);
-    psi = atan2(2 * ASq_2 * ASq_3 - 2 * ASq_1 * ASq_4, 2 * ASq_1 * ASq_1 + 2 * ASq_2 * ASq_2 - 1);
+    SEq = state.q;
+    w_b = state.w_b;
+    b_x = state.b_x;
+    b_z = state.b_z;
+    annealing = state.annealing;
+    fluxRef = state.fluxRef;
+    dipRef = state.dipRef;
+    betaEffective = state.gain;
 
 }
 
-double MARGfilter::getRoll(void){
+RAMFUNC void MARGfilter::updateFilter(MARGreal w_x, MARGreal w_y, MARGreal w_z, MARGreal a_x, MARGreal a_y, MARGreal a_z, MARGreal m_x, MARGreal m_y, MARGreal m_z) {
 
-    return phi;
+    State state;
+    const MARGreal w[3] = {w_x, w_y, w_z};
+    const MARGreal a[3] = {a_x, a_y, a_z};
+    const MARGreal m[3] = {m_x, m_y, m_z};
 
-}
+    load(state);
+    step(state, w, a, m);
+    store(state);
 
-double MARGfilter::getPitch(void){
-
-    return theta;
+    //Store orientation of auxiliary frame.
+    storeAuxiliaryFrame();
 
 }
 
-double MARGfilter::getYaw(void){
+void MARGfilter::updateFilter(const OrientationSample* samples, size_t n, OrientationOutput* out, size_t decimation) {
 
-    return psi;
+    State state;
 
-}
+    if (n == 0) {
+        return;
+    }
+    if (decimation == 0) {
+        decimation = 1;
+    }
+    size_t countdown = decimation;
+
+    load(state);
+
+    for (size_t i = 0; i < n; i++) {
+        const OrientationSample& sample = samples[i];
+        const MARGreal w[3] = {MARGreal(sample.w[0]), MARGreal(sample.w[1]), MARGreal(sample.w[2])};
+        const MARGreal a[3] = {MARGreal(sample.a[0]), MARGreal(sample.a[1]), MARGreal(sample.a[2])};
+        const MARGreal m[3] = {MARGreal(sample.m[0]), MARGreal(sample.m[1]), MARGreal(sample.m[2])};
+        step(state, w, a, m);
+        if (out != 0 && --countdown == 0) {
+            out->q[0] = state.q.w;
+            out->q[1] = state.q.x;
+            out->q[2] = state.q.y;
+            out->q[3] = state.q.z;
+            out++;
+            countdown = decimation;
+        }
+        //The auxiliary frame is the orientation after the very first update.
+        if (firstUpdate == 0) {
+            SEq = state.q;
+            storeAuxiliaryFrame();
+        }
+    }
 
-void MARGfilter::reset(void) {
+    store(state);
 
-    firstUpdate = 0;
+}
 
-    //Quaternion orientation of earth frame relative to auxiliary frame.
-    AEq_1 = 1;
-    AEq_2 = 0;
-    AEq_3 = 0;
-    AEq_4 = 0;
+void MARGfilter::reset(void) {
 
-    //Estimated orientation quaternion elements with initial conditions.
-    SEq_1 = 1;
-    SEq_2 = 0;
-    SEq_3 = 0;
-    SEq_4 = 0;
+    resetOrientation();
 
     b_x = 1;
     b_z = 0;
 
-    w_bx = 0;
-    w_by = 0;
-    w_bz = 0;
+    w_b = Vec3<MARGreal>();
+
+    //Converge quickly again and relearn the magnetic references.
+    annealing = 1;
+    fluxRef = 0;
+    dipRef = 0;
 
 }
@@ -41,17 +41,82 @@
 /**
  * Includes
  */
-#include "mbed.h"
+#include <math.h>
+#include <stdint.h>
+#include "OrientationEngine.h"
+#include "Quaternion.h"
+#include "RamFunction.h"
 
 /**
  * Defines
  */
+#ifndef PI
 #define PI 3.1415926536
+#endif
+
+//Scalar type of the filter state and arithmetic: single precision where
+//the core has a single precision FPU only (Cortex-M4F, __ARM_FP bit 2 set
+//and bit 3 clear) or with -DMARG_SINGLE_PRECISION, double otherwise. The
+//per-sample and block updates, the estimate and the Euler angles all run
+//in it; only the OrientationSample, OrientationOutput and MARGsnapshot
+//structs they read and write stay double.
+#if !defined(MARG_SINGLE_PRECISION) && defined(__ARM_FP) && (__ARM_FP & 4) && !(__ARM_FP & 8)
+#define MARG_SINGLE_PRECISION
+#endif
+#ifdef MARG_SINGLE_PRECISION
+typedef float MARGreal;
+#else
+typedef double MARGreal;
+#endif
+
+//The update step is large enough that GCC would otherwise call it out of
+//line and keep the block update's state in memory.
+#define MARG_ALWAYS_INLINE inline __attribute__((always_inline))
+
+//Adaptive gain: relative deviation of |a| from gravity below which the
+//accelerometer is fully trusted, and above which it is rejected.
+#define MARG_ACCEL_TOLERANCE  0.05
+#define MARG_ACCEL_REJECT     0.25
+//Adaptive gain: relative deviation of |m| from the learned field strength.
+#define MARG_MAG_TOLERANCE    0.10
+#define MARG_MAG_REJECT       0.40
+//Adaptive gain: deviation of cos(dip angle) from the learned value.
+#define MARG_DIP_TOLERANCE    0.05
+#define MARG_DIP_REJECT       0.20
+//Adaptive gain: gradient norm which re-arms the full convergence gain.
+#define MARG_GRADIENT_SCALE   1.0
+//Adaptive gain: rate at which the field references follow the measurements.
+#define MARG_REFERENCE_RATE   0.01
+
+/**
+ * Everything a MARGfilter carries from one update to the next, as plain
+ * data that can be copied, written to a file or sent as it is. Tuning
+ * (rate, beta, zeta, adaptive gain settings) is not part of it, so a
+ * snapshot can be restored into a filter with a different tuning.
+ */
+struct MARGsnapshot {
+    //Estimated orientation and auxiliary frame [w, x, y, z].
+    double SEq[4];
+    double AEq[4];
+    //Gyroscope biases in rad/s.
+    double w_b[3];
+    //Reference direction of flux in the earth frame.
+    double b_x;
+    double b_z;
+    //Adaptive gain state.
+    double annealing;
+    double fluxRef;
+    double dipRef;
+    double betaEffective;
+    int32_t firstUpdate;
+    //Keeps the size and layout the same on the MCU and the host.
+    int32_t reserved;
+};
 
 /**
  * MARG orientation filter.
  */
-class MARGfilter {
+class MARGfilter : public OrientationEngine<MARGfilter, MARGreal> {
 
 public:
 
@@ -81,35 +146,73 @@ public:
      * @param m_y Y-axis magnetometer reading in not too sure just yet.
      * @param m_z Z-axis magnetometer reading in not too sure just yet.
      */
-    void updateFilter(double w_x, double w_y, double w_z,
-                      double a_x, double a_y, double a_z,
-                      double m_x, double m_y, double m_z);
+    void updateFilter(MARGreal w_x, MARGreal w_y, MARGreal w_z,
+                      MARGreal a_x, MARGreal a_y, MARGreal a_z,
+                      MARGreal m_x, MARGreal m_y, MARGreal m_z);
 
     /**
-     * Compute the Euler angles based on the current filter data.
+     * Update the filter variables with a block of samples.
+     *
+     * @param samples The readings, oldest first.
+     * @param n Number of samples.
+     * @param out Buffer for n / decimation orientations, or 0 for none.
+     * @param decimation Write the orientation after every decimation-th
+     *        sample; 0 is taken as 1.
      */
-    void computeEuler(void);
+    void updateFilter(const OrientationSample* samples, size_t n,
+                      OrientationOutput* out, size_t decimation);
 
     /**
-     * Get the current roll.
+     * Enable adaptive gain scheduling.
      *
-     * @return The current roll angle in radians.
+     * Beta is recomputed on every update. It starts at initialGain and
+     * anneals towards the fixed beta given to the constructor. The
+     * accelerometer and magnetometer terms are weighted down (and finally
+     * rejected) as |a| deviates from gravity and |m| or the dip angle
+     * deviate from their learned references. A large gradient, such as
+     * after a period of rejected measurements, re-arms the high gain.
+     *
+     * @param initialGain Gain used right after a reset or a large error.
+     * @param annealingTime Time constant in seconds of the decay from
+     *  initialGain to the fixed beta.
+     * @param gravity Magnitude of gravity in the accelerometer units.
+     */
+    void setAdaptiveGain(double initialGain, double annealingTime, double gravity);
+
+    /**
+     * Disable adaptive gain scheduling and go back to the fixed beta.
      */
-    double getRoll(void);
+    void setFixedGain(void);
 
     /**
-     * Get the current pitch.
+     * Get the gain used in the last update.
      *
-     * @return The current pitch angle in radians.
+     * @return The effective beta of the last update.
      */
-    double getPitch(void);
+    double getBeta(void);
 
     /**
-     * Get the current yaw.
+     * Get the estimated gyroscope bias.
      *
-     * @return The current yaw angle in radians.
+     * @param bias Pointer to a buffer to hold the x, y and z gyroscope
+     *        bias in rad/s.
      */
-    double getYaw(void);
+    void getGyroBias(double* bias);
+
+    /**
+     * Save the filter state.
+     *
+     * @param snapshot Pointer to a snapshot to hold the state.
+     */
+    void getSnapshot(MARGsnapshot* snapshot);
+
+    /**
+     * Carry on from a saved state, as if the updates since it was taken
+     * had been made on this filter.
+     *
+     * @param snapshot The state from getSnapshot().
+     */
+    void restoreSnapshot(const MARGsnapshot* snapshot);
 
     /**
      * Reset the filter.
@@ -118,31 +221,38 @@ public:
 
 private:
 
-    int firstUpdate;
+    /**
+     * State that changes on every update. A block update keeps it in
+     * locals (registers) for the whole block and writes it back once.
+     */
+    struct State {
+        Quaternion<MARGreal> q;
+        Vec3<MARGreal> w_b;
+        MARGreal b_x;
+        MARGreal b_z;
+        MARGreal annealing;
+        MARGreal fluxRef;
+        MARGreal dipRef;
+        MARGreal gain;
+    };
 
-    //Quaternion orientation of earth frame relative to auxiliary frame.
-    double AEq_1;
-    double AEq_2;
-    double AEq_3;
-    double AEq_4;
+    MARG_ALWAYS_INLINE void load(State& state) const;
+    MARG_ALWAYS_INLINE void store(const State& state);
 
-    //Estimated orientation quaternion elements with initial conditions.
-    double SEq_1;
-    double SEq_2;
-    double SEq_3;
-    double SEq_4;
+    /**
+     * One filter update of state with the given readings.
+     */
+    MARG_ALWAYS_INLINE void step(State& state, const MARGreal* w, const MARGreal* a, const MARGreal* m) const;
 
     // reference direction of flux in earth frame
-    double b_z;
-    double b_x;
+    MARGreal b_z;
+    MARGreal b_x;
 
     //Sampling period
-    double deltat;
+    MARGreal deltat;
 
     //gyroscope biasses
-    double w_bx;
-    double w_by;
-    double w_bz;
+    Vec3<MARGreal> w_b;
 
     //Gyroscope measurement error (in degrees per second).
     double gyroMeasError;
@@ -151,14 +261,31 @@ private:
     double gyroMeasDrift;
 
     //Compute beta (filter tuning constant..
-    double beta;
+    MARGreal beta;
 
     //Compute zeta (filter tuning constant..
-    double zeta;
+    MARGreal zeta;
 
-    double phi;
-    double theta;
-    double psi;
+    //Adaptive gain scheduling.
+    int adaptive;
+    //Gain right after a reset and its per-update decay factor.
+    MARGreal betaInitial;
+    MARGreal betaDecay;
+    //Fraction of (betaInitial - beta) still applied.
+    MARGreal annealing;
+    //Effective beta of the last update.
+    MARGreal betaEffective;
+    //Reference magnitudes of gravity and the magnetic field, and the
+    //cosine of the angle between them.
+    MARGreal gravityRef;
+    MARGreal fluxRef;
+    MARGreal dipRef;
+
+    /**
+     * Map a relative deviation to a weight between 1 (trusted) and
+     * 0 (rejected).
+     */
+    static MARGreal trust(MARGreal deviation, MARGreal tolerance, MARGreal reject);
 
 };
 
@@ -0,0 +1,227 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Multiplicative extended Kalman filter (MEKF).
+ */
+
+/**
+ * Includes
+ */
+#include "MEKFfilter.h"
+
+MEKFfilter::MEKFfilter(double rate, double gyroscopeMeasurementError, double gyroscopeMeasurementDrift,
+                       double accelerometerNoise, double magnetometerNoise) {
+
+    //Sampling period (typical value is ~0.01s).
+    deltat = (float) rate;
+
+    //Angle and bias random walk over one update, in rad and rad/s.
+    float sigma_w = (float) (PI * (gyroscopeMeasurementError / 180.0) * rate);
+    float sigma_b = (float) (PI * (gyroscopeMeasurementDrift / 180.0) * rate);
+    attitudeNoise = sigma_w * sigma_w;
+    biasNoise = sigma_b * sigma_b;
+
+    accelerometerVariance = (float) (accelerometerNoise * accelerometerNoise);
+    magnetometerVariance = (float) (magnetometerNoise * magnetometerNoise);
+
+    reset();
+
+}
+
+void MEKFfilter::updateFilter(double w_x, double w_y, double w_z, double a_x, double a_y, double a_z, double m_x, double m_y, double m_z) {
+
+    // local system variables
+    Quaternion<float> q = SEqf; // estimated orientation, kept in registers
+    Vec3<float> w((float) w_x, (float) w_y, (float) w_z); // gyroscope measurement
+    Vec3<float> a((float) a_x, (float) a_y, (float) a_z); // accelerometer measurement
+    Vec3<float> m((float) m_x, (float) m_y, (float) m_z); // magnetometer measurement
+    Vec3<float> v; // predicted direction in the sensor frame
+    Vec3<float> f; // flux in the earth frame
+    float norm; // vector norm
+    float b_x, b_z; // reference direction of flux
+    float h[3]; // attitude part of a measurement row
+    float dx[6] = {0, 0, 0, 0, 0, 0}; // error state
+    int i, j, k;
+
+    // propagate the quaternion with the bias compensated rate
+    w = w - w_b;
+    float wx = w.x, wy = w.y, wz = w.z;
+    q = q + q * (w * (0.5f * deltat));
+
+    // propagate the covariance, P = Phi P Phi' + Q with
+    // Phi = [A -dt*I; 0 I] and A = I - [w x] dt
+    Matrix<float, 3, 3> A, P11, P12, B, C;
+    A(0, 0) = 1;              A(0, 1) = wz * deltat;    A(0, 2) = -wy * deltat;
+    A(1, 0) = -wz * deltat;   A(1, 1) = 1;              A(1, 2) = wx * deltat;
+    A(2, 0) = wy * deltat;    A(2, 1) = -wx * deltat;   A(2, 2) = 1;
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++) {
+            P11(i, j) = P(i, j);
+            P12(i, j) = P(i, j + 3);
+        }
+    }
+    // B = A P12 - dt P22 is the new cross covariance
+    B = A * P12;
+    // C = A P11 - dt P21
+    C = A * P11;
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++) {
+            B(i, j) -= deltat * P(i + 3, j + 3);
+            C(i, j) -= deltat * P12(j, i);
+        }
+    }
+    // P11 = C A' - dt B, symmetric so only the upper triangle
+    for (i = 0; i < 3; i++) {
+        for (j = i; j < 3; j++) {
+            float sum = 0;
+            for (k = 0; k < 3; k++) {
+                sum += C(i, k) * A(j, k);
+            }
+            P(i, j) = sum - deltat * B(i, j);
+        }
+        P(i, i) += attitudeNoise;
+        P(i + 3, i + 3) += biasNoise;
+    }
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++) {
+            P(i, j + 3) = B(i, j);
+        }
+    }
+
+    // normalise the accelerometer measurement
+    norm = a.norm();
+    if (norm > 0.0f) {
+        a = a / norm;
+        // predicted direction of gravity, the measurement row is [v x]
+        v = Vec3<float>(2.0f * (q.x * q.z - q.w * q.y),
+                        2.0f * (q.w * q.x + q.y * q.z),
+                        q.w * q.w - q.x * q.x - q.y * q.y + q.z * q.z);
+        h[0] = 0;    h[1] = -v.z; h[2] = v.y;
+        scalarUpdate(h, a.x - v.x, accelerometerVariance, dx);
+        h[0] = v.z;  h[1] = 0;    h[2] = -v.x;
+        scalarUpdate(h, a.y - v.y, accelerometerVariance, dx);
+        h[0] = -v.y; h[1] = v.x;  h[2] = 0;
+        scalarUpdate(h, a.z - v.z, accelerometerVariance, dx);
+    }
+
+    // normalise the magnetometer measurement
+    norm = m.norm();
+    if (norm > 0.0f) {
+        m = m / norm;
+        // reference direction of flux in the earth frame; only the heading
+        // differs between it and the measurement
+        f = q.toEarth(m);
+        b_x = std::sqrt(f.x * f.x + f.y * f.y);
+        b_z = f.z;
+        // predicted direction of flux in the sensor frame
+        v = Vec3<float>(2.0f * (b_x * (0.5f - q.y * q.y - q.z * q.z) + b_z * (q.x * q.z - q.w * q.y)),
+                        2.0f * (b_x * (q.x * q.y - q.w * q.z) + b_z * (q.w * q.x + q.y * q.z)),
+                        2.0f * (b_x * (q.w * q.y + q.x * q.z) + b_z * (0.5f - q.x * q.x - q.y * q.y)));
+        h[0] = 0;    h[1] = -v.z; h[2] = v.y;
+        scalarUpdate(h, m.x - v.x, magnetometerVariance, dx);
+        h[0] = v.z;  h[1] = 0;    h[2] = -v.x;
+        scalarUpdate(h, m.y - v.y, magnetometerVariance, dx);
+        h[0] = -v.y; h[1] = v.x;  h[2] = 0;
+        scalarUpdate(h, m.z - v.z, magnetometerVariance, dx);
+    }
+
+    // apply the attitude error, q = q * [1 dx/2]
+    q = q + q * Vec3<float>(dx[0], dx[1], dx[2]) * 0.5f;
+    // apply the bias error
+    w_b = w_b + Vec3<float>(dx[3], dx[4], dx[5]);
+    // normalise quaternion
+    SEqf = q.normalized();
+
+    SEq = Quaternion<double>(SEqf.w, SEqf.x, SEqf.y, SEqf.z);
+
+    //Store orientation of auxiliary frame.
+    storeAuxiliaryFrame();
+
+}
+
+void MEKFfilter::updateFilter(const OrientationSample* samples, size_t n, OrientationOutput* out, size_t decimation) {
+
+    updateEach(samples, n, out, decimation);
+
+}
+
+void MEKFfilter::scalarUpdate(const float* h, float residual, float variance, float* dx) {
+
+    float ph[6]; // P h'
+    float s; // innovation variance
+    float k[6]; // Kalman gain
+    int i, j;
+
+    // the bias part of h is zero, so only the first three columns of P
+    for (i = 0; i < 6; i++) {
+        ph[i] = P(i, 0) * h[0] + P(i, 1) * h[1] + P(i, 2) * h[2];
+    }
+    s = h[0] * ph[0] + h[1] * ph[1] + h[2] * ph[2] + variance;
+    // innovation against the error state fused so far
+    residual -= h[0] * dx[0] + h[1] * dx[1] + h[2] * dx[2];
+    for (i = 0; i < 6; i++) {
+        k[i] = ph[i] / s;
+        dx[i] += k[i] * residual;
+    }
+    // P = P - k (P h')', a symmetric rank one update
+    for (i = 0; i < 6; i++) {
+        for (j = i; j < 6; j++) {
+            P.m[SymmetricMatrix<float, 6>::index(i, j)] -= k[i] * ph[j];
+        }
+    }
+
+}
+
+void MEKFfilter::getAttitudeCovariance(double* covariance) {
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            covariance[i * 3 + j] = P(i, j);
+        }
+    }
+
+}
+
+void MEKFfilter::getGyroBias(double* bias) {
+
+    bias[0] = w_b.x;
+    bias[1] = w_b.y;
+    bias[2] = w_b.z;
+
+}
+
+void MEKFfilter::reset(void) {
+
+    resetOrientation();
+
+    SEqf = Quaternion<float>();
+
+    w_b = Vec3<float>();
+
+    P.zero();
+    for (int i = 0; i < 3; i++) {
+        P(i, i) = MEKF_INITIAL_ATTITUDE_VARIANCE;
+        P(i + 3, i + 3) = MEKF_INITIAL_BIAS_VARIANCE;
+    }
+
+}
@@ -0,0 +1,168 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Multiplicative extended Kalman filter (MEKF).
+ *
+ * The error state is the small attitude error in the sensor frame and the
+ * gyroscope bias error (6 states). The quaternion itself is kept outside
+ * the filter and corrected multiplicatively after every update, so the
+ * covariance stays 6x6 and well conditioned. Accelerometer and
+ * magnetometer directions are fused as six sequential scalar updates,
+ * which needs no matrix inversion. Everything is single precision and
+ * fixed size; there is no heap use.
+ *
+ * F. L. Markley, "Attitude Error Representations for Kalman Filtering",
+ * Journal of Guidance, Control, and Dynamics, 2003.
+ */
+
+#ifndef MEKF_FILTER_H
+#define MEKF_FILTER_H
+
+/**
+ * Includes
+ */
+#include <math.h>
+#include "OrientationEngine.h"
+#include "Quaternion.h"
+#include "Matrix.h"
+
+/**
+ * Defines
+ */
+#ifndef PI
+#define PI 3.1415926536
+#endif
+//Initial attitude variance, (30 degrees)^2 in rad^2.
+#define MEKF_INITIAL_ATTITUDE_VARIANCE 0.274f
+//Initial gyroscope bias variance, (2 degrees/s)^2 in (rad/s)^2.
+#define MEKF_INITIAL_BIAS_VARIANCE     0.00122f
+
+/**
+ * MEKF orientation filter with gyroscope bias estimation.
+ */
+class MEKFfilter : public OrientationEngine<MEKFfilter> {
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param rate The rate at which the filter should be updated.
+     * @param gyroscopeMeasurementError The noise of the gyroscope in degrees
+     *  per second.
+     * @param gyroscopeMeasurementDrift The drift of the gyroscope bias in
+     *  degrees per second per second.
+     * @param accelerometerNoise The noise of the normalised accelerometer
+     *  reading, including expected linear acceleration (fraction of g).
+     * @param magnetometerNoise The noise of the normalised magnetometer
+     *  reading (fraction of the field strength).
+     */
+    MEKFfilter(double rate, double gyroscopeMeasurementError, double gyroscopeMeasurementDrift,
+               double accelerometerNoise, double magnetometerNoise);
+
+    /**
+     * Update the filter variables.
+     *
+     * @param w_x X-axis gyroscope reading in rad/s.
+     * @param w_y Y-axis gyroscope reading in rad/s.
+     * @param w_z Z-axis gyroscope reading in rad/s.
+     * @param a_x X-axis accelerometer reading in m/s/s.
+     * @param a_y Y-axis accelerometer reading in m/s/s.
+     * @param a_z Z-axis accelerometer reading in m/s/s.
+     * @param m_x X-axis magnetometer reading.
+     * @param m_y Y-axis magnetometer reading.
+     * @param m_z Z-axis magnetometer reading.
+     */
+    void updateFilter(double w_x, double w_y, double w_z,
+                      double a_x, double a_y, double a_z,
+                      double m_x, double m_y, double m_z);
+
+    /**
+     * Update the filter variables with a block of samples.
+     *
+     * @param samples The readings, oldest first.
+     * @param n Number of samples.
+     * @param out Buffer for n / decimation orientations, or 0 for none.
+     * @param decimation Write the orientation after every decimation-th
+     *        sample; 0 is taken as 1.
+     */
+    void updateFilter(const OrientationSample* samples, size_t n,
+                      OrientationOutput* out, size_t decimation);
+
+    /**
+     * Get the covariance of the attitude error.
+     *
+     * @param covariance Pointer to a buffer to hold the 3x3 covariance of
+     *        the attitude error about the sensor x, y and z axes in rad^2,
+     *        row by row.
+     */
+    void getAttitudeCovariance(double* covariance);
+
+    /**
+     * Get the estimated gyroscope bias.
+     *
+     * @param bias Pointer to a buffer to hold the x, y and z gyroscope
+     *        bias in rad/s.
+     */
+    void getGyroBias(double* bias);
+
+    /**
+     * Reset the filter.
+     */
+    void reset(void);
+
+private:
+
+    /**
+     * Fuse one scalar measurement.
+     *
+     * @param h Attitude part of the measurement row (the bias part is 0).
+     * @param residual Measured minus predicted value.
+     * @param variance Measurement noise variance.
+     * @param dx Error state accumulated over this update.
+     */
+    void scalarUpdate(const float* h, float residual, float variance, float* dx);
+
+    //Sampling period
+    float deltat;
+
+    //Process noise of the attitude and bias per update.
+    float attitudeNoise;
+    float biasNoise;
+
+    //Measurement noise variances.
+    float accelerometerVariance;
+    float magnetometerVariance;
+
+    //Single precision copy of the estimated quaternion.
+    Quaternion<float> SEqf;
+
+    //Gyroscope biases.
+    Vec3<float> w_b;
+
+    //Error state covariance, attitude error then bias error.
+    SymmetricMatrix<float, 6> P;
+
+};
+
+#endif /* MEKF_FILTER_H */
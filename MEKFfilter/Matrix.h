@@ -0,0 +1,128 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Fixed-size matrices for the Kalman filter.
+ *
+ * Dimensions are template parameters, storage is a plain array inside the
+ * object, so matrices live on the stack or in the filter object and never
+ * touch the heap.
+ */
+
+#ifndef MATRIX_H
+#define MATRIX_H
+
+/**
+ * Dense R x C matrix.
+ */
+template <typename T, int R, int C>
+struct Matrix {
+
+    T m[R][C];
+
+    T& operator()(int i, int j) { return m[i][j]; }
+    const T& operator()(int i, int j) const { return m[i][j]; }
+
+    void zero(void) {
+        for (int i = 0; i < R; i++) {
+            for (int j = 0; j < C; j++) {
+                m[i][j] = 0;
+            }
+        }
+    }
+
+    void identity(void) {
+        for (int i = 0; i < R; i++) {
+            for (int j = 0; j < C; j++) {
+                m[i][j] = (i == j) ? 1 : 0;
+            }
+        }
+    }
+
+};
+
+/**
+ * Matrix product.
+ */
+template <typename T, int R, int N, int C>
+inline Matrix<T, R, C> operator*(const Matrix<T, R, N>& a, const Matrix<T, N, C>& b) {
+
+    Matrix<T, R, C> p;
+
+    for (int i = 0; i < R; i++) {
+        for (int j = 0; j < C; j++) {
+            T sum = 0;
+            for (int k = 0; k < N; k++) {
+                sum += a.m[i][k] * b.m[k][j];
+            }
+            p.m[i][j] = sum;
+        }
+    }
+
+    return p;
+
+}
+
+/**
+ * Symmetric N x N matrix.
+ *
+ * Only the upper triangle is stored, row by row, N * (N + 1) / 2 elements.
+ * Updates written against it touch each independent element once.
+ */
+template <typename T, int N>
+struct SymmetricMatrix {
+
+    enum { SIZE = N * (N + 1) / 2 };
+
+    T m[SIZE];
+
+    /**
+     * Position of element (i, j), i <= j, in the packed storage.
+     */
+    static int index(int i, int j) {
+        return i * N - (i * (i - 1)) / 2 + (j - i);
+    }
+
+    T& operator()(int i, int j) {
+        return (i <= j) ? m[index(i, j)] : m[index(j, i)];
+    }
+
+    const T& operator()(int i, int j) const {
+        return (i <= j) ? m[index(i, j)] : m[index(j, i)];
+    }
+
+    void zero(void) {
+        for (int i = 0; i < SIZE; i++) {
+            m[i] = 0;
+        }
+    }
+
+    void diagonal(T value) {
+        zero();
+        for (int i = 0; i < N; i++) {
+            m[index(i, i)] = value;
+        }
+    }
+
+};
+
+#endif /* MATRIX_H */
@@ -0,0 +1,129 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Mahony nonlinear complementary filter on SO(3).
+ */
+
+/**
+ * Includes
+ */
+#include "MahonyFilter.h"
+
+MahonyFilter::MahonyFilter(double rate, double kp, double ki) {
+
+    //Sampling period (typical value is ~0.1s).
+    deltat = rate;
+
+    twoKp = 2.0 * kp;
+    twoKi = 2.0 * ki;
+
+    e_i = Vec3<double>();
+
+}
+
+void MahonyFilter::updateFilter(double w_x, double w_y, double w_z, double a_x, double a_y, double a_z, double m_x, double m_y, double m_z) {
+
+    // local system variables
+    Quaternion<double> q = SEq; // estimated orientation, kept in registers
+    Vec3<double> w(w_x, w_y, w_z); // gyroscope measurement
+    Vec3<double> a(a_x, a_y, a_z); // accelerometer measurement
+    Vec3<double> m(m_x, m_y, m_z); // magnetometer measurement
+    Vec3<double> h; // flux in the earth frame
+    Vec3<double> halfv; // estimated direction of gravity
+    Vec3<double> halfw; // estimated direction of flux
+    Vec3<double> halfe; // error between estimated and measured directions
+    double norm; // vector norm
+    double b_x, b_z; // reference direction of flux
+    // axulirary variables to avoid reapeated calcualtions
+    double SEq_1SEq_2 = q.w * q.x;
+    double SEq_1SEq_3 = q.w * q.y;
+    double SEq_1SEq_4 = q.w * q.z;
+    double SEq_2SEq_2 = q.x * q.x;
+    double SEq_2SEq_3 = q.x * q.y;
+    double SEq_2SEq_4 = q.x * q.z;
+    double SEq_3SEq_3 = q.y * q.y;
+    double SEq_3SEq_4 = q.y * q.z;
+    double SEq_4SEq_4 = q.z * q.z;
+    // error is the sum of the cross products of measured and estimated
+    // directions; a sensor with no reading yet adds none
+    norm = a.norm();
+    if (norm > 0.0) {
+        // normalise the accelerometer measurement
+        a = a / norm;
+        // estimated direction of gravity (halved)
+        halfv = Vec3<double>(SEq_2SEq_4 - SEq_1SEq_3, SEq_1SEq_2 + SEq_3SEq_4, q.w * q.w - 0.5 + SEq_4SEq_4);
+        halfe = halfe + a.cross(halfv);
+    }
+    norm = m.norm();
+    if (norm > 0.0) {
+        // normalise the magnetometer measurement
+        m = m / norm;
+        // reference direction of flux in the earth frame
+        h = q.toEarth(m);
+        b_x = std::sqrt(h.x * h.x + h.y * h.y);
+        b_z = h.z;
+        // estimated direction of flux (halved)
+        halfw = Vec3<double>(b_x * (0.5 - SEq_3SEq_3 - SEq_4SEq_4) + b_z * (SEq_2SEq_4 - SEq_1SEq_3),
+                             b_x * (SEq_2SEq_3 - SEq_1SEq_4) + b_z * (SEq_1SEq_2 + SEq_3SEq_4),
+                             b_x * (SEq_1SEq_3 + SEq_2SEq_4) + b_z * (0.5 - SEq_2SEq_2 - SEq_3SEq_3));
+        halfe = halfe + m.cross(halfw);
+    }
+    // integral feedback, the gyroscope bias estimate
+    if (twoKi > 0.0) {
+        e_i = e_i + halfe * twoKi * deltat;
+        w = w + e_i;
+    }
+    // proportional feedback
+    w = w + halfe * twoKp;
+    // integrate the quaternion rate
+    q = q + q * (w * (0.5 * deltat));
+    // normalise quaternion
+    SEq = q.normalized();
+
+    //Store orientation of auxiliary frame.
+    storeAuxiliaryFrame();
+
+}
+
+void MahonyFilter::updateFilter(const OrientationSample* samples, size_t n, OrientationOutput* out, size_t decimation) {
+
+    updateEach(samples, n, out, decimation);
+
+}
+
+void MahonyFilter::getGyroBias(double* bias) {
+
+    //The integral term is added to the gyroscope rate.
+    bias[0] = -e_i.x;
+    bias[1] = -e_i.y;
+    bias[2] = -e_i.z;
+
+}
+
+void MahonyFilter::reset(void) {
+
+    resetOrientation();
+
+    e_i = Vec3<double>();
+
+}
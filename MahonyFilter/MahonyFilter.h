@@ -0,0 +1,119 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Mahony nonlinear complementary filter on SO(3).
+ *
+ * The error between the measured and the estimated directions of gravity
+ * and of the magnetic field (their cross product) drives a PI controller
+ * that corrects the gyroscope rate. There is no Jacobian, and the integral
+ * term estimates the gyroscope bias.
+ *
+ * R. Mahony, T. Hamel and J.-M. Pflimlin, "Nonlinear Complementary Filters
+ * on the Special Orthogonal Group", IEEE TAC, 2008.
+ */
+
+#ifndef MAHONY_FILTER_H
+#define MAHONY_FILTER_H
+
+/**
+ * Includes
+ */
+#include <math.h>
+#include "OrientationEngine.h"
+#include "Quaternion.h"
+
+/**
+ * Mahony MARG orientation filter.
+ */
+class MahonyFilter : public OrientationEngine<MahonyFilter> {
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param rate The rate at which the filter should be updated.
+     * @param kp Proportional gain. Larger values trust the accelerometer and
+     *  magnetometer more.
+     * @param ki Integral gain used to estimate the gyroscope bias, 0 to
+     *  disable bias estimation.
+     */
+    MahonyFilter(double rate, double kp, double ki);
+
+    /**
+     * Update the filter variables.
+     *
+     * @param w_x X-axis gyroscope reading in rad/s.
+     * @param w_y Y-axis gyroscope reading in rad/s.
+     * @param w_z Z-axis gyroscope reading in rad/s.
+     * @param a_x X-axis accelerometer reading in m/s/s.
+     * @param a_y Y-axis accelerometer reading in m/s/s.
+     * @param a_z Z-axis accelerometer reading in m/s/s.
+     * @param m_x X-axis magnetometer reading.
+     * @param m_y Y-axis magnetometer reading.
+     * @param m_z Z-axis magnetometer reading.
+     */
+    void updateFilter(double w_x, double w_y, double w_z,
+                      double a_x, double a_y, double a_z,
+                      double m_x, double m_y, double m_z);
+
+    /**
+     * Update the filter variables with a block of samples.
+     *
+     * @param samples The readings, oldest first.
+     * @param n Number of samples.
+     * @param out Buffer for n / decimation orientations, or 0 for none.
+     * @param decimation Write the orientation after every decimation-th
+     *        sample; 0 is taken as 1.
+     */
+    void updateFilter(const OrientationSample* samples, size_t n,
+                      OrientationOutput* out, size_t decimation);
+
+    /**
+     * Get the estimated gyroscope bias.
+     *
+     * @param bias Pointer to a buffer to hold the x, y and z gyroscope
+     *        bias in rad/s.
+     */
+    void getGyroBias(double* bias);
+
+    /**
+     * Reset the filter.
+     */
+    void reset(void);
+
+private:
+
+    //Sampling period
+    double deltat;
+
+    //Twice the proportional and integral gains.
+    double twoKp;
+    double twoKi;
+
+    //Integral error term, the negated gyroscope bias.
+    Vec3<double> e_i;
+
+};
+
+#endif /* MAHONY_FILTER_H */
@@ -0,0 +1,283 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Common interface of the orientation engines (MARGfilter, MahonyFilter...).
+ *
+ * The interface uses the curiously recurring template pattern: an engine
+ * derives from OrientationEngine<itself, Real> and calls are resolved at
+ * compile time, so there is no virtual call or vtable on the MCU. Real is
+ * the scalar type of the estimate, the per-sample update and the Euler
+ * angles, so an engine running in single precision stays there.
+ *
+ * An engine provides:
+ *
+ *   void updateFilter(Real w_x, Real w_y, Real w_z,
+ *                     Real a_x, Real a_y, Real a_z,
+ *                     Real m_x, Real m_y, Real m_z);
+ *   void updateFilter(const OrientationSample* samples, size_t n,
+ *                     OrientationOutput* out, size_t decimation);
+ *   void reset(void);
+ *
+ * keeps its estimate in SEq and calls storeAuxiliaryFrame() at the
+ * end of every update.
+ */
+
+#ifndef ORIENTATION_ENGINE_H
+#define ORIENTATION_ENGINE_H
+
+/**
+ * Includes
+ */
+#include <math.h>
+#include <cmath>
+#include <stddef.h>
+#include "Quaternion.h"
+
+/**
+ * One set of readings for a block update, in the units of update().
+ */
+struct OrientationSample {
+    double w[3];
+    double a[3];
+    double m[3];
+};
+
+/**
+ * Orientation of the earth relative to the sensor [w, x, y, z] after a
+ * sample of a block update.
+ */
+struct OrientationOutput {
+    double q[4];
+};
+
+/**
+ * Orientation engine base class.
+ */
+template <class Engine, typename Real = double>
+class OrientationEngine {
+
+public:
+
+    /**
+     * Update the engine.
+     *
+     * @param w_x X-axis gyroscope reading in rad/s.
+     * @param w_y Y-axis gyroscope reading in rad/s.
+     * @param w_z Z-axis gyroscope reading in rad/s.
+     * @param a_x X-axis accelerometer reading in m/s/s.
+     * @param a_y Y-axis accelerometer reading in m/s/s.
+     * @param a_z Z-axis accelerometer reading in m/s/s.
+     * @param m_x X-axis magnetometer reading.
+     * @param m_y Y-axis magnetometer reading.
+     * @param m_z Z-axis magnetometer reading.
+     */
+    void update(Real w_x, Real w_y, Real w_z,
+                Real a_x, Real a_y, Real a_z,
+                Real m_x, Real m_y, Real m_z) {
+
+        static_cast<Engine*>(this)->updateFilter(w_x, w_y, w_z,
+                                                 a_x, a_y, a_z,
+                                                 m_x, m_y, m_z);
+
+    }
+
+    /**
+     * Update the engine with a block of samples, e.g. a drained FIFO or a
+     * stretch of a log, equivalent to update() on each in turn.
+     *
+     * @param samples The readings, oldest first.
+     * @param n Number of samples.
+     * @param out Buffer for n / decimation orientations, or 0 for none.
+     * @param decimation Write the orientation after every decimation-th
+     *        sample; 0 is taken as 1.
+     */
+    void update(const OrientationSample* samples, size_t n,
+                OrientationOutput* out = 0, size_t decimation = 1) {
+
+        static_cast<Engine*>(this)->updateFilter(samples, n, out, decimation);
+
+    }
+
+    /**
+     * Get the estimated orientation of the earth relative to the sensor.
+     *
+     * @param q Pointer to a buffer to hold the quaternion elements
+     *        [w, x, y, z], of the engine's scalar type or wider.
+     */
+    template <typename T>
+    void getQuaternion(T* q) {
+
+        q[0] = SEq.w;
+        q[1] = SEq.x;
+        q[2] = SEq.y;
+        q[3] = SEq.z;
+
+    }
+
+    /**
+     * Compute the Euler angles based on the current filter data.
+     *
+     * The angles are relative to the auxiliary frame, the orientation
+     * after the first update.
+     */
+    void computeEuler(void) {
+
+        //Quaternion describing orientation of sensor relative to auxiliary
+        //frame: the conjugate (sensor relative to earth) times AEq.
+        Quaternion<Real> ASq = SEq.conjugate() * AEq;
+
+        //Compute the Euler angles from the quaternion, with the std::
+        //overloads so float stays float.
+        phi = std::atan2(2 * ASq.y * ASq.z - 2 * ASq.w * ASq.x, 2 * ASq.w * ASq.w + 2 * ASq.z * ASq.z - 1);
+        theta = std::asin(2 * ASq.x * ASq.y - 2 * ASq.w * ASq.y);
+        psi = std::atan2(2 * ASq.x * ASq.y - 2 * ASq.w * ASq.z, 2 * ASq.w * ASq.w + 2 * ASq.x * ASq.x - 1);
+
+    }
+
+    /**
+     * Get the Euler angles computed by the last computeEuler().
+     *
+     * @param euler Pointer to a buffer to hold the roll, pitch and yaw
+     *        angles in radians [in that order].
+     */
+    template <typename T>
+    void getEuler(T* euler) {
+
+        euler[0] = phi;
+        euler[1] = theta;
+        euler[2] = psi;
+
+    }
+
+    /**
+     * Get the current roll.
+     *
+     * @return The current roll angle in radians.
+     */
+    Real getRoll(void) {
+
+        return phi;
+
+    }
+
+    /**
+     * Get the current pitch.
+     *
+     * @return The current pitch angle in radians.
+     */
+    Real getPitch(void) {
+
+        return theta;
+
+    }
+
+    /**
+     * Get the current yaw.
+     *
+     * @return The current yaw angle in radians.
+     */
+    Real getYaw(void) {
+
+        return psi;
+
+    }
+
+protected:
+
+    OrientationEngine() {
+
+        resetOrientation();
+        phi = 0;
+        theta = 0;
+        psi = 0;
+
+    }
+
+    /**
+     * Go back to the initial orientation.
+     */
+    void resetOrientation(void) {
+
+        firstUpdate = 0;
+
+        //Quaternion orientation of earth frame relative to auxiliary frame.
+        AEq = Quaternion<Real>();
+
+        //Estimated orientation quaternion with initial conditions.
+        SEq = Quaternion<Real>();
+
+    }
+
+    /**
+     * Block update for engines without a faster one: update() on each
+     * sample in turn.
+     */
+    void updateEach(const OrientationSample* samples, size_t n,
+                    OrientationOutput* out, size_t decimation) {
+
+        if (decimation == 0) {
+            decimation = 1;
+        }
+        size_t countdown = decimation;
+
+        for (size_t i = 0; i < n; i++) {
+            const OrientationSample& s = samples[i];
+            static_cast<Engine*>(this)->updateFilter(s.w[0], s.w[1], s.w[2],
+                                                     s.a[0], s.a[1], s.a[2],
+                                                     s.m[0], s.m[1], s.m[2]);
+            if (out != 0 && --countdown == 0) {
+                getQuaternion(out->q);
+                out++;
+                countdown = decimation;
+            }
+        }
+
+    }
+
+    /**
+     * Store the orientation of the auxiliary frame after the first update.
+     */
+    void storeAuxiliaryFrame(void) {
+
+        if (firstUpdate == 0) {
+            AEq = SEq;
+            firstUpdate = 1;
+        }
+
+    }
+
+    int firstUpdate;
+
+    //Quaternion orientation of earth frame relative to auxiliary frame.
+    Quaternion<Real> AEq;
+
+    //Estimated orientation quaternion.
+    Quaternion<Real> SEq;
+
+    Real phi;
+    Real theta;
+    Real psi;
+
+};
+
+#endif /* ORIENTATION_ENGINE_H */
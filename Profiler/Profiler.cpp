@@ -0,0 +1,130 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Scoped profiling zones.
+ */
+
+/**
+ * Includes
+ */
+#include "Profiler.h"
+
+#ifdef PROFILING
+
+#include <string.h>
+
+static ProfileZone zones[PROFILER_MAX_ZONES];
+static int zoneCount = 0;
+
+static void clearWindow(ProfileZone& zone) {
+
+    zone.count = 0;
+    zone.min = 0xFFFFFFFF;
+    zone.max = 0;
+    zone.total = 0;
+    memset(zone.histogram, 0, sizeof(zone.histogram));
+
+}
+
+void profilerInit(void) {
+
+#if defined(TARGET_LPC1768) || defined(TARGET_LPC4088)
+    //The cycle counter is part of the trace unit, off until enabled.
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+    for (int i = 0; i < PROFILER_MAX_ZONES; i++) {
+        zones[i].name = 0;
+        clearWindow(zones[i]);
+    }
+    zoneCount = 0;
+
+}
+
+void profilerName(int zone, const char* name) {
+
+    zones[zone].name = name;
+    if (zone >= zoneCount) {
+        zoneCount = zone + 1;
+    }
+
+}
+
+void profilerRecord(int zone, uint32_t ticks) {
+
+    ProfileZone& z = zones[zone];
+
+    z.count++;
+    z.total += ticks;
+    if (ticks < z.min) {
+        z.min = ticks;
+    }
+    if (ticks > z.max) {
+        z.max = ticks;
+    }
+
+    //floor(log2(ticks)), a single CLZ instruction on the Cortex-M3.
+    int bin = 31 - __builtin_clz(ticks | 1) - PROFILER_HISTOGRAM_SHIFT;
+    if (bin < 0) {
+        bin = 0;
+    } else if (bin >= PROFILER_HISTOGRAM_BINS) {
+        bin = PROFILER_HISTOGRAM_BINS - 1;
+    }
+    if (z.histogram[bin] != 0xFFFF) {
+        z.histogram[bin]++;
+    }
+
+}
+
+bool profilerTake(int zone, ProfileZone* window) {
+
+    if (zone >= zoneCount || zones[zone].name == 0) {
+        return false;
+    }
+
+    *window = zones[zone];
+    clearWindow(zones[zone]);
+
+    return true;
+
+}
+
+int profilerZones(void) {
+
+    return zoneCount;
+
+}
+
+uint32_t profilerTickRate(void) {
+
+#if defined(TARGET_LPC1768) || defined(TARGET_LPC4088)
+    return SystemCoreClock;
+#else
+    return 1000000000;
+#endif
+
+}
+
+#endif /* PROFILING */
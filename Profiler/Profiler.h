@@ -0,0 +1,181 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Scoped profiling zones.
+ *
+ * A zone is a piece of code, identified by a small number, whose duration
+ * is measured every time it runs: in core clock cycles from the DWT cycle
+ * counter on the Cortex-M3/M4, in nanoseconds from std::chrono on the
+ * host. Each zone keeps the count, minimum, maximum and total of its
+ * durations and a log2 histogram in a static table; profilerTake() copies
+ * a zone out and starts a new window, e.g. to send it as telemetry.
+ *
+ * Everything is compiled only when PROFILING is defined (make PROFILE=1).
+ * Otherwise PROFILE_SCOPE() expands to nothing and there is no table, so
+ * production builds can keep the zones in place at no cost.
+ *
+ * Zones are recorded and taken without masking interrupts, so a zone that
+ * runs in an interrupt must be taken with interrupts masked. A zone
+ * running in thread context also counts the interrupts that preempt it.
+ *
+ * Usage:
+ *
+ *   profilerInit();
+ *   profilerName(ZONE_FILTER, "filter");
+ *   ...
+ *   void filter(void) {
+ *       PROFILE_SCOPE(ZONE_FILTER);
+ *       ...
+ *   }
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#ifdef PROFILING
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+#if defined(TARGET_LPC1768) || defined(TARGET_LPC4088)
+#include "cmsis.h"
+#else
+#include <chrono>
+#endif
+
+/**
+ * Defines
+ */
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+//Measure from here to the end of the enclosing scope.
+#define PROFILE_SCOPE(zone) ProfileScope PROFILE_CONCATENATE(profileScope, __LINE__)(zone)
+
+//Most zones in the table.
+#define PROFILER_MAX_ZONES 8
+//Histogram bin i counts durations of 2^(i + PROFILER_HISTOGRAM_SHIFT) up
+//to 2^(i + PROFILER_HISTOGRAM_SHIFT + 1) ticks; the first and last bins
+//also take everything shorter and longer.
+#define PROFILER_HISTOGRAM_BINS 16
+#define PROFILER_HISTOGRAM_SHIFT 6
+
+/**
+ * Durations of a zone over a window, in ticks.
+ */
+struct ProfileZone {
+    //Name given to profilerName(), 0 if the zone is unused.
+    const char* name;
+    uint32_t count;
+    //0xFFFFFFFF while count is 0.
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    //Saturating counts.
+    uint16_t histogram[PROFILER_HISTOGRAM_BINS];
+};
+
+/**
+ * Start the tick counter and clear the table.
+ */
+void profilerInit(void);
+
+/**
+ * Name a zone; zones without a name are not reported.
+ *
+ * @param zone Zone number, less than PROFILER_MAX_ZONES.
+ * @param name A string that outlives the profiler, e.g. a literal.
+ */
+void profilerName(int zone, const char* name);
+
+/**
+ * Add a duration to a zone.
+ *
+ * @param zone Zone number.
+ * @param ticks Duration in ticks.
+ */
+void profilerRecord(int zone, uint32_t ticks);
+
+/**
+ * Copy a zone's window out and start a new one.
+ *
+ * @param zone Zone number.
+ * @param window Receives the durations since the last take.
+ *
+ * @return false if the zone has no name.
+ */
+bool profilerTake(int zone, ProfileZone* window);
+
+/**
+ * Number of zones up to the last named one.
+ */
+int profilerZones(void);
+
+/**
+ * Ticks per second.
+ */
+uint32_t profilerTickRate(void);
+
+/**
+ * Current tick count; differences are valid across one wrap.
+ */
+inline uint32_t profilerNow(void) {
+
+#if defined(TARGET_LPC1768) || defined(TARGET_LPC4088)
+    return DWT->CYCCNT;
+#else
+    return (uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+
+}
+
+/**
+ * Records the time from its construction to its destruction to a zone.
+ */
+class ProfileScope {
+
+public:
+
+    ProfileScope(int id) : zone(id), start(profilerNow()) {}
+
+    ~ProfileScope() {
+
+        profilerRecord(zone, profilerNow() - start);
+
+    }
+
+private:
+
+    int zone;
+    uint32_t start;
+
+};
+
+#else
+
+#define PROFILE_SCOPE(zone)
+
+#endif /* PROFILING */
+
+#endif /* PROFILER_H */
@@ -0,0 +1,246 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Header-only quaternion and 3-vector math shared by the orientation
+ * engines.
+ *
+ * Everything is inline so the compiler keeps the elements in registers;
+ * with C++11 the simple operations are constexpr as well. Both types are
+ * 16-byte aligned, so a Quaternion<float> fills exactly one 128-bit SIMD
+ * register. Norms use std::sqrt: its float overload is __builtin_sqrtf,
+ * which the firmware's -fno-builtin leaves alone, so it is a VSQRT on a
+ * single precision FPU rather than a call to sqrtf().
+ *
+ * Quaternions follow the Madgwick convention used by the filters: SEq is
+ * the orientation of the earth frame relative to the sensor frame, a
+ * vector d in the earth frame is q* d q in the sensor frame and the rate
+ * is q' = 0.5 q w.
+ */
+
+#ifndef QUATERNION_H
+#define QUATERNION_H
+
+/**
+ * Includes
+ */
+#include <math.h>
+#include <cmath>
+
+/**
+ * Defines
+ */
+#if __cplusplus >= 201103L
+#define QUATERNION_CONSTEXPR constexpr
+#else
+#define QUATERNION_CONSTEXPR inline
+#endif
+
+#define QUATERNION_ALIGNED __attribute__((aligned(16)))
+
+/**
+ * 3-vector.
+ */
+template <typename T>
+struct QUATERNION_ALIGNED Vec3 {
+
+    T x;
+    T y;
+    T z;
+
+    QUATERNION_CONSTEXPR Vec3() : x(0), y(0), z(0) {}
+    QUATERNION_CONSTEXPR Vec3(T x_, T y_, T z_) : x(x_), y(y_), z(z_) {}
+
+    QUATERNION_CONSTEXPR T dot(const Vec3& v) const {
+        return x * v.x + y * v.y + z * v.z;
+    }
+
+    QUATERNION_CONSTEXPR Vec3 cross(const Vec3& v) const {
+        return Vec3(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x);
+    }
+
+    QUATERNION_CONSTEXPR T squaredNorm(void) const {
+        return x * x + y * y + z * z;
+    }
+
+    T norm(void) const {
+        return std::sqrt(squaredNorm());
+    }
+
+    Vec3 normalized(void) const {
+        return *this / norm();
+    }
+
+};
+
+template <typename T>
+QUATERNION_CONSTEXPR Vec3<T> operator+(const Vec3<T>& a, const Vec3<T>& b) {
+    return Vec3<T>(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+template <typename T>
+QUATERNION_CONSTEXPR Vec3<T> operator-(const Vec3<T>& a, const Vec3<T>& b) {
+    return Vec3<T>(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+template <typename T>
+QUATERNION_CONSTEXPR Vec3<T> operator-(const Vec3<T>& a) {
+    return Vec3<T>(-a.x, -a.y, -a.z);
+}
+
+template <typename T>
+QUATERNION_CONSTEXPR Vec3<T> operator*(const Vec3<T>& a, T s) {
+    return Vec3<T>(a.x * s, a.y * s, a.z * s);
+}
+
+template <typename T>
+QUATERNION_CONSTEXPR Vec3<T> operator*(T s, const Vec3<T>& a) {
+    return Vec3<T>(a.x * s, a.y * s, a.z * s);
+}
+
+template <typename T>
+QUATERNION_CONSTEXPR Vec3<T> operator/(const Vec3<T>& a, T s) {
+    return Vec3<T>(a.x / s, a.y / s, a.z / s);
+}
+
+/**
+ * Quaternion, w + xi + yj + zk.
+ */
+template <typename T>
+struct QUATERNION_ALIGNED Quaternion {
+
+    T w;
+    T x;
+    T y;
+    T z;
+
+    QUATERNION_CONSTEXPR Quaternion() : w(1), x(0), y(0), z(0) {}
+    QUATERNION_CONSTEXPR Quaternion(T w_, T x_, T y_, T z_) : w(w_), x(x_), y(y_), z(z_) {}
+
+    /**
+     * Pure quaternion (0, v).
+     */
+    explicit QUATERNION_CONSTEXPR Quaternion(const Vec3<T>& v) : w(0), x(v.x), y(v.y), z(v.z) {}
+
+    QUATERNION_CONSTEXPR Vec3<T> vec(void) const {
+        return Vec3<T>(x, y, z);
+    }
+
+    QUATERNION_CONSTEXPR Quaternion conjugate(void) const {
+        return Quaternion(w, -x, -y, -z);
+    }
+
+    QUATERNION_CONSTEXPR T dot(const Quaternion& q) const {
+        return w * q.w + x * q.x + y * q.y + z * q.z;
+    }
+
+    QUATERNION_CONSTEXPR T squaredNorm(void) const {
+        return w * w + x * x + y * y + z * z;
+    }
+
+    T norm(void) const {
+        return std::sqrt(squaredNorm());
+    }
+
+    Quaternion normalized(void) const {
+        return *this / norm();
+    }
+
+    /**
+     * Rate of change for the angular rate r in the sensor frame,
+     * 0.5 q (0, r).
+     */
+    QUATERNION_CONSTEXPR Quaternion derivative(const Vec3<T>& r) const;
+
+    /**
+     * Express an earth frame vector in the sensor frame, q* (0, v) q.
+     */
+    QUATERNION_CONSTEXPR Vec3<T> toSensor(const Vec3<T>& v) const {
+        return Vec3<T>(2 * (v.x * (T(0.5) - y * y - z * z) + v.y * (x * y + w * z) + v.z * (x * z - w * y)),
+                       2 * (v.x * (x * y - w * z) + v.y * (T(0.5) - x * x - z * z) + v.z * (w * x + y * z)),
+                       2 * (v.x * (w * y + x * z) + v.y * (y * z - w * x) + v.z * (T(0.5) - x * x - y * y)));
+    }
+
+    /**
+     * Express a sensor frame vector in the earth frame, q (0, v) q*.
+     */
+    QUATERNION_CONSTEXPR Vec3<T> toEarth(const Vec3<T>& v) const {
+        return Vec3<T>(2 * (v.x * (T(0.5) - y * y - z * z) + v.y * (x * y - w * z) + v.z * (x * z + w * y)),
+                       2 * (v.x * (x * y + w * z) + v.y * (T(0.5) - x * x - z * z) + v.z * (y * z - w * x)),
+                       2 * (v.x * (x * z - w * y) + v.y * (y * z + w * x) + v.z * (T(0.5) - x * x - y * y)));
+    }
+
+};
+
+/**
+ * Hamilton product.
+ */
+template <typename T>
+QUATERNION_CONSTEXPR Quaternion<T> operator*(const Quaternion<T>& p, const Quaternion<T>& q) {
+    return Quaternion<T>(p.w * q.w - p.x * q.x - p.y * q.y - p.z * q.z,
+                         p.w * q.x + p.x * q.w + p.y * q.z - p.z * q.y,
+                         p.w * q.y - p.x * q.z + p.y * q.w + p.z * q.x,
+                         p.w * q.z + p.x * q.y - p.y * q.x + p.z * q.w);
+}
+
+/**
+ * Product with the pure quaternion (0, v).
+ */
+template <typename T>
+QUATERNION_CONSTEXPR Quaternion<T> operator*(const Quaternion<T>& p, const Vec3<T>& v) {
+    return Quaternion<T>(-p.x * v.x - p.y * v.y - p.z * v.z,
+                         p.w * v.x + p.y * v.z - p.z * v.y,
+                         p.w * v.y - p.x * v.z + p.z * v.x,
+                         p.w * v.z + p.x * v.y - p.y * v.x);
+}
+
+template <typename T>
+QUATERNION_CONSTEXPR Quaternion<T> operator+(const Quaternion<T>& p, const Quaternion<T>& q) {
+    return Quaternion<T>(p.w + q.w, p.x + q.x, p.y + q.y, p.z + q.z);
+}
+
+template <typename T>
+QUATERNION_CONSTEXPR Quaternion<T> operator-(const Quaternion<T>& p, const Quaternion<T>& q) {
+    return Quaternion<T>(p.w - q.w, p.x - q.x, p.y - q.y, p.z - q.z);
+}
+
+template <typename T>
+QUATERNION_CONSTEXPR Quaternion<T> operator*(const Quaternion<T>& q, T s) {
+    return Quaternion<T>(q.w * s, q.x * s, q.y * s, q.z * s);
+}
+
+template <typename T>
+QUATERNION_CONSTEXPR Quaternion<T> operator*(T s, const Quaternion<T>& q) {
+    return Quaternion<T>(q.w * s, q.x * s, q.y * s, q.z * s);
+}
+
+template <typename T>
+QUATERNION_CONSTEXPR Quaternion<T> operator/(const Quaternion<T>& q, T s) {
+    return Quaternion<T>(q.w / s, q.x / s, q.y / s, q.z / s);
+}
+
+template <typename T>
+QUATERNION_CONSTEXPR Quaternion<T> Quaternion<T>::derivative(const Vec3<T>& r) const {
+    return (*this * T(0.5)) * r;
+}
+
+#endif /* QUATERNION_H */
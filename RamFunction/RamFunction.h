@@ -0,0 +1,63 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Placement of hot functions in on-chip SRAM.
+ *
+ * The LPC1768's flash needs several wait states at 96MHz. Its accelerator
+ * hides most of them for straight line code, but not for the branchy
+ * soft-float routines the filter spends its time in. A function declared
+ * RAMFUNC goes in the .ramfunc section, which the GCC linker script puts
+ * at the end of .data, so the startup code copies it from flash to SRAM
+ * along with the initialised data and it runs from there without wait
+ * states. The linker adds the long branch veneers between flash and SRAM.
+ *
+ * GCC ignores section attributes on template instances, so the Quaternion
+ * and SensorChannel code cannot be marked itself. RAMFUNC flattens the
+ * function instead: everything it calls that can be inlined is, and goes
+ * to SRAM with it.
+ *
+ * Placement is opt-in (make RAMFUNC=1, which defines RAMFUNCS) since it
+ * costs SRAM: the linker script then also puts the libgcc members holding
+ * the double soft-float routines in .ramfunc, by name. Otherwise RAMFUNC
+ * expands to nothing, as it does on the host and with other toolchains.
+ *
+ * Usage:
+ *
+ *   RAMFUNC void MARGfilter::updateFilter(...) {
+ *       ...
+ *   }
+ */
+
+#ifndef RAM_FUNCTION_H
+#define RAM_FUNCTION_H
+
+/**
+ * Defines
+ */
+#if defined(RAMFUNCS) && defined(TOOLCHAIN_GCC_ARM)
+#define RAMFUNC __attribute__((section(".ramfunc"), flatten))
+#else
+#define RAMFUNC
+#endif
+
+#endif /* RAM_FUNCTION_H */
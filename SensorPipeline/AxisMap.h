@@ -0,0 +1,103 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Compile-time axis remapping from a sensor's axes to the board frame.
+ *
+ * Each board axis is given as a signed sensor axis, e.g.
+ *
+ *   AxisMap<AXIS_Y, AXIS_X, -AXIS_Z>
+ *
+ * reads board x from sensor y, board y from sensor x and board z from the
+ * negated sensor z. Index and sign are template arguments, so apply()
+ * compiles down to plain moves and negations with no runtime branching.
+ */
+
+#ifndef AXIS_MAP_H
+#define AXIS_MAP_H
+
+/**
+ * Defines
+ */
+//Signed sensor axes used as AxisMap arguments.
+#define AXIS_X 1
+#define AXIS_Y 2
+#define AXIS_Z 3
+
+/**
+ * One board axis taken from a signed sensor axis.
+ */
+template <int A>
+struct AxisSelect {
+
+    enum { INDEX = (A > 0) ? A - 1 : -A - 1 };
+
+    template <typename T>
+    static T get(const T* sensor) {
+        return (A > 0) ? sensor[INDEX] : -sensor[INDEX];
+    }
+
+};
+
+/**
+ * Sensor to board axis map.
+ */
+template <int X, int Y, int Z>
+struct AxisMap {
+
+    //Every sensor axis must be used exactly once.
+    typedef char axis_map_must_be_a_permutation[
+        ((1 << AxisSelect<X>::INDEX) | (1 << AxisSelect<Y>::INDEX) | (1 << AxisSelect<Z>::INDEX)) == 7 &&
+        AxisSelect<X>::INDEX < 3 && AxisSelect<Y>::INDEX < 3 && AxisSelect<Z>::INDEX < 3 ? 1 : -1];
+
+    /**
+     * Remap one reading.
+     *
+     * @param sensor x, y, z reading in the sensor's axes.
+     * @param board Buffer for the x, y, z reading in the board's axes; must
+     *        not be the same buffer as sensor. It may be of a narrower type,
+     *        e.g. int16_t for raw counts read into ints.
+     */
+    template <typename S, typename T>
+    static void apply(const S* sensor, T* board) {
+        board[0] = (T) AxisSelect<X>::get(sensor);
+        board[1] = (T) AxisSelect<Y>::get(sensor);
+        board[2] = (T) AxisSelect<Z>::get(sensor);
+    }
+
+    /**
+     * Map one reading back from the board frame to the sensor's axes, e.g.
+     * to simulate a sensor from board frame ground truth.
+     *
+     * @param board x, y, z in the board's axes.
+     * @param sensor Buffer for x, y, z in the sensor's axes.
+     */
+    template <typename T>
+    static void invert(const T* board, T* sensor) {
+        sensor[AxisSelect<X>::INDEX] = (X > 0) ? board[0] : -board[0];
+        sensor[AxisSelect<Y>::INDEX] = (Y > 0) ? board[1] : -board[1];
+        sensor[AxisSelect<Z>::INDEX] = (Z > 0) ? board[2] : -board[2];
+    }
+
+};
+
+#endif /* AXIS_MAP_H */
@@ -0,0 +1,255 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Cascaded integrator-comb (CIC) decimator for raw sensor counts.
+ *
+ * Every raw sample is pushed through ORDER integrators; every RATIO-th
+ * sample the integrators are read through ORDER combs and one output is
+ * produced. The response is sinc^ORDER, with nulls at multiples of the
+ * output rate, so much better anti-aliasing than a boxcar average, and the
+ * output rate is exactly the input rate / RATIO.
+ *
+ * Arithmetic is 32-bit and wraps modulo 2^32, which the CIC structure
+ * tolerates as long as the output fits (checked at compile time for 16-bit
+ * input). The output is not normalised: it is GAIN = RATIO^ORDER times the
+ * input, so the caller can fold the division into its own scaling and no
+ * resolution is lost. The group delay is ORDER * (RATIO - 1) / 2 input
+ * samples. After a reset the combs hold zeros, so the first ORDER - 1
+ * outputs would only see part of the input; they are withheld.
+ *
+ * Samples read in bursts, e.g. from a sensor FIFO, can be pushed a block at
+ * a time with pushBlock(), one array per channel. For ORDER 1 and 2 the
+ * integrators then advance over the whole block at once with the kernel in
+ * CicKernel.h (packed SMLAD on the Cortex-M4), so the cost per raw sample
+ * stays low as the oversampling ratio goes up. The outputs are bit for bit
+ * those of push().
+ */
+
+#ifndef CIC_DECIMATOR_H
+#define CIC_DECIMATOR_H
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+#include "CicKernel.h"
+
+/**
+ * Compile-time integer power.
+ */
+template <int BASE, int EXPONENT>
+struct Power {
+    enum { VALUE = BASE * Power<BASE, EXPONENT - 1>::VALUE };
+};
+
+template <int BASE>
+struct Power<BASE, 0> {
+    enum { VALUE = 1 };
+};
+
+/**
+ * CIC decimator for CHANNELS interleaved 16-bit channels.
+ */
+template <int RATIO, int ORDER = 2, int CHANNELS = 3>
+class CicDecimator {
+
+public:
+
+    enum {
+        //Output / input for a constant signal.
+        GAIN = Power<RATIO, ORDER>::VALUE,
+        //Group delay in input samples, times two.
+        GROUP_DELAY_2 = ORDER * (RATIO - 1)
+    };
+
+    //16-bit input times GAIN has to fit in 32 bits.
+    typedef char cic_output_must_fit_32_bits[(GAIN <= 65536) ? 1 : -1];
+    //Block kernel weights go up to RATIO.
+    typedef char cic_ratio_must_fit_kernel[(RATIO <= CIC_KERNEL_MAX_BLOCK) ? 1 : -1];
+
+    /**
+     * Constructor.
+     */
+    CicDecimator() {
+        reset();
+    }
+
+    /**
+     * Clear the filter state and restart the decimation phase.
+     */
+    void reset(void) {
+
+        for (int n = 0; n < ORDER; n++) {
+            for (int c = 0; c < CHANNELS; c++) {
+                integrator[n][c] = 0;
+                comb[n][c] = 0;
+            }
+        }
+        phase = 0;
+        settling = ORDER - 1;
+
+    }
+
+    /**
+     * Push one raw sample.
+     *
+     * @param sample One signed count per channel.
+     * @param output Buffer for one output per channel, written only when an
+     *        output is produced. It is GAIN times the input scale.
+     *
+     * @return true if an output was produced; false while settling after
+     *         a reset.
+     */
+    bool push(const int16_t* sample, int32_t* output) {
+
+        for (int c = 0; c < CHANNELS; c++) {
+            uint32_t x = (uint32_t) (int32_t) sample[c];
+            for (int n = 0; n < ORDER; n++) {
+                integrator[n][c] += x;
+                x = integrator[n][c];
+            }
+        }
+
+        if (++phase < RATIO) {
+            return false;
+        }
+        phase = 0;
+        combs(output);
+
+        return settled();
+
+    }
+
+    /**
+     * Push a block of raw samples.
+     *
+     * @param channels One array of count signed counts per channel, oldest
+     *        first.
+     * @param count Number of samples per channel.
+     * @param output Buffer for up to (phase + count) / RATIO outputs of
+     *        CHANNELS values each, in the layout of push().
+     *
+     * @return Number of outputs produced.
+     */
+    int pushBlock(const int16_t* const* channels, int count, int32_t* output) {
+
+        int outputs = 0;
+
+        for (int i = 0; i < count; ) {
+            //Up to the next output.
+            int k = RATIO - phase;
+            if (k > count - i) {
+                k = count - i;
+            }
+
+            for (int c = 0; c < CHANNELS; c++) {
+                integrate(channels[c] + i, k, c);
+            }
+
+            i += k;
+            phase += k;
+            if (phase == RATIO) {
+                phase = 0;
+                combs(output + outputs * CHANNELS);
+                if (settled()) {
+                    outputs++;
+                }
+            }
+        }
+
+        return outputs;
+
+    }
+
+private:
+
+    /**
+     * Run k samples of channel c through the integrators.
+     */
+    void integrate(const int16_t* x, int k, int c) {
+
+        uint32_t sum = 0;
+        uint32_t weighted = 0;
+
+        if (ORDER == 1) {
+            cicBlockSums(x, k, &sum, 0);
+            integrator[0][c] += sum;
+        } else if (ORDER == 2) {
+            cicBlockSums(x, k, &sum, &weighted);
+            integrator[ORDER - 1][c] += (uint32_t) k * integrator[0][c] + weighted;
+            integrator[0][c] += sum;
+        } else {
+            for (int i = 0; i < k; i++) {
+                uint32_t y = (uint32_t) (int32_t) x[i];
+                for (int n = 0; n < ORDER; n++) {
+                    integrator[n][c] += y;
+                    y = integrator[n][c];
+                }
+            }
+        }
+
+    }
+
+    /**
+     * Count an output off the settling time.
+     *
+     * @return true if the output is good to use.
+     */
+    bool settled(void) {
+
+        if (settling > 0) {
+            settling--;
+            return false;
+        }
+
+        return true;
+
+    }
+
+    /**
+     * Read the integrators through the combs.
+     */
+    void combs(int32_t* output) {
+
+        for (int c = 0; c < CHANNELS; c++) {
+            uint32_t y = integrator[ORDER - 1][c];
+            for (int n = 0; n < ORDER; n++) {
+                uint32_t delayed = comb[n][c];
+                comb[n][c] = y;
+                y -= delayed;
+            }
+            output[c] = (int32_t) y;
+        }
+
+    }
+
+    uint32_t integrator[ORDER][CHANNELS];
+    //Previous input of each comb (differential delay of one output).
+    uint32_t comb[ORDER][CHANNELS];
+    int phase;
+    //Outputs still to be withheld after a reset.
+    int settling;
+
+};
+
+#endif /* CIC_DECIMATOR_H */
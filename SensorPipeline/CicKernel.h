@@ -0,0 +1,169 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Block integration kernel for the CIC decimator.
+ *
+ * Running k samples x[0..k-1] of one channel through the integrators of an
+ * order 1 or 2 CIC filter needs only two sums:
+ *
+ *   sum      = x[0] + x[1] + ... + x[k-1]
+ *   weighted = k x[0] + (k-1) x[1] + ... + 1 x[k-1]
+ *
+ * with I1 += sum and I2 += k I1 + weighted (I1 before the update). Both are
+ * dot products of 16-bit samples with 16-bit weights, which the Cortex-M4
+ * SMLAD instruction does two at a time: one 32-bit load picks up a pair of
+ * samples, one SMLAD against (1, 1) adds them to the sum and one against
+ * the packed pair of weights adds them to the weighted sum.
+ *
+ * The packed kernel is used where the core has the DSP extension
+ * (__ARM_FEATURE_DSP), through the CMSIS __SMLAD intrinsic. Elsewhere the
+ * scalar kernel is used, unless CIC_EMULATE_DSP is defined, which runs the
+ * packed kernel on a portable SMLAD so the host can check it. Both wrap
+ * modulo 2^32 like the decimator itself and give identical results.
+ *
+ * Pairs are loaded as (x[i] low, x[i + 1] high), i.e. little endian.
+ */
+
+#ifndef CIC_KERNEL_H
+#define CIC_KERNEL_H
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+#include <string.h>
+#if defined(__ARM_FEATURE_DSP)
+#include "cmsis.h"
+#endif
+
+/**
+ * Defines
+ */
+#if defined(__ARM_FEATURE_DSP) || defined(CIC_EMULATE_DSP)
+#define CIC_PACKED_KERNEL
+#endif
+
+//Longest block: the weights have to fit a signed 16-bit lane.
+#define CIC_KERNEL_MAX_BLOCK 32767
+
+#if defined(__ARM_FEATURE_DSP)
+#define cicSmlad(x, y, sum) __SMLAD((x), (y), (sum))
+#elif defined(CIC_EMULATE_DSP)
+/**
+ * SMLAD: sum plus the products of the low and of the high signed halves of
+ * x and y, modulo 2^32.
+ */
+static inline uint32_t cicSmlad(uint32_t x, uint32_t y, uint32_t sum) {
+
+    int32_t low = (int32_t) (int16_t) x * (int16_t) y;
+    int32_t high = (int32_t) (int16_t) (x >> 16) * (int16_t) (y >> 16);
+
+    return sum + (uint32_t) low + (uint32_t) high;
+
+}
+#endif
+
+/**
+ * Sum and weighted sum of a block, one sample at a time.
+ *
+ * @param x Samples of one channel.
+ * @param k Number of samples, at most CIC_KERNEL_MAX_BLOCK.
+ * @param sum Incremented by the sum of the samples.
+ * @param weighted Incremented by the weighted sum, or 0 if not needed.
+ */
+static inline void cicBlockSumsScalar(const int16_t* x, int k, uint32_t* sum, uint32_t* weighted) {
+
+    uint32_t s = 0;
+    uint32_t w = 0;
+
+    for (int i = 0; i < k; i++) {
+        s += (uint32_t) (int32_t) x[i];
+        w += (uint32_t) ((int32_t) x[i] * (k - i));
+    }
+
+    *sum += s;
+    if (weighted != 0) {
+        *weighted += w;
+    }
+
+}
+
+#ifdef CIC_PACKED_KERNEL
+/**
+ * Sum and weighted sum of a block, two samples per SMLAD.
+ *
+ * @see cicBlockSumsScalar
+ */
+static inline void cicBlockSumsPacked(const int16_t* x, int k, uint32_t* sum, uint32_t* weighted) {
+
+    uint32_t s = 0;
+    uint32_t w = 0;
+    //Weights k - i and k - i - 1 of the pair at i; both lanes stay
+    //positive, so stepping them is a plain 32-bit subtraction.
+    uint32_t weights = (uint32_t) k | ((uint32_t) (k - 1) << 16);
+    uint32_t pair;
+    int i = 0;
+
+    if (weighted != 0) {
+        for (; i + 1 < k; i += 2) {
+            memcpy(&pair, x + i, sizeof(pair));
+            s = cicSmlad(pair, 0x00010001, s);
+            w = cicSmlad(pair, weights, w);
+            weights -= 0x00020002;
+        }
+    } else {
+        for (; i + 1 < k; i += 2) {
+            memcpy(&pair, x + i, sizeof(pair));
+            s = cicSmlad(pair, 0x00010001, s);
+        }
+    }
+    //Odd sample out, weight 1.
+    if (i < k) {
+        s += (uint32_t) (int32_t) x[i];
+        w += (uint32_t) (int32_t) x[i];
+    }
+
+    *sum += s;
+    if (weighted != 0) {
+        *weighted += w;
+    }
+
+}
+#endif
+
+/**
+ * Sum and weighted sum of a block, with the best kernel for the core.
+ *
+ * @see cicBlockSumsScalar
+ */
+static inline void cicBlockSums(const int16_t* x, int k, uint32_t* sum, uint32_t* weighted) {
+
+#ifdef CIC_PACKED_KERNEL
+    cicBlockSumsPacked(x, k, sum, weighted);
+#else
+    cicBlockSumsScalar(x, k, sum, weighted);
+#endif
+
+}
+
+#endif /* CIC_KERNEL_H */
@@ -0,0 +1,235 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Hard iron calibration of a magnetometer by a sphere fit.
+ *
+ * Without soft iron, every reading of a constant field lies on a sphere
+ * centred on the hard iron bias, whatever the orientation. Readings taken
+ * while the board turns are accumulated as integer sums, cheap enough for
+ * the sensor's interrupt, and solve() fits the sphere to them by linear
+ * least squares:
+ *
+ *   x^2 + y^2 + z^2 = 2 bx x + 2 by y + 2 bz z + (r^2 - |b|^2)
+ *
+ * The earth's field is the radius, so it is kept, unlike a null bias
+ * taken at rest. A fit is only given once the readings span enough of
+ * the sphere on every axis; before that, and with the board still, the
+ * bias is unobservable.
+ */
+
+#ifndef HARD_IRON_FIT_H
+#define HARD_IRON_FIT_H
+
+/**
+ * Includes
+ */
+#include <math.h>
+#include <stdint.h>
+
+/**
+ * Defines
+ */
+//Readings needed before a fit is tried.
+#define HARD_IRON_MIN_SAMPLES 50
+//Span needed on every axis, as a fraction of the field strength.
+#define HARD_IRON_MIN_SPAN 0.25
+
+/**
+ * Sphere fit over magnetometer readings.
+ */
+class HardIronFit {
+
+public:
+
+    /**
+     * Constructor.
+     */
+    HardIronFit() {
+
+        reset();
+
+    }
+
+    /**
+     * Drop every reading.
+     */
+    void reset(void) {
+
+        for (int i = 0; i < 3; i++) {
+            sum[i] = 0;
+            sumT[i] = 0;
+            for (int j = 0; j < 3; j++) {
+                sumProduct[i][j] = 0;
+            }
+            low[i] = 32767;
+            high[i] = -32768;
+        }
+        sumTotal = 0;
+        samples = 0;
+
+    }
+
+    /**
+     * Add one reading.
+     *
+     * @param counts x, y, z counts; the bias comes out in the same axes.
+     */
+    void add(const int16_t* counts) {
+
+        int64_t t = 0;
+
+        for (int i = 0; i < 3; i++) {
+            t += (int32_t) counts[i] * counts[i];
+        }
+        for (int i = 0; i < 3; i++) {
+            sum[i] += counts[i];
+            sumT[i] += t * counts[i];
+            for (int j = i; j < 3; j++) {
+                sumProduct[i][j] += (int32_t) counts[i] * counts[j];
+            }
+            if (counts[i] < low[i]) {
+                low[i] = counts[i];
+            }
+            if (counts[i] > high[i]) {
+                high[i] = counts[i];
+            }
+        }
+        sumTotal += t;
+        samples++;
+
+    }
+
+    /**
+     * Get the number of readings added since the last reset().
+     */
+    int getSamples(void) const {
+
+        return samples;
+
+    }
+
+    /**
+     * Fit the sphere.
+     *
+     * @param bias Buffer for the x, y, z centre, in counts.
+     * @param radius Set to the radius, the field strength in counts.
+     *
+     * @return false if there are too few readings, they do not span
+     *         enough of the sphere or the fit is degenerate; the outputs
+     *         are left alone.
+     */
+    bool solve(double* bias, double* radius) const {
+
+        //Normal equations of (x, y, z, 1) u = x^2 + y^2 + z^2.
+        double a[4][5];
+
+        if (samples < HARD_IRON_MIN_SAMPLES) {
+            return false;
+        }
+
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                a[i][j] = (double) (i <= j ? sumProduct[i][j] : sumProduct[j][i]);
+            }
+            a[i][3] = (double) sum[i];
+            a[3][i] = (double) sum[i];
+            a[i][4] = (double) sumT[i];
+        }
+        a[3][3] = (double) samples;
+        a[3][4] = (double) sumTotal;
+
+        //Gaussian elimination with partial pivoting.
+        for (int k = 0; k < 4; k++) {
+            int pivot = k;
+            for (int i = k + 1; i < 4; i++) {
+                if (fabs(a[i][k]) > fabs(a[pivot][k])) {
+                    pivot = i;
+                }
+            }
+            if (a[pivot][k] == 0.0) {
+                return false;
+            }
+            for (int j = k; j < 5; j++) {
+                double swap = a[k][j];
+                a[k][j] = a[pivot][j];
+                a[pivot][j] = swap;
+            }
+            for (int i = k + 1; i < 4; i++) {
+                double f = a[i][k] / a[k][k];
+                for (int j = k; j < 5; j++) {
+                    a[i][j] -= f * a[k][j];
+                }
+            }
+        }
+        double u[4];
+        for (int k = 3; k >= 0; k--) {
+            double x = a[k][4];
+            for (int j = k + 1; j < 4; j++) {
+                x -= a[k][j] * u[j];
+            }
+            u[k] = x / a[k][k];
+        }
+
+        double centre[3] = {0.5 * u[0], 0.5 * u[1], 0.5 * u[2]};
+        double squared = u[3] + centre[0] * centre[0] + centre[1] * centre[1] + centre[2] * centre[2];
+        if (!(squared > 0.0)) {
+            return false;
+        }
+        double r = sqrt(squared);
+        //Noise at rest fits a small sphere, so spans are also held against
+        //the rms magnitude of the readings, which a bias smaller than the
+        //field leaves at roughly the field strength.
+        double scale = sqrt((double) sumTotal / samples);
+        if (scale < r) {
+            scale = r;
+        }
+        for (int i = 0; i < 3; i++) {
+            if (high[i] - low[i] < HARD_IRON_MIN_SPAN * scale) {
+                return false;
+            }
+        }
+
+        for (int i = 0; i < 3; i++) {
+            bias[i] = centre[i];
+        }
+        *radius = r;
+
+        return true;
+
+    }
+
+private:
+
+    //Sums of the readings, their products, and t = x^2 + y^2 + z^2 and
+    //its products with them; sumProduct is upper triangular.
+    int64_t sum[3];
+    int64_t sumProduct[3][3];
+    int64_t sumT[3];
+    int64_t sumTotal;
+    int16_t low[3];
+    int16_t high[3];
+    int samples;
+
+};
+
+#endif /* HARD_IRON_FIT_H */
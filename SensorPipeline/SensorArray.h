@@ -0,0 +1,273 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Front end for an array of identical sensors read as one.
+ *
+ * Every member is the same part mounted the same way, so its readings are
+ * in the same sensor axes. The caller reads the members in turn, staggered
+ * over the sample period so the reads spread evenly over the buses, adds
+ * each reading as it arrives and combines the latest readings once per
+ * period, typically when the last member's read completes. A member whose
+ * read failed is left out of that round.
+ *
+ * Readings are combined per axis in integer counts, either as the rounded
+ * mean (ArrayMean), which cuts independent noise by about the square root
+ * of the number of members, or as the median (ArrayMedian), which with
+ * three or more members outvotes one member reading wildly off. The
+ * result goes into a single SensorChannel like the reading of one sensor.
+ * Staggering delays the combined reading by about half a sample period on
+ * average.
+ *
+ * Members do not share a bias, and the median would jump between their
+ * biases as the order of the readings changes, so each member is aligned
+ * to the mean of all of them by an offset, in fractional counts, from a
+ * calibration at rest. While calibrating, combine() gives the plain mean,
+ * which is what the aligned members average to, so SensorChannel can be
+ * calibrated on the same readings for the common bias.
+ */
+
+#ifndef SENSOR_ARRAY_H
+#define SENSOR_ARRAY_H
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+
+/**
+ * Defines
+ */
+//Fractional bits of the members' offsets.
+#define SENSOR_ARRAY_FRACTION_BITS 8
+
+/**
+ * Rounded mean of the members' readings of one axis.
+ */
+struct ArrayMean {
+
+    static int32_t combine(int32_t* values, int count) {
+
+        int32_t sum = 0;
+
+        for (int i = 0; i < count; i++) {
+            sum += values[i];
+        }
+
+        return (sum + (sum >= 0 ? count / 2 : -count / 2)) / count;
+
+    }
+
+};
+
+/**
+ * Median of the members' readings of one axis, the rounded mean of the
+ * middle two for an even count.
+ */
+struct ArrayMedian {
+
+    static int32_t combine(int32_t* values, int count) {
+
+        //Insertion sort, as there are only a handful of members.
+        for (int i = 1; i < count; i++) {
+            int32_t value = values[i];
+            int j = i;
+            for (; j > 0 && values[j - 1] > value; j--) {
+                values[j] = values[j - 1];
+            }
+            values[j] = value;
+        }
+
+        if (count & 1) {
+            return values[count / 2];
+        }
+
+        int32_t sum = values[count / 2 - 1] + values[count / 2];
+        return (sum + (sum >= 0 ? 1 : -1)) / 2;
+
+    }
+
+};
+
+/**
+ * Readings of MEMBERS identical triple-axis sensors, combined by Combiner.
+ */
+template <int MEMBERS, class Combiner>
+class SensorArray {
+
+    typedef char sensor_array_needs_members[MEMBERS > 0 ? 1 : -1];
+
+public:
+
+    /**
+     * Constructor.
+     */
+    SensorArray() : calibrating(false) {
+
+        for (int m = 0; m < MEMBERS; m++) {
+            for (int c = 0; c < 3; c++) {
+                reading[m][c] = 0;
+                offset[m][c] = 0;
+                calibrationSum[m][c] = 0;
+            }
+            calibrationCount[m] = 0;
+            fresh[m] = false;
+        }
+
+    }
+
+    /**
+     * Add one member's reading.
+     *
+     * @param member The member, 0 to MEMBERS - 1.
+     * @param raw x, y, z counts in the sensor's axes, as read from the
+     *        driver (only the low 16 bits are used).
+     */
+    void add(int member, const int* raw) {
+
+        for (int c = 0; c < 3; c++) {
+            reading[member][c] = (int16_t) raw[c];
+        }
+        fresh[member] = true;
+
+        if (calibrating) {
+            for (int c = 0; c < 3; c++) {
+                calibrationSum[member][c] += reading[member][c];
+            }
+            calibrationCount[member]++;
+        }
+
+    }
+
+    /**
+     * Combine the readings added since the last call, one per member at
+     * most.
+     *
+     * @param output Buffer for the combined x, y, z counts in the sensor's
+     *        axes; left alone if no member has a new reading.
+     *
+     * @return The number of members combined.
+     */
+    int combine(int* output) {
+
+        int32_t values[MEMBERS];
+        int count = 0;
+
+        for (int c = 0; c < 3; c++) {
+            count = 0;
+            for (int m = 0; m < MEMBERS; m++) {
+                if (fresh[m]) {
+                    values[count++] = ((int32_t) reading[m][c] << SENSOR_ARRAY_FRACTION_BITS) - offset[m][c];
+                }
+            }
+            if (count == 0) {
+                return 0;
+            }
+            int32_t value = calibrating ? ArrayMean::combine(values, count) : Combiner::combine(values, count);
+            //Back to whole counts, rounded; a 32 bit division by a power of
+            //two, so it stays cheap in an interrupt.
+            value = (value + (value >= 0 ? 1 : -1) * (1 << (SENSOR_ARRAY_FRACTION_BITS - 1))) / (1 << SENSOR_ARRAY_FRACTION_BITS);
+            output[c] = value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+        }
+
+        for (int m = 0; m < MEMBERS; m++) {
+            fresh[m] = false;
+        }
+
+        return count;
+
+    }
+
+    /**
+     * Start collecting readings taken at rest for aligning the members,
+     * dropping the offsets until they are aligned again.
+     */
+    void startCalibration(void) {
+
+        for (int m = 0; m < MEMBERS; m++) {
+            for (int c = 0; c < 3; c++) {
+                offset[m][c] = 0;
+                calibrationSum[m][c] = 0;
+            }
+            calibrationCount[m] = 0;
+        }
+        calibrating = true;
+
+    }
+
+    /**
+     * Set each member's offset to its mean reading less the mean of all
+     * the members' means. Members with no readings are left out and get
+     * no offset.
+     */
+    void finishCalibration(void) {
+
+        int64_t mean[MEMBERS];
+
+        calibrating = false;
+
+        for (int c = 0; c < 3; c++) {
+            int64_t sum = 0;
+            int counted = 0;
+            for (int m = 0; m < MEMBERS; m++) {
+                if (calibrationCount[m] > 0) {
+                    mean[m] = divideRounded((int64_t) calibrationSum[m][c] << SENSOR_ARRAY_FRACTION_BITS, calibrationCount[m]);
+                    sum += mean[m];
+                    counted++;
+                }
+            }
+            if (counted == 0) {
+                continue;
+            }
+            int64_t arrayMean = divideRounded(sum, counted);
+            for (int m = 0; m < MEMBERS; m++) {
+                if (calibrationCount[m] > 0) {
+                    offset[m][c] = (int32_t) (mean[m] - arrayMean);
+                }
+            }
+        }
+
+    }
+
+private:
+
+    static int64_t divideRounded(int64_t x, int64_t divisor) {
+
+        return (x + (x >= 0 ? divisor / 2 : -divisor / 2)) / divisor;
+
+    }
+
+    //Latest reading of each member, and whether it is new since the last
+    //combine().
+    int16_t reading[MEMBERS][3];
+    bool fresh[MEMBERS];
+    //Offset of each member from the array's mean, in counts with
+    //SENSOR_ARRAY_FRACTION_BITS fractional bits.
+    int32_t offset[MEMBERS][3];
+
+    bool calibrating;
+    int32_t calibrationSum[MEMBERS][3];
+    int32_t calibrationCount[MEMBERS];
+
+};
+
+#endif /* SENSOR_ARRAY_H */
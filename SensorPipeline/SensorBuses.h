@@ -0,0 +1,102 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Which I2C bus each sensor is wired to.
+ *
+ * The board has two buses: p28/p27, which is I2C2 on the LPC1768 mbed, and
+ * p9/p10, which is I2C1. By default the accelerometer and gyroscope share
+ * the first and the magnetometer has the second to itself, so its reads
+ * run concurrently with theirs and never hold up a gyroscope sample.
+ * Build with ONE_BUS=1 (which defines SENSORS_ON_ONE_BUS) for the original
+ * wiring with every sensor on p28/p27, or move a single sensor with e.g.
+ * -DGYROSCOPE_BUS=1.
+ *
+ * With IMUS=n (IMU_COUNT) the accelerometer and gyroscope are an array of
+ * n IMUs, see SensorArray.h. The ADXL345 and ITG-3200 each have two
+ * addresses, so a bus takes two IMUs: IMU k is on the first IMU's buses
+ * when k is even and on the other bus when it is odd, at the alternate
+ * addresses from IMU 2 on. That is four IMUs on two buses, or two on one.
+ *
+ * The pins are mbed PinNames, so include mbed.h first.
+ */
+
+#ifndef SENSOR_BUSES_H
+#define SENSOR_BUSES_H
+
+/**
+ * Defines
+ */
+//Pins of the two buses.
+#define SENSOR_BUS0_SDA p28
+#define SENSOR_BUS0_SCL p27
+#define SENSOR_BUS1_SDA p9
+#define SENSOR_BUS1_SCL p10
+
+//Bus of each sensor, 0 or 1.
+#ifndef ACCELEROMETER_BUS
+#define ACCELEROMETER_BUS 0
+#endif
+#ifndef GYROSCOPE_BUS
+#define GYROSCOPE_BUS 0
+#endif
+#ifndef MAGNETOMETER_BUS
+#ifdef SENSORS_ON_ONE_BUS
+#define MAGNETOMETER_BUS 0
+#else
+#define MAGNETOMETER_BUS 1
+#endif
+#endif
+
+//IMUs in the array.
+#ifndef IMU_COUNT
+#define IMU_COUNT 1
+#endif
+
+//Whether IMU k is on the other bus, and at the alternate addresses.
+#ifdef SENSORS_ON_ONE_BUS
+#define IMU_OTHER_BUS(k) 0
+#define IMU_ALTERNATE(k) ((k) & 1)
+#define IMU_MAX_COUNT 2
+#else
+#define IMU_OTHER_BUS(k) ((k) & 1)
+#define IMU_ALTERNATE(k) ((k) >> 1)
+#define IMU_MAX_COUNT 4
+#endif
+
+#if IMU_COUNT < 1 || IMU_COUNT > IMU_MAX_COUNT
+#error "IMU_COUNT does not fit on the buses, see SensorBuses.h"
+#endif
+
+//Buses of IMU k's accelerometer and gyroscope.
+#define IMU_ACCELEROMETER_BUS(k) (ACCELEROMETER_BUS ^ IMU_OTHER_BUS(k))
+#define IMU_GYROSCOPE_BUS(k) (GYROSCOPE_BUS ^ IMU_OTHER_BUS(k))
+
+//Number of buses in use; bus 1 is left alone when no sensor is on it.
+#define SENSOR_BUSES (1 + (ACCELEROMETER_BUS | GYROSCOPE_BUS | MAGNETOMETER_BUS | \
+                           (IMU_COUNT > 1 ? IMU_OTHER_BUS(1) : 0)))
+
+//Pins of bus n.
+#define SENSOR_BUS_SDA(n) ((n) ? SENSOR_BUS1_SDA : SENSOR_BUS0_SDA)
+#define SENSOR_BUS_SCL(n) ((n) ? SENSOR_BUS1_SCL : SENSOR_BUS0_SCL)
+
+#endif /* SENSOR_BUSES_H */
@@ -0,0 +1,206 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Integer-domain conditioning of one triple-axis sensor.
+ *
+ * Raw counts are remapped into the board frame (AxisMap), decimated
+ * (CicDecimator) and bias-corrected as integers. Only the final value is
+ * converted to the filter's scalar type, with a single multiply by a scale
+ * that folds together the decimator gain, the sensor sensitivity and any
+ * unit conversion. On a soft-float core that is one int to float
+ * conversion and one multiply per axis per output, instead of floating
+ * point work on every raw sample.
+ */
+
+#ifndef SENSOR_CHANNEL_H
+#define SENSOR_CHANNEL_H
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+
+/**
+ * Conditioning pipeline for one sensor.
+ */
+template <class Axes, class Decimator, typename Scalar>
+class SensorChannel {
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param unitsPerCount Sensitivity of the sensor, in the units the
+     *        filter expects per raw count (e.g. rad/s per LSB).
+     */
+    SensorChannel(double unitsPerCount) : scale((Scalar) (unitsPerCount / Decimator::GAIN)) {
+
+        for (int c = 0; c < 3; c++) {
+            bias[c] = 0;
+            calibrationSum[c] = 0;
+            value[c] = 0;
+            last[c] = 0;
+        }
+        calibrationCount = 0;
+
+    }
+
+    /**
+     * Push one raw reading.
+     *
+     * @param raw x, y, z counts in the sensor's axes, as read from the
+     *        driver (only the low 16 bits are used).
+     *
+     * @return true if a new conditioned output is available.
+     */
+    bool push(const int* raw) {
+
+        int32_t decimated[3];
+
+        Axes::apply(raw, last);
+        if (!decimator.push(last, decimated)) {
+            return false;
+        }
+
+        value[0] = (Scalar) (decimated[0] - bias[0]) * scale;
+        value[1] = (Scalar) (decimated[1] - bias[1]) * scale;
+        value[2] = (Scalar) (decimated[2] - bias[2]) * scale;
+
+        return true;
+
+    }
+
+    /**
+     * Get the last conditioned output.
+     *
+     * @param output Buffer for the x, y, z values in the board frame, in
+     *        the units given to the constructor.
+     */
+    void getOutput(Scalar* output) const {
+
+        output[0] = value[0];
+        output[1] = value[1];
+        output[2] = value[2];
+
+    }
+
+    /**
+     * Get the last raw reading.
+     *
+     * @param counts Buffer for the x, y, z counts in the board frame.
+     */
+    void getCounts(int16_t* counts) const {
+
+        counts[0] = last[0];
+        counts[1] = last[1];
+        counts[2] = last[2];
+
+    }
+
+    /**
+     * Start collecting samples for a null bias calculation.
+     */
+    void startCalibration(void) {
+
+        for (int c = 0; c < 3; c++) {
+            calibrationSum[c] = 0;
+        }
+        calibrationCount = 0;
+
+    }
+
+    /**
+     * Add one raw reading taken while the sensor is stationary.
+     *
+     * @param raw x, y, z counts in the sensor's axes.
+     */
+    void addCalibrationSample(const int* raw) {
+
+        int16_t board[3];
+
+        Axes::apply(raw, board);
+        calibrationSum[0] += board[0];
+        calibrationSum[1] += board[1];
+        calibrationSum[2] += board[2];
+        calibrationCount++;
+
+    }
+
+    /**
+     * Compute the bias from the collected samples.
+     *
+     * @param expected x, y, z counts in the board frame the sensor should
+     *        read while calibrating (e.g. 1g on z), or 0 for none.
+     */
+    void finishCalibration(const int* expected) {
+
+        if (calibrationCount == 0) {
+            return;
+        }
+
+        //Bias in decimator output units, rounded, so the average keeps its
+        //fractional counts.
+        for (int c = 0; c < 3; c++) {
+            int64_t offset = calibrationSum[c] - (int64_t) (expected ? expected[c] : 0) * calibrationCount;
+            int64_t scaled = offset * Decimator::GAIN;
+            bias[c] = (int32_t) ((scaled + (scaled >= 0 ? calibrationCount / 2 : -calibrationCount / 2)) / calibrationCount);
+        }
+
+        decimator.reset();
+
+    }
+
+    /**
+     * Set the bias from an estimate made elsewhere, e.g. a hard iron fit.
+     *
+     * @param counts x, y, z bias in counts in the board frame.
+     */
+    void setBias(const double* counts) {
+
+        for (int c = 0; c < 3; c++) {
+            double scaled = counts[c] * Decimator::GAIN;
+            bias[c] = (int32_t) (scaled >= 0 ? scaled + 0.5 : scaled - 0.5);
+        }
+
+    }
+
+private:
+
+    Decimator decimator;
+
+    //Null bias in decimator output units.
+    int32_t bias[3];
+    //Decimator gain, sensitivity and unit conversion in one factor.
+    Scalar scale;
+
+    int32_t calibrationSum[3];
+    int32_t calibrationCount;
+
+    Scalar value[3];
+    //Last raw reading, in the board frame.
+    int16_t last[3];
+
+};
+
+#endif /* SENSOR_CHANNEL_H */
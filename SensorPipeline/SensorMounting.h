@@ -0,0 +1,57 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * How the sensors are mounted on each supported board.
+ *
+ * Select the board with MOUNTING=<name> on the make command line, which
+ * defines MOUNTING_<name>. Every board defines one AxisMap per sensor
+ * that takes its raw readings into the common board frame (x forward,
+ * y sideways, z up).
+ */
+
+#ifndef SENSOR_MOUNTING_H
+#define SENSOR_MOUNTING_H
+
+/**
+ * Includes
+ */
+#include "AxisMap.h"
+
+#if defined(MOUNTING_ALIGNED)
+
+//All sensors already aligned with the board.
+typedef AxisMap<AXIS_X, AXIS_Y, AXIS_Z> AccelerometerAxes;
+typedef AxisMap<AXIS_X, AXIS_Y, AXIS_Z> GyroscopeAxes;
+typedef AxisMap<AXIS_X, AXIS_Y, AXIS_Z> MagnetometerAxes;
+
+#else
+
+//Default: the original ADXL345/ITG3200/HMC5843 stack, where the filter is
+//fed with the x and y axes of every sensor swapped.
+typedef AxisMap<AXIS_Y, AXIS_X, AXIS_Z> AccelerometerAxes;
+typedef AxisMap<AXIS_Y, AXIS_X, AXIS_Z> GyroscopeAxes;
+typedef AxisMap<AXIS_Y, AXIS_X, AXIS_Z> MagnetometerAxes;
+
+#endif
+
+#endif /* SENSOR_MOUNTING_H */
@@ -0,0 +1,141 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Serial port with a non-blocking transmit queue.
+ */
+
+/**
+ * Includes
+ */
+#include "SerialQueue.h"
+
+//Compile time check that the buffer size is a power of two.
+typedef char SerialQueueSizeIsPowerOfTwo[((SERIAL_QUEUE_SIZE & (SERIAL_QUEUE_SIZE - 1)) == 0) ? 1 : -1];
+
+SerialQueue::SerialQueue(PinName tx, PinName rx) : Serial(tx, rx) {
+
+    head = 0;
+    tail = 0;
+    transmitting = false;
+    drops = 0;
+    frames = 0;
+    highWater = 0;
+
+    attach(this, &SerialQueue::transmit, Serial::TxIrq);
+
+}
+
+bool SerialQueue::enqueue(const uint8_t* data, int length) {
+
+    uint32_t start = head;
+    int used = (int) (start - tail);
+
+    if (length > SERIAL_QUEUE_SIZE - used) {
+        drops++;
+        return false;
+    }
+
+    for (int i = 0; i < length; i++) {
+        buffer[(start + i) & (SERIAL_QUEUE_SIZE - 1)] = data[i];
+    }
+
+    //Publish the bytes only once they are all in the buffer; both are
+    //volatile so the compiler keeps this order.
+    head = start + length;
+
+    frames++;
+    if (used + length > highWater) {
+        highWater = used + length;
+    }
+
+    //If the UART is idle no interrupt is coming, so start it here. The
+    //caller may already have interrupts masked; leave them as they were.
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (!transmitting) {
+        fill();
+    }
+    if (primask == 0) {
+        __enable_irq();
+    }
+
+    return true;
+
+}
+
+uint32_t SerialQueue::getDrops(void) {
+
+    return drops;
+
+}
+
+uint32_t SerialQueue::getFrames(void) {
+
+    return frames;
+
+}
+
+int SerialQueue::getHighWater(void) {
+
+    return highWater;
+
+}
+
+int SerialQueue::pending(void) {
+
+    return (int) (head - tail);
+
+}
+
+void SerialQueue::transmit(void) {
+
+    fill();
+
+}
+
+void SerialQueue::fill(void) {
+
+    uint32_t index = tail;
+    uint32_t end = head;
+
+    if (index == end) {
+        //Nothing left and the UART is empty; the next enqueue restarts it.
+        transmitting = false;
+        return;
+    }
+
+#ifdef SERIAL_QUEUE_FIFO_DEPTH
+    //The interrupt means the whole FIFO is empty.
+    for (int i = 0; i < SERIAL_QUEUE_FIFO_DEPTH && index != end; i++) {
+        _serial.uart->THR = buffer[index++ & (SERIAL_QUEUE_SIZE - 1)];
+    }
+#else
+    while (index != end && serial_writable(&_serial)) {
+        serial_putc(&_serial, buffer[index++ & (SERIAL_QUEUE_SIZE - 1)]);
+    }
+#endif
+
+    tail = index;
+    transmitting = true;
+
+}
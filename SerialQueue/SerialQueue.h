@@ -0,0 +1,127 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Serial port with a non-blocking transmit queue.
+ *
+ * Frames are copied into a ring buffer and sent from the UART's transmit
+ * holding register empty interrupt, so queuing a frame costs a copy rather
+ * than the time it takes to send it. On the LPC17xx/LPC408x the UART has a
+ * 16 byte transmit FIFO, so each interrupt refills the whole FIFO: at
+ * 921600 baud that is one interrupt every ~170us.
+ *
+ * A frame is either queued whole or dropped, never truncated, and drops
+ * are counted so the host can tell backpressure from link errors.
+ */
+
+#ifndef SERIAL_QUEUE_H
+#define SERIAL_QUEUE_H
+
+/**
+ * Includes
+ */
+#include "mbed.h"
+
+/**
+ * Defines
+ */
+//Bytes in the transmit ring buffer; must be a power of two.
+#ifndef SERIAL_QUEUE_SIZE
+#define SERIAL_QUEUE_SIZE 1024
+#endif
+//Bytes that can be written to the UART once it reports empty.
+#if defined(TARGET_LPC1768) || defined(TARGET_LPC4088)
+#define SERIAL_QUEUE_FIFO_DEPTH 16
+#endif
+
+/**
+ * Serial port with an interrupt driven transmit queue.
+ */
+class SerialQueue : public Serial {
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param tx Transmit pin.
+     * @param rx Receive pin.
+     */
+    SerialQueue(PinName tx, PinName rx);
+
+    /**
+     * Queue a frame for transmission, without waiting.
+     *
+     * Safe to call from the main loop or from an interrupt of lower
+     * priority than the UART's; there must be only one caller at a time.
+     * Interrupts masked by the caller stay masked.
+     *
+     * @param data Bytes to send.
+     * @param length Number of bytes.
+     *
+     * @return true if the frame was queued, false if there was not enough
+     *         room and it was dropped.
+     */
+    bool enqueue(const uint8_t* data, int length);
+
+    /**
+     * Number of frames dropped because the queue was full.
+     */
+    uint32_t getDrops(void);
+
+    /**
+     * Number of frames queued.
+     */
+    uint32_t getFrames(void);
+
+    /**
+     * Most bytes that have been waiting in the queue at once.
+     */
+    int getHighWater(void);
+
+    /**
+     * Number of bytes waiting to be sent.
+     */
+    int pending(void);
+
+private:
+
+    //Transmit holding register empty interrupt.
+    void transmit(void);
+    //Move bytes from the ring buffer to the UART.
+    void fill(void);
+
+    volatile uint8_t buffer[SERIAL_QUEUE_SIZE];
+    //Free running indices; head is only written by enqueue, tail only by
+    //the interrupt.
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    //Bytes have been written to the UART and its interrupt will follow.
+    volatile bool transmitting;
+
+    uint32_t drops;
+    uint32_t frames;
+    int highWater;
+
+};
+
+#endif /* SERIAL_QUEUE_H */
@@ -0,0 +1,92 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Consistent Overhead Byte Stuffing.
+ */
+
+/**
+ * Includes
+ */
+#include "Cobs.h"
+
+size_t cobsEncode(const uint8_t* input, size_t length, uint8_t* output) {
+
+    //Each block starts with a code byte: the distance to the next zero, or
+    //0xFF for 254 non-zero bytes with no implied zero.
+    size_t code = 0;
+    size_t out = 1;
+    uint8_t run = 1;
+
+    for (size_t i = 0; i < length; i++) {
+
+        if (input[i] == 0) {
+            output[code] = run;
+            code = out++;
+            run = 1;
+        } else {
+            output[out++] = input[i];
+            if (++run == 0xFF) {
+                output[code] = run;
+                code = out++;
+                run = 1;
+            }
+        }
+
+    }
+
+    output[code] = run;
+
+    return out;
+
+}
+
+size_t cobsDecode(const uint8_t* input, size_t length, uint8_t* output) {
+
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < length) {
+
+        uint8_t run = input[in++];
+
+        if (run == 0 || in + run - 1 > length) {
+            return 0;
+        }
+
+        for (uint8_t i = 1; i < run; i++) {
+            if (input[in] == 0) {
+                return 0;
+            }
+            output[out++] = input[in++];
+        }
+
+        //The zero implied by a short block, except at the end of the data.
+        if (run != 0xFF && in < length) {
+            output[out++] = 0;
+        }
+
+    }
+
+    return out;
+
+}
@@ -0,0 +1,68 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Consistent Overhead Byte Stuffing.
+ *
+ * Removes every 0x00 from a buffer at a cost of at most one byte per 254,
+ * so 0x00 can be used as an unambiguous frame delimiter.
+ *
+ * Reference:
+ *
+ * S. Cheshire and M. Baker, "Consistent Overhead Byte Stuffing",
+ * IEEE/ACM Transactions on Networking, 1999.
+ */
+
+#ifndef COBS_H
+#define COBS_H
+
+/**
+ * Includes
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * COBS encode a buffer.
+ *
+ * @param input Data to encode.
+ * @param length Number of bytes in input.
+ * @param output Buffer of at least length + length / 254 + 1 bytes. The
+ *        delimiter is not appended.
+ *
+ * @return Number of bytes written to output.
+ */
+size_t cobsEncode(const uint8_t* input, size_t length, uint8_t* output);
+
+/**
+ * COBS decode a buffer, not including the delimiter.
+ *
+ * @param input Encoded data.
+ * @param length Number of bytes in input.
+ * @param output Buffer of at least length bytes; may be the same as input.
+ *
+ * @return Number of bytes written to output, or 0 if input is not valid
+ *         COBS.
+ */
+size_t cobsDecode(const uint8_t* input, size_t length, uint8_t* output);
+
+#endif /* COBS_H */
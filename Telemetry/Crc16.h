@@ -0,0 +1,53 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * CRC-16/CCITT-FALSE: polynomial 0x1021, initial value 0xFFFF, no
+ * reflection, no final XOR. The check value for "123456789" is 0x29B1.
+ */
+
+#ifndef CRC16_H
+#define CRC16_H
+
+/**
+ * Includes
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Defines
+ */
+#define CRC16_INITIAL 0xFFFF
+
+/**
+ * Update a CRC with more data.
+ *
+ * @param crc CRC so far, CRC16_INITIAL to start.
+ * @param data Data to add.
+ * @param length Number of bytes in data.
+ *
+ * @return The updated CRC.
+ */
+uint16_t crc16(uint16_t crc, const uint8_t* data, size_t length);
+
+#endif /* CRC16_H */
@@ -0,0 +1,240 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Binary telemetry protocol shared by the firmware encoder and the host
+ * decoder.
+ *
+ * A frame is a header, one or more payload records and a CRC, COBS encoded
+ * and terminated by a 0x00 byte. COBS guarantees 0x00 never appears inside
+ * a frame, so a receiver resynchronises at the next delimiter without
+ * dropping anything that follows.
+ *
+ * Before COBS encoding, with all fields little-endian:
+ *
+ *   version   u8    TELEMETRY_VERSION
+ *   flags     u8    reserved, 0
+ *   sequence  u16   incremented for every frame sent
+ *   timestamp u32   microseconds since start-up
+ *   records         repeated: type u8, length u8, length bytes of payload
+ *   crc       u16   CRC-16/CCITT-FALSE over everything above
+ *
+ * Receivers skip record types they do not know, so payloads can be added
+ * without bumping the version; changing an existing layout must bump it.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+/**
+ * Includes
+ */
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Defines
+ */
+#define TELEMETRY_VERSION 1
+
+//Frame delimiter after COBS encoding.
+#define TELEMETRY_DELIMITER 0x00
+
+#define TELEMETRY_HEADER_SIZE 8
+#define TELEMETRY_RECORD_HEADER_SIZE 2
+#define TELEMETRY_CRC_SIZE 2
+
+//Largest unencoded frame, header and CRC included.
+#define TELEMETRY_MAX_FRAME 192
+//COBS adds one byte per 254 plus the leading code, then the delimiter.
+#define TELEMETRY_MAX_ENCODED_FRAME (TELEMETRY_MAX_FRAME + TELEMETRY_MAX_FRAME / 254 + 2)
+
+//Record types.
+#define TELEMETRY_QUATERNION  0x01 //float w, x, y, z.
+#define TELEMETRY_EULER       0x02 //float roll, pitch, yaw in radians.
+#define TELEMETRY_RAW_SENSORS 0x03 //int16 a, w, m x, y, z in board frame counts.
+#define TELEMETRY_DIAGNOSTICS 0x04 //TelemetryDiagnostics.
+#define TELEMETRY_STREAM_STATISTICS 0x05 //Per stream: u8 type, u32 sent, u32 dropped.
+#define TELEMETRY_PROFILE     0x06 //TelemetryProfile.
+#define TELEMETRY_JOB         0x07 //TelemetryJob.
+#define TELEMETRY_EVENTS      0x08 //u32 idle, u32 elapsed us, then per event TelemetryEventStatistics.
+#define TELEMETRY_BUS         0x09 //TelemetryBus.
+
+#define TELEMETRY_QUATERNION_SIZE  16
+#define TELEMETRY_EULER_SIZE       12
+#define TELEMETRY_RAW_SENSORS_SIZE 18
+#define TELEMETRY_DIAGNOSTICS_SIZE 20
+#define TELEMETRY_STREAM_STATISTICS_ENTRY_SIZE 9
+#define TELEMETRY_PROFILE_SIZE     61
+#define TELEMETRY_JOB_SIZE         65
+#define TELEMETRY_EVENTS_HEADER_SIZE 8
+#define TELEMETRY_EVENTS_ENTRY_SIZE  14
+#define TELEMETRY_BUS_SIZE         30
+
+//Profile zone names are padded with zeros, not terminated, when 8 long.
+#define TELEMETRY_PROFILE_NAME_SIZE 8
+//Profile histogram bin i counts durations of 2^(i + 6) up to 2^(i + 7)
+//ticks; the first and last bins also take everything shorter and longer.
+#define TELEMETRY_PROFILE_BINS      16
+#define TELEMETRY_PROFILE_FIRST_BIN 6
+//Job lateness histogram bin i counts runs 2^i up to 2^(i + 1) us late;
+//the first and last bins also take everything earlier and later.
+#define TELEMETRY_JOB_BINS          16
+
+//Most streams a TelemetryScheduler can carry.
+#define TELEMETRY_MAX_STREAMS 10
+//Most events in a TELEMETRY_EVENTS record.
+#define TELEMETRY_MAX_EVENTS 8
+
+/**
+ * Filter state that is useful when tuning, sent as TELEMETRY_DIAGNOSTICS.
+ */
+struct TelemetryDiagnostics {
+    //Effective filter gain (beta for the MARG filter).
+    float gain;
+    //Estimated gyroscope bias in rad/s, 0 if the engine does not track it.
+    float gyroBias[3];
+    //Number of filter updates since start-up.
+    uint32_t updates;
+};
+
+/**
+ * Counters for one scheduled stream, sent as TELEMETRY_STREAM_STATISTICS.
+ */
+struct TelemetryStreamStatistics {
+    //Record type carried by the stream.
+    uint8_t type;
+    //Records sent and dropped since start-up.
+    uint32_t sent;
+    uint32_t dropped;
+};
+
+/**
+ * Execution time of one profiling zone since its previous record, sent as
+ * TELEMETRY_PROFILE. Durations are in ticks of tickRate per second.
+ */
+struct TelemetryProfile {
+    uint8_t zone;
+    char name[TELEMETRY_PROFILE_NAME_SIZE];
+    uint32_t tickRate;
+    uint32_t count;
+    //All 0 if count is 0.
+    uint32_t min;
+    uint32_t max;
+    uint32_t mean;
+    uint16_t histogram[TELEMETRY_PROFILE_BINS];
+};
+
+/**
+ * Timing of one periodic job, sent as TELEMETRY_JOB. Counters are since
+ * start-up, the maxima and the histogram since the job's previous record.
+ */
+struct TelemetryJob {
+    uint8_t job;
+    //Microseconds between runs.
+    uint32_t period;
+    uint32_t runs;
+    //Periods without a run, and runs still going when the next was due.
+    uint32_t skipped;
+    uint32_t overruns;
+    //Sensor readings repeated and sensor samples never read.
+    uint32_t duplicates;
+    uint32_t lost;
+    //Microseconds.
+    uint32_t maxLateness;
+    uint32_t maxDuration;
+    uint16_t lateness[TELEMETRY_JOB_BINS];
+};
+
+/**
+ * Dispatching of one scheduler event, sent in TELEMETRY_EVENTS after the
+ * idle and elapsed time since the previous record. Counters are since
+ * start-up, the latency since the previous record.
+ */
+struct TelemetryEventStatistics {
+    uint8_t event;
+    uint8_t priority;
+    uint32_t dispatched;
+    //Posts that found the event already pending.
+    uint32_t coalesced;
+    //Microseconds from post to dispatch.
+    uint32_t maxLatency;
+};
+
+/**
+ * Transactions on one I2C bus, sent as TELEMETRY_BUS. Counters are since
+ * start-up, the rest since the bus's previous record.
+ */
+struct TelemetryBus {
+    uint8_t bus;
+    uint32_t transactions;
+    uint32_t errors;
+    //Transactions refused because the queue was full.
+    uint32_t rejected;
+    //Most transactions waiting at once, the running one included.
+    uint8_t maxQueued;
+    //Microseconds from queuing to the start, and from start to completion.
+    uint32_t maxWait;
+    uint32_t maxDuration;
+    //Microseconds the bus was busy out of elapsed.
+    uint32_t busy;
+    uint32_t elapsed;
+};
+
+/**
+ * Little-endian field access, independent of the host's byte order.
+ */
+inline void telemetryPut16(uint8_t* buffer, uint16_t value) {
+    buffer[0] = (uint8_t) value;
+    buffer[1] = (uint8_t) (value >> 8);
+}
+
+inline void telemetryPut32(uint8_t* buffer, uint32_t value) {
+    buffer[0] = (uint8_t) value;
+    buffer[1] = (uint8_t) (value >> 8);
+    buffer[2] = (uint8_t) (value >> 16);
+    buffer[3] = (uint8_t) (value >> 24);
+}
+
+inline void telemetryPutFloat(uint8_t* buffer, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    telemetryPut32(buffer, bits);
+}
+
+inline uint16_t telemetryGet16(const uint8_t* buffer) {
+    return (uint16_t) (buffer[0] | (buffer[1] << 8));
+}
+
+inline uint32_t telemetryGet32(const uint8_t* buffer) {
+    return (uint32_t) buffer[0] | ((uint32_t) buffer[1] << 8) |
+           ((uint32_t) buffer[2] << 16) | ((uint32_t) buffer[3] << 24);
+}
+
+inline float telemetryGetFloat(const uint8_t* buffer) {
+    uint32_t bits = telemetryGet32(buffer);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,224 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Builds telemetry frames, see Telemetry.h for the format.
+ */
+
+/**
+ * Includes
+ */
+#include "TelemetryEncoder.h"
+#include "Cobs.h"
+#include "Crc16.h"
+
+TelemetryEncoder::TelemetryEncoder() {
+
+    length = 0;
+    sequence = 0;
+
+}
+
+void TelemetryEncoder::begin(uint32_t timestamp) {
+
+    frame[0] = TELEMETRY_VERSION;
+    frame[1] = 0;
+    telemetryPut16(&frame[2], sequence);
+    telemetryPut32(&frame[4], timestamp);
+    length = TELEMETRY_HEADER_SIZE;
+
+}
+
+bool TelemetryEncoder::add(uint8_t type, const uint8_t* payload, uint8_t size) {
+
+    if (space() < TELEMETRY_RECORD_HEADER_SIZE + size) {
+        return false;
+    }
+
+    frame[length++] = type;
+    frame[length++] = size;
+    memcpy(&frame[length], payload, size);
+    length += size;
+
+    return true;
+
+}
+
+bool TelemetryEncoder::addQuaternion(const float* q) {
+
+    uint8_t payload[TELEMETRY_QUATERNION_SIZE];
+
+    for (int i = 0; i < 4; i++) {
+        telemetryPutFloat(&payload[4 * i], q[i]);
+    }
+
+    return add(TELEMETRY_QUATERNION, payload, sizeof(payload));
+
+}
+
+bool TelemetryEncoder::addEuler(float roll, float pitch, float yaw) {
+
+    uint8_t payload[TELEMETRY_EULER_SIZE];
+
+    telemetryPutFloat(&payload[0], roll);
+    telemetryPutFloat(&payload[4], pitch);
+    telemetryPutFloat(&payload[8], yaw);
+
+    return add(TELEMETRY_EULER, payload, sizeof(payload));
+
+}
+
+bool TelemetryEncoder::addRawSensors(const int16_t* a, const int16_t* w, const int16_t* m) {
+
+    uint8_t payload[TELEMETRY_RAW_SENSORS_SIZE];
+
+    for (int i = 0; i < 3; i++) {
+        telemetryPut16(&payload[2 * i], (uint16_t) a[i]);
+        telemetryPut16(&payload[6 + 2 * i], (uint16_t) w[i]);
+        telemetryPut16(&payload[12 + 2 * i], (uint16_t) m[i]);
+    }
+
+    return add(TELEMETRY_RAW_SENSORS, payload, sizeof(payload));
+
+}
+
+bool TelemetryEncoder::addDiagnostics(const TelemetryDiagnostics& diagnostics) {
+
+    uint8_t payload[TELEMETRY_DIAGNOSTICS_SIZE];
+
+    telemetryPutFloat(&payload[0], diagnostics.gain);
+    telemetryPutFloat(&payload[4], diagnostics.gyroBias[0]);
+    telemetryPutFloat(&payload[8], diagnostics.gyroBias[1]);
+    telemetryPutFloat(&payload[12], diagnostics.gyroBias[2]);
+    telemetryPut32(&payload[16], diagnostics.updates);
+
+    return add(TELEMETRY_DIAGNOSTICS, payload, sizeof(payload));
+
+}
+
+bool TelemetryEncoder::addProfile(const TelemetryProfile& profile) {
+
+    uint8_t payload[TELEMETRY_PROFILE_SIZE];
+
+    payload[0] = profile.zone;
+    memcpy(&payload[1], profile.name, TELEMETRY_PROFILE_NAME_SIZE);
+    telemetryPut32(&payload[9], profile.tickRate);
+    telemetryPut32(&payload[13], profile.count);
+    telemetryPut32(&payload[17], profile.min);
+    telemetryPut32(&payload[21], profile.max);
+    telemetryPut32(&payload[25], profile.mean);
+    for (int i = 0; i < TELEMETRY_PROFILE_BINS; i++) {
+        telemetryPut16(&payload[29 + 2 * i], profile.histogram[i]);
+    }
+
+    return add(TELEMETRY_PROFILE, payload, sizeof(payload));
+
+}
+
+bool TelemetryEncoder::addJob(const TelemetryJob& job) {
+
+    uint8_t payload[TELEMETRY_JOB_SIZE];
+
+    payload[0] = job.job;
+    telemetryPut32(&payload[1], job.period);
+    telemetryPut32(&payload[5], job.runs);
+    telemetryPut32(&payload[9], job.skipped);
+    telemetryPut32(&payload[13], job.overruns);
+    telemetryPut32(&payload[17], job.duplicates);
+    telemetryPut32(&payload[21], job.lost);
+    telemetryPut32(&payload[25], job.maxLateness);
+    telemetryPut32(&payload[29], job.maxDuration);
+    for (int i = 0; i < TELEMETRY_JOB_BINS; i++) {
+        telemetryPut16(&payload[33 + 2 * i], job.lateness[i]);
+    }
+
+    return add(TELEMETRY_JOB, payload, sizeof(payload));
+
+}
+
+bool TelemetryEncoder::addEvents(uint32_t idle, uint32_t elapsed, const TelemetryEventStatistics* events, int count) {
+
+    uint8_t payload[TELEMETRY_EVENTS_HEADER_SIZE + TELEMETRY_MAX_EVENTS * TELEMETRY_EVENTS_ENTRY_SIZE];
+
+    if (count > TELEMETRY_MAX_EVENTS) {
+        count = TELEMETRY_MAX_EVENTS;
+    }
+
+    telemetryPut32(&payload[0], idle);
+    telemetryPut32(&payload[4], elapsed);
+    for (int i = 0; i < count; i++) {
+        uint8_t* entry = &payload[TELEMETRY_EVENTS_HEADER_SIZE + i * TELEMETRY_EVENTS_ENTRY_SIZE];
+        entry[0] = events[i].event;
+        entry[1] = events[i].priority;
+        telemetryPut32(&entry[2], events[i].dispatched);
+        telemetryPut32(&entry[6], events[i].coalesced);
+        telemetryPut32(&entry[10], events[i].maxLatency);
+    }
+
+    return add(TELEMETRY_EVENTS, payload, TELEMETRY_EVENTS_HEADER_SIZE + count * TELEMETRY_EVENTS_ENTRY_SIZE);
+
+}
+
+bool TelemetryEncoder::addBus(const TelemetryBus& bus) {
+
+    uint8_t payload[TELEMETRY_BUS_SIZE];
+
+    payload[0] = bus.bus;
+    telemetryPut32(&payload[1], bus.transactions);
+    telemetryPut32(&payload[5], bus.errors);
+    telemetryPut32(&payload[9], bus.rejected);
+    payload[13] = bus.maxQueued;
+    telemetryPut32(&payload[14], bus.maxWait);
+    telemetryPut32(&payload[18], bus.maxDuration);
+    telemetryPut32(&payload[22], bus.busy);
+    telemetryPut32(&payload[26], bus.elapsed);
+
+    return add(TELEMETRY_BUS, payload, sizeof(payload));
+
+}
+
+int TelemetryEncoder::space(void) const {
+
+    return TELEMETRY_MAX_FRAME - TELEMETRY_CRC_SIZE - length;
+
+}
+
+int TelemetryEncoder::finish(uint8_t* output) {
+
+    telemetryPut16(&frame[length], crc16(CRC16_INITIAL, frame, length));
+    length += TELEMETRY_CRC_SIZE;
+
+    int encoded = (int) cobsEncode(frame, length, output);
+    output[encoded++] = TELEMETRY_DELIMITER;
+
+    sequence++;
+    length = 0;
+
+    return encoded;
+
+}
+
+uint16_t TelemetryEncoder::getSequence(void) const {
+
+    return sequence;
+
+}
@@ -0,0 +1,153 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Builds telemetry frames, see Telemetry.h for the format.
+ *
+ * Usage:
+ *
+ *   encoder.begin(timestamp);
+ *   encoder.addEuler(roll, pitch, yaw);
+ *   length = encoder.finish(buffer);
+ *   //Send length bytes of buffer.
+ */
+
+#ifndef TELEMETRY_ENCODER_H
+#define TELEMETRY_ENCODER_H
+
+/**
+ * Includes
+ */
+#include "Telemetry.h"
+
+/**
+ * Telemetry frame encoder.
+ */
+class TelemetryEncoder {
+
+public:
+
+    /**
+     * Constructor.
+     */
+    TelemetryEncoder();
+
+    /**
+     * Start a new frame.
+     *
+     * @param timestamp Time of the data in the frame, in microseconds.
+     */
+    void begin(uint32_t timestamp);
+
+    /**
+     * Add a record to the frame.
+     *
+     * @param type Record type, TELEMETRY_*.
+     * @param payload Payload bytes, already little-endian.
+     * @param size Number of payload bytes.
+     *
+     * @return true if the record fitted in the frame, false if it was
+     *         left out.
+     */
+    bool add(uint8_t type, const uint8_t* payload, uint8_t size);
+
+    /**
+     * Add an orientation quaternion.
+     *
+     * @param q w, x, y, z.
+     */
+    bool addQuaternion(const float* q);
+
+    /**
+     * Add Euler angles, in radians.
+     */
+    bool addEuler(float roll, float pitch, float yaw);
+
+    /**
+     * Add raw sensor readings, in board frame counts.
+     *
+     * @param a Accelerometer x, y, z.
+     * @param w Gyroscope x, y, z.
+     * @param m Magnetometer x, y, z.
+     */
+    bool addRawSensors(const int16_t* a, const int16_t* w, const int16_t* m);
+
+    /**
+     * Add filter diagnostics.
+     */
+    bool addDiagnostics(const TelemetryDiagnostics& diagnostics);
+
+    /**
+     * Add a profiling zone's execution times.
+     */
+    bool addProfile(const TelemetryProfile& profile);
+
+    /**
+     * Add a periodic job's timing.
+     */
+    bool addJob(const TelemetryJob& job);
+
+    /**
+     * Add the event scheduler's idle time and per event statistics.
+     *
+     * @param idle Microseconds asleep out of elapsed.
+     * @param elapsed Microseconds since the previous record.
+     * @param events Statistics of count events, at most
+     *        TELEMETRY_MAX_EVENTS.
+     */
+    bool addEvents(uint32_t idle, uint32_t elapsed, const TelemetryEventStatistics* events, int count);
+
+    /**
+     * Add an I2C bus's transaction statistics.
+     */
+    bool addBus(const TelemetryBus& bus);
+
+    /**
+     * Number of payload bytes that can still be added, record headers
+     * included.
+     */
+    int space(void) const;
+
+    /**
+     * Finish the frame: append the CRC, COBS encode and append the
+     * delimiter.
+     *
+     * @param output Buffer of at least TELEMETRY_MAX_ENCODED_FRAME bytes.
+     *
+     * @return Number of bytes to send.
+     */
+    int finish(uint8_t* output);
+
+    /**
+     * Sequence number the next frame will carry.
+     */
+    uint16_t getSequence(void) const;
+
+private:
+
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    int length;
+    uint16_t sequence;
+
+};
+
+#endif /* TELEMETRY_ENCODER_H */
@@ -0,0 +1,199 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Schedules several telemetry streams over one serial link.
+ */
+
+/**
+ * Includes
+ */
+#include "TelemetryScheduler.h"
+
+//Frame header, CRC, COBS code byte and delimiter.
+#define FRAME_OVERHEAD (TELEMETRY_HEADER_SIZE + TELEMETRY_CRC_SIZE + 2)
+
+TelemetryScheduler::TelemetryScheduler(int rate, TelemetrySink frameSink) {
+
+    count = 0;
+    sink = frameSink;
+    tickRate = rate;
+    ticks = 0;
+    bytesPerSecond = 0;
+    tokens = 0;
+    burst = 0;
+
+}
+
+int TelemetryScheduler::addStream(uint8_t type, int divider, int priority, int size, TelemetryProducer producer, int phase) {
+
+    if (count == TELEMETRY_MAX_STREAMS) {
+        return -1;
+    }
+
+    Stream& stream = streams[count];
+
+    stream.type = type;
+    stream.divider = divider > 0 ? divider : 1;
+    stream.priority = priority;
+    stream.size = size;
+    stream.producer = producer;
+    stream.countdown = 1 + (phase > 0 ? phase : 0);
+    stream.sent = 0;
+    stream.dropped = 0;
+
+    //Insert behind the streams of the same or higher priority.
+    int i = count;
+    while (i > 0 && streams[order[i - 1]].priority < priority) {
+        order[i] = order[i - 1];
+        i--;
+    }
+    order[i] = count;
+
+    return count++;
+
+}
+
+void TelemetryScheduler::setBandwidth(int rate, int bytes) {
+
+    bytesPerSecond = rate;
+    burst = bytes * tickRate;
+    tokens = burst;
+
+}
+
+void TelemetryScheduler::tick(uint32_t timestamp) {
+
+    int due[TELEMETRY_MAX_STREAMS];
+    int sending = 0;
+    int bytes = FRAME_OVERHEAD;
+    //Bytes of the higher priority records that are not in this frame.
+    int reserve = 0;
+
+    ticks++;
+
+    if (bytesPerSecond > 0) {
+        tokens += bytesPerSecond;
+        if (tokens > burst) {
+            tokens = burst;
+        }
+    }
+
+    encoder.begin(timestamp);
+
+    //Highest priority first, so whatever does not fit is the least
+    //important.
+    for (int i = 0; i < count; i++) {
+
+        Stream& stream = streams[order[i]];
+
+        int cost = TELEMETRY_RECORD_HEADER_SIZE + stream.size;
+
+        if (--stream.countdown > 0) {
+            reserve += cost;
+            continue;
+        }
+        stream.countdown = stream.divider;
+
+        //COBS adds at most a byte per 254.
+        int encoded = bytes + cost + (bytes + cost) / 254;
+
+        //Leave enough budget for a frame with one record of every higher
+        //priority stream, so frequent low priority streams cannot starve
+        //rarer, more important ones.
+        int reserved = reserve > 0 ? reserve + FRAME_OVERHEAD : 0;
+
+        if ((bytesPerSecond > 0 && (encoded + reserved) * tickRate > tokens) || !stream.producer(encoder)) {
+            stream.dropped++;
+            reserve += cost;
+            continue;
+        }
+
+        bytes += cost;
+        due[sending++] = order[i];
+
+    }
+
+    if (sending == 0) {
+        return;
+    }
+
+    int length = encoder.finish(frame);
+
+    if (bytesPerSecond > 0) {
+        tokens -= length * tickRate;
+    }
+
+    bool sent = sink(frame, length);
+
+    for (int i = 0; i < sending; i++) {
+        if (sent) {
+            streams[due[i]].sent++;
+        } else {
+            streams[due[i]].dropped++;
+        }
+    }
+
+}
+
+bool TelemetryScheduler::addStatistics(TelemetryEncoder& target) {
+
+    uint8_t payload[TELEMETRY_MAX_STREAMS * TELEMETRY_STREAM_STATISTICS_ENTRY_SIZE];
+
+    for (int i = 0; i < count; i++) {
+        uint8_t* entry = &payload[i * TELEMETRY_STREAM_STATISTICS_ENTRY_SIZE];
+        entry[0] = streams[i].type;
+        telemetryPut32(&entry[1], streams[i].sent);
+        telemetryPut32(&entry[5], streams[i].dropped);
+    }
+
+    return target.add(TELEMETRY_STREAM_STATISTICS, payload, count * TELEMETRY_STREAM_STATISTICS_ENTRY_SIZE);
+
+}
+
+float TelemetryScheduler::getAchievedRate(int stream) {
+
+    if (ticks == 0) {
+        return 0;
+    }
+
+    return (float) streams[stream].sent * tickRate / ticks;
+
+}
+
+TelemetryStreamStatistics TelemetryScheduler::getStatistics(int stream) {
+
+    TelemetryStreamStatistics statistics;
+
+    statistics.type = streams[stream].type;
+    statistics.sent = streams[stream].sent;
+    statistics.dropped = streams[stream].dropped;
+
+    return statistics;
+
+}
+
+int TelemetryScheduler::getStreams(void) {
+
+    return count;
+
+}
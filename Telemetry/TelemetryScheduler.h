@@ -0,0 +1,161 @@
+/**
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * Schedules several telemetry streams over one serial link.
+ *
+ * Each stream has a record type, a rate (as a divider of the scheduler's
+ * tick rate), a priority and a producer that adds its record to a frame.
+ * On every tick the records that are due are packed into a single frame,
+ * highest priority first. Records that do not fit in the frame or in the
+ * link's byte budget are dropped, so under pressure the lowest priority
+ * streams lose out first. Sent and dropped counts are kept per stream and
+ * can themselves be streamed as TELEMETRY_STREAM_STATISTICS.
+ *
+ * Usage:
+ *
+ *   scheduler.addStream(TELEMETRY_QUATERNION, 2, 10, TELEMETRY_QUATERNION_SIZE, sendQuaternion);
+ *   ...
+ *   //From a Ticker at the tick rate:
+ *   scheduler.tick(timestamp);
+ */
+
+#ifndef TELEMETRY_SCHEDULER_H
+#define TELEMETRY_SCHEDULER_H
+
+/**
+ * Includes
+ */
+#include "TelemetryEncoder.h"
+
+/**
+ * Adds a stream's record to the frame; returns false if it did not fit.
+ */
+typedef bool (*TelemetryProducer)(TelemetryEncoder& encoder);
+
+/**
+ * Sends a finished frame; returns false if it was dropped.
+ */
+typedef bool (*TelemetrySink)(const uint8_t* frame, int length);
+
+/**
+ * Telemetry stream scheduler.
+ */
+class TelemetryScheduler {
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param tickRate Rate tick() is called at, in Hz.
+     * @param sink Where finished frames are sent.
+     */
+    TelemetryScheduler(int tickRate, TelemetrySink sink);
+
+    /**
+     * Register a stream.
+     *
+     * @param type Record type the producer adds, TELEMETRY_*.
+     * @param divider Send every divider ticks.
+     * @param priority Higher values are dropped last.
+     * @param size Payload bytes the producer adds, used for the budget.
+     * @param producer Adds the record.
+     * @param phase Ticks to hold the first record back, to put streams of
+     *        the same divider in different frames.
+     *
+     * @return The stream number, or -1 if there are already
+     *         TELEMETRY_MAX_STREAMS streams.
+     */
+    int addStream(uint8_t type, int divider, int priority, int size, TelemetryProducer producer, int phase = 0);
+
+    /**
+     * Limit the link bandwidth telemetry may use.
+     *
+     * @param bytesPerSecond Sustained budget, e.g. baud / 10; 0 for no limit.
+     * @param burst Most bytes that may be sent at once after an idle
+     *        period, e.g. the transmit queue size.
+     */
+    void setBandwidth(int bytesPerSecond, int burst);
+
+    /**
+     * Send the streams that are due.
+     *
+     * @param timestamp Timestamp for the frame, in microseconds.
+     */
+    void tick(uint32_t timestamp);
+
+    /**
+     * Add the per stream counters to a frame, for a statistics stream.
+     */
+    bool addStatistics(TelemetryEncoder& encoder);
+
+    /**
+     * Rate a stream has achieved since start-up, in Hz.
+     */
+    float getAchievedRate(int stream);
+
+    /**
+     * Counters for a stream.
+     */
+    TelemetryStreamStatistics getStatistics(int stream);
+
+    /**
+     * Number of registered streams.
+     */
+    int getStreams(void);
+
+private:
+
+    struct Stream {
+        uint8_t type;
+        int divider;
+        int priority;
+        int size;
+        TelemetryProducer producer;
+        int countdown;
+        uint32_t sent;
+        uint32_t dropped;
+    };
+
+    //In the order they were added.
+    Stream streams[TELEMETRY_MAX_STREAMS];
+    //Stream numbers by descending priority.
+    int order[TELEMETRY_MAX_STREAMS];
+    int count;
+
+    TelemetrySink sink;
+    TelemetryEncoder encoder;
+    uint8_t frame[TELEMETRY_MAX_ENCODED_FRAME];
+
+    int tickRate;
+    uint32_t ticks;
+
+    //Token bucket in byte-ticks: bytesPerSecond added per tick, tickRate
+    //taken per byte sent, so no fractions are needed.
+    int32_t bytesPerSecond;
+    int32_t tokens;
+    int32_t burst;
+
+};
+
+#endif /* TELEMETRY_SCHEDULER_H */
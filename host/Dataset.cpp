@@ -0,0 +1,124 @@
+/**
+ * Reproducible sensor datasets with ground truth.
+ */
+#include "Dataset.h"
+#include "SensorMounting.h"
+
+#include <string.h>
+
+#define DATASET_MAGIC   "# marg_filter dataset 1"
+#define DATASET_COLUMNS "# t q0 q1 q2 q3 gx gy gz ax ay az mx my mz"
+
+Dataset::Dataset() : rate(0), gyroscopeScale(DATASET_GYROSCOPE_LSB),
+    accelerometerScale(DATASET_ACCELEROMETER_LSB), magnetometerScale(DATASET_MAGNETOMETER_LSB) {
+}
+
+std::vector<DatasetInput> Dataset::inputs(int ratio) const {
+
+    std::vector<DatasetInput> result;
+
+    for (size_t start = 0; start + ratio <= samples.size(); start += ratio) {
+        int sum[9] = {0};
+        for (int i = 0; i < ratio; i++) {
+            const DatasetSample& s = samples[start + i];
+            for (int k = 0; k < 3; k++) {
+                sum[k] += s.w[k];
+                sum[3 + k] += s.a[k];
+                sum[6 + k] += s.m[k];
+            }
+        }
+
+        double w[3];
+        double a[3];
+        double m[3];
+        GyroscopeAxes::apply(sum, w);
+        AccelerometerAxes::apply(sum + 3, a);
+        MagnetometerAxes::apply(sum + 6, m);
+
+        DatasetInput input;
+        const DatasetSample& last = samples[start + ratio - 1];
+        input.t = last.t;
+        for (int k = 0; k < 3; k++) {
+            input.w[k] = w[k] / (ratio * gyroscopeScale);
+            input.a[k] = a[k] / (ratio * accelerometerScale);
+            input.m[k] = m[k] / (ratio * magnetometerScale);
+        }
+        for (int k = 0; k < 4; k++) {
+            input.q[k] = last.q[k];
+        }
+        result.push_back(input);
+    }
+
+    return result;
+
+}
+
+bool Dataset::write(FILE* file) const {
+
+    fprintf(file, "%s rate %.17g gyroscope %.17g accelerometer %.17g magnetometer %.17g\n", DATASET_MAGIC,
+            rate, gyroscopeScale, accelerometerScale, magnetometerScale);
+
+    //One comment line per line of description.
+    size_t start = 0;
+    while (start < description.size()) {
+        size_t end = description.find('\n', start);
+        if (end == std::string::npos) {
+            end = description.size();
+        }
+        fprintf(file, "# %s\n", description.substr(start, end - start).c_str());
+        start = end + 1;
+    }
+
+    fprintf(file, "%s\n", DATASET_COLUMNS);
+
+    for (size_t i = 0; i < samples.size(); i++) {
+        const DatasetSample& s = samples[i];
+        fprintf(file, "%.6f %.9f %.9f %.9f %.9f %d %d %d %d %d %d %d %d %d\n", s.t, s.q[0], s.q[1], s.q[2], s.q[3],
+                s.w[0], s.w[1], s.w[2], s.a[0], s.a[1], s.a[2], s.m[0], s.m[1], s.m[2]);
+    }
+
+    return !ferror(file);
+
+}
+
+bool Dataset::read(FILE* file) {
+
+    char line[512];
+
+    samples.clear();
+    description.clear();
+
+    if (fgets(line, sizeof(line), file) == 0 || strncmp(line, DATASET_MAGIC, strlen(DATASET_MAGIC)) != 0) {
+        return false;
+    }
+    if (sscanf(line + strlen(DATASET_MAGIC), " rate %lf gyroscope %lf accelerometer %lf magnetometer %lf",
+               &rate, &gyroscopeScale, &accelerometerScale, &magnetometerScale) != 4) {
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, DATASET_COLUMNS, strlen(DATASET_COLUMNS)) == 0) {
+            continue;
+        }
+        if (line[0] == '#') {
+            description += line + (line[1] == ' ' ? 2 : 1);
+            continue;
+        }
+
+        DatasetSample s;
+        int c[9];
+        if (sscanf(line, "%lf %lf %lf %lf %lf %d %d %d %d %d %d %d %d %d", &s.t, &s.q[0], &s.q[1], &s.q[2], &s.q[3],
+                   &c[0], &c[1], &c[2], &c[3], &c[4], &c[5], &c[6], &c[7], &c[8]) != 14) {
+            return false;
+        }
+        for (int i = 0; i < 3; i++) {
+            s.w[i] = (int16_t) c[i];
+            s.a[i] = (int16_t) c[3 + i];
+            s.m[i] = (int16_t) c[6 + i];
+        }
+        samples.push_back(s);
+    }
+
+    return true;
+
+}
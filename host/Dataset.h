@@ -0,0 +1,70 @@
+/**
+ * Reproducible sensor datasets with ground truth, for comparing the
+ * orientation engines.
+ *
+ * A dataset is a text file: comment lines starting with '#' (the first
+ * holds the sample rate and count scales, the rest are free form), then
+ * one line per sample with the time in seconds, the true quaternion and
+ * the gyroscope, accelerometer and magnetometer readings in raw counts,
+ * in each sensor's own axes, exactly as the drivers return them to
+ * main.cpp. SensorMounting.h takes them into the board frame.
+ */
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+//Count scales of the readings, as main.cpp converts them: 14.375 LSB per
+//degree/s, 256 LSB per g0 as in its ACCELEROMETER_GAIN, and the HMC5843's
+//1300 LSB per gauss at its default gain.
+#define DATASET_GYROSCOPE_LSB     (14.375 * 57.2957795130823)
+#define DATASET_ACCELEROMETER_LSB (256.0 / 9.812865328)
+#define DATASET_MAGNETOMETER_LSB  1300.0
+
+struct DatasetSample {
+    double t;
+    double q[4];
+    int16_t w[3];
+    int16_t a[3];
+    int16_t m[3];
+};
+
+//Readings at a filter rate, in the board frame and SI units, as main.cpp
+//hands them to an engine, with the true orientation at the last sample.
+struct DatasetInput {
+    double t;
+    double w[3];
+    double a[3];
+    double m[3];
+    double q[4];
+};
+
+struct Dataset {
+
+    Dataset();
+
+    //Samples per second.
+    double rate;
+    //Counts per rad/s, per m/s/s and per gauss.
+    double gyroscopeScale;
+    double accelerometerScale;
+    double magnetometerScale;
+    //Free form description, e.g. how it was generated.
+    std::string description;
+
+    std::vector<DatasetSample> samples;
+
+    //Map the readings through SensorMounting.h and convert them to SI
+    //units, box averaging every ratio samples into one filter update.
+    std::vector<DatasetInput> inputs(int ratio) const;
+
+    bool write(FILE* file) const;
+    //False if the file is not a dataset or is truncated mid-line.
+    bool read(FILE* file);
+
+};
+
+#endif /* DATASET_H */
@@ -0,0 +1,63 @@
+/**
+ * Lock-free single producer, single consumer ring of fixed size.
+ *
+ * One thread may push and one other thread may pop, with no locks and no
+ * allocation; the head and tail live on separate cache lines so the two
+ * sides do not share a line while streaming.
+ */
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+
+template <typename T, size_t N>
+class SpscRing {
+
+    static_assert((N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+
+    SpscRing() : head(0), tail(0) {}
+
+    //Returns false if the ring is full.
+    bool push(const T& value) {
+
+        size_t h = head.load(std::memory_order_relaxed);
+
+        if (h - tail.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+
+        slots[h & (N - 1)] = value;
+        head.store(h + 1, std::memory_order_release);
+
+        return true;
+
+    }
+
+    //Returns false if the ring is empty.
+    bool pop(T& value) {
+
+        size_t t = tail.load(std::memory_order_relaxed);
+
+        if (head.load(std::memory_order_acquire) == t) {
+            return false;
+        }
+
+        value = slots[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+
+        return true;
+
+    }
+
+private:
+
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+    alignas(64) T slots[N];
+
+};
+
+#endif /* SPSC_RING_H */
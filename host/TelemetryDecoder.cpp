@@ -0,0 +1,260 @@
+/**
+ * Host decoder for the firmware telemetry stream.
+ */
+#include "TelemetryDecoder.h"
+#include "Cobs.h"
+#include "Crc16.h"
+
+#include <string.h>
+
+TelemetryDecoder::TelemetryDecoder() : length(0), overflow(false), haveSequence(false), lastSequence(0) {
+
+    memset(&stats, 0, sizeof(stats));
+
+}
+
+void TelemetryDecoder::feed(const uint8_t* data, size_t n, const FrameHandler& handler) {
+
+    stats.bytes += n;
+
+    for (size_t i = 0; i < n; i++) {
+
+        if (data[i] == TELEMETRY_DELIMITER) {
+            endOfFrame(handler);
+        } else if (length < sizeof(buffer)) {
+            buffer[length++] = data[i];
+        } else {
+            overflow = true;
+        }
+
+    }
+
+}
+
+void TelemetryDecoder::endOfFrame(const FrameHandler& handler) {
+
+    size_t n = length;
+    bool overflowed = overflow;
+
+    length = 0;
+    overflow = false;
+
+    //Back to back delimiters are idle line, not frames.
+    if (n == 0 && !overflowed) {
+        return;
+    }
+
+    TelemetryFrame frame;
+    size_t size = overflowed ? 0 : cobsDecode(buffer, n, decoded);
+    Status status = (size == 0) ? FramingError : parseFrame(decoded, size, frame);
+
+    switch (status) {
+        case FramingError:
+            stats.framingErrors++;
+            return;
+        case CrcError:
+            stats.crcErrors++;
+            return;
+        case VersionError:
+            stats.versionErrors++;
+            return;
+        default:
+            break;
+    }
+
+    if (haveSequence) {
+        stats.droppedFrames += (uint16_t) (frame.sequence - lastSequence - 1);
+    }
+    haveSequence = true;
+    lastSequence = frame.sequence;
+    stats.frames++;
+
+    handler(frame);
+
+}
+
+TelemetryDecoder::Status TelemetryDecoder::parseFrame(const uint8_t* decoded, size_t size, TelemetryFrame& frame) {
+
+    if (size < TELEMETRY_HEADER_SIZE + TELEMETRY_CRC_SIZE) {
+        return FramingError;
+    }
+
+    size_t end = size - TELEMETRY_CRC_SIZE;
+    if (crc16(CRC16_INITIAL, decoded, end) != telemetryGet16(&decoded[end])) {
+        return CrcError;
+    }
+
+    if (decoded[0] != TELEMETRY_VERSION) {
+        return VersionError;
+    }
+
+    memset(&frame, 0, sizeof(frame));
+    frame.version = decoded[0];
+    frame.sequence = telemetryGet16(&decoded[2]);
+    frame.timestamp = telemetryGet32(&decoded[4]);
+    frame.data = decoded;
+    frame.size = size;
+    size = end;
+
+    size_t i = TELEMETRY_HEADER_SIZE;
+
+    while (i < size) {
+
+        if (i + TELEMETRY_RECORD_HEADER_SIZE > size) {
+            return FramingError;
+        }
+
+        uint8_t type = decoded[i];
+        uint8_t recordSize = decoded[i + 1];
+        const uint8_t* payload = &decoded[i + TELEMETRY_RECORD_HEADER_SIZE];
+
+        i += TELEMETRY_RECORD_HEADER_SIZE + recordSize;
+        if (i > size) {
+            return FramingError;
+        }
+
+        //Known types shorter than expected are corrupt; longer ones may
+        //come from a newer firmware that appended fields.
+        switch (type) {
+
+            case TELEMETRY_QUATERNION:
+                if (recordSize < TELEMETRY_QUATERNION_SIZE) {
+                    return FramingError;
+                }
+                for (int k = 0; k < 4; k++) {
+                    frame.quaternion[k] = telemetryGetFloat(&payload[4 * k]);
+                }
+                frame.hasQuaternion = true;
+                break;
+
+            case TELEMETRY_EULER:
+                if (recordSize < TELEMETRY_EULER_SIZE) {
+                    return FramingError;
+                }
+                for (int k = 0; k < 3; k++) {
+                    frame.euler[k] = telemetryGetFloat(&payload[4 * k]);
+                }
+                frame.hasEuler = true;
+                break;
+
+            case TELEMETRY_RAW_SENSORS:
+                if (recordSize < TELEMETRY_RAW_SENSORS_SIZE) {
+                    return FramingError;
+                }
+                for (int k = 0; k < 3; k++) {
+                    frame.accelerometer[k] = (int16_t) telemetryGet16(&payload[2 * k]);
+                    frame.gyroscope[k] = (int16_t) telemetryGet16(&payload[6 + 2 * k]);
+                    frame.magnetometer[k] = (int16_t) telemetryGet16(&payload[12 + 2 * k]);
+                }
+                frame.hasRawSensors = true;
+                break;
+
+            case TELEMETRY_DIAGNOSTICS:
+                if (recordSize < TELEMETRY_DIAGNOSTICS_SIZE) {
+                    return FramingError;
+                }
+                frame.diagnostics.gain = telemetryGetFloat(&payload[0]);
+                for (int k = 0; k < 3; k++) {
+                    frame.diagnostics.gyroBias[k] = telemetryGetFloat(&payload[4 + 4 * k]);
+                }
+                frame.diagnostics.updates = telemetryGet32(&payload[16]);
+                frame.hasDiagnostics = true;
+                break;
+
+            case TELEMETRY_STREAM_STATISTICS:
+                if (recordSize % TELEMETRY_STREAM_STATISTICS_ENTRY_SIZE != 0 ||
+                    recordSize / TELEMETRY_STREAM_STATISTICS_ENTRY_SIZE > TELEMETRY_MAX_STREAMS) {
+                    return FramingError;
+                }
+                frame.streamCount = recordSize / TELEMETRY_STREAM_STATISTICS_ENTRY_SIZE;
+                for (int k = 0; k < frame.streamCount; k++) {
+                    const uint8_t* entry = &payload[k * TELEMETRY_STREAM_STATISTICS_ENTRY_SIZE];
+                    frame.streams[k].type = entry[0];
+                    frame.streams[k].sent = telemetryGet32(&entry[1]);
+                    frame.streams[k].dropped = telemetryGet32(&entry[5]);
+                }
+                break;
+
+            case TELEMETRY_PROFILE:
+                if (recordSize < TELEMETRY_PROFILE_SIZE) {
+                    return FramingError;
+                }
+                frame.profile.zone = payload[0];
+                memcpy(frame.profile.name, &payload[1], TELEMETRY_PROFILE_NAME_SIZE);
+                frame.profile.tickRate = telemetryGet32(&payload[9]);
+                frame.profile.count = telemetryGet32(&payload[13]);
+                frame.profile.min = telemetryGet32(&payload[17]);
+                frame.profile.max = telemetryGet32(&payload[21]);
+                frame.profile.mean = telemetryGet32(&payload[25]);
+                for (int k = 0; k < TELEMETRY_PROFILE_BINS; k++) {
+                    frame.profile.histogram[k] = telemetryGet16(&payload[29 + 2 * k]);
+                }
+                frame.hasProfile = true;
+                break;
+
+            case TELEMETRY_JOB:
+                if (recordSize < TELEMETRY_JOB_SIZE) {
+                    return FramingError;
+                }
+                frame.job.job = payload[0];
+                frame.job.period = telemetryGet32(&payload[1]);
+                frame.job.runs = telemetryGet32(&payload[5]);
+                frame.job.skipped = telemetryGet32(&payload[9]);
+                frame.job.overruns = telemetryGet32(&payload[13]);
+                frame.job.duplicates = telemetryGet32(&payload[17]);
+                frame.job.lost = telemetryGet32(&payload[21]);
+                frame.job.maxLateness = telemetryGet32(&payload[25]);
+                frame.job.maxDuration = telemetryGet32(&payload[29]);
+                for (int k = 0; k < TELEMETRY_JOB_BINS; k++) {
+                    frame.job.lateness[k] = telemetryGet16(&payload[33 + 2 * k]);
+                }
+                frame.hasJob = true;
+                break;
+
+            case TELEMETRY_EVENTS:
+                if (recordSize < TELEMETRY_EVENTS_HEADER_SIZE ||
+                    (recordSize - TELEMETRY_EVENTS_HEADER_SIZE) % TELEMETRY_EVENTS_ENTRY_SIZE != 0 ||
+                    (recordSize - TELEMETRY_EVENTS_HEADER_SIZE) / TELEMETRY_EVENTS_ENTRY_SIZE > TELEMETRY_MAX_EVENTS) {
+                    return FramingError;
+                }
+                frame.idle = telemetryGet32(&payload[0]);
+                frame.elapsed = telemetryGet32(&payload[4]);
+                frame.eventCount = (recordSize - TELEMETRY_EVENTS_HEADER_SIZE) / TELEMETRY_EVENTS_ENTRY_SIZE;
+                for (int k = 0; k < frame.eventCount; k++) {
+                    const uint8_t* entry = &payload[TELEMETRY_EVENTS_HEADER_SIZE + k * TELEMETRY_EVENTS_ENTRY_SIZE];
+                    frame.events[k].event = entry[0];
+                    frame.events[k].priority = entry[1];
+                    frame.events[k].dispatched = telemetryGet32(&entry[2]);
+                    frame.events[k].coalesced = telemetryGet32(&entry[6]);
+                    frame.events[k].maxLatency = telemetryGet32(&entry[10]);
+                }
+                frame.hasEvents = true;
+                break;
+
+            case TELEMETRY_BUS:
+                if (recordSize < TELEMETRY_BUS_SIZE) {
+                    return FramingError;
+                }
+                frame.bus.bus = payload[0];
+                frame.bus.transactions = telemetryGet32(&payload[1]);
+                frame.bus.errors = telemetryGet32(&payload[5]);
+                frame.bus.rejected = telemetryGet32(&payload[9]);
+                frame.bus.maxQueued = payload[13];
+                frame.bus.maxWait = telemetryGet32(&payload[14]);
+                frame.bus.maxDuration = telemetryGet32(&payload[18]);
+                frame.bus.busy = telemetryGet32(&payload[22]);
+                frame.bus.elapsed = telemetryGet32(&payload[26]);
+                frame.hasBus = true;
+                break;
+
+            default:
+                frame.unknownRecords++;
+                break;
+
+        }
+
+    }
+
+    return Ok;
+
+}
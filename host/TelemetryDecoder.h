@@ -0,0 +1,118 @@
+/**
+ * Host decoder for the firmware telemetry stream, see Telemetry.h.
+ *
+ * Bytes are fed in as they arrive, in chunks of any size; every complete
+ * frame that passes the COBS, CRC and version checks is handed to a
+ * callback. Corrupt frames are counted and skipped, and gaps in the
+ * sequence number are counted as dropped frames.
+ */
+#ifndef TELEMETRY_DECODER_H
+#define TELEMETRY_DECODER_H
+
+#include "Telemetry.h"
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+//One decoded frame. Only the records flagged as present were in the frame.
+struct TelemetryFrame {
+    uint8_t version;
+    uint16_t sequence;
+    uint32_t timestamp;
+
+    bool hasQuaternion;
+    float quaternion[4];
+
+    bool hasEuler;
+    float euler[3];
+
+    bool hasRawSensors;
+    int16_t accelerometer[3];
+    int16_t gyroscope[3];
+    int16_t magnetometer[3];
+
+    bool hasDiagnostics;
+    TelemetryDiagnostics diagnostics;
+
+    bool hasProfile;
+    TelemetryProfile profile;
+
+    bool hasJob;
+    TelemetryJob job;
+
+    //Scheduler idle and elapsed microseconds, and eventCount events.
+    bool hasEvents;
+    uint32_t idle;
+    uint32_t elapsed;
+    int eventCount;
+    TelemetryEventStatistics events[TELEMETRY_MAX_EVENTS];
+
+    bool hasBus;
+    TelemetryBus bus;
+
+    //Number of entries in streams, 0 if there was no statistics record.
+    int streamCount;
+    TelemetryStreamStatistics streams[TELEMETRY_MAX_STREAMS];
+
+    //Records of types this decoder does not know about.
+    int unknownRecords;
+
+    //The whole frame after COBS decoding, CRC included, as stored by the
+    //recorder. Only valid during the handler call.
+    const uint8_t* data;
+    size_t size;
+};
+
+struct TelemetryStatistics {
+    uint64_t bytes;
+    uint64_t frames;
+    uint64_t crcErrors;
+    uint64_t framingErrors;
+    uint64_t versionErrors;
+    //Frames missing according to the sequence numbers.
+    uint64_t droppedFrames;
+};
+
+class TelemetryDecoder {
+
+public:
+
+    typedef std::function<void (const TelemetryFrame&)> FrameHandler;
+
+    enum Status {
+        Ok,
+        FramingError,
+        CrcError,
+        VersionError
+    };
+
+    TelemetryDecoder();
+
+    //Feed received bytes; handler is called once per good frame.
+    void feed(const uint8_t* data, size_t length, const FrameHandler& handler);
+
+    //Parse one frame that has already been COBS decoded, checking its CRC
+    //and version. Statistics are not updated; frame.data points at data.
+    static Status parseFrame(const uint8_t* data, size_t size, TelemetryFrame& frame);
+
+    const TelemetryStatistics& statistics() const { return stats; }
+
+private:
+
+    void endOfFrame(const FrameHandler& handler);
+
+    uint8_t buffer[TELEMETRY_MAX_ENCODED_FRAME];
+    uint8_t decoded[TELEMETRY_MAX_ENCODED_FRAME];
+    size_t length;
+    //A frame overflowed the buffer; discard until the next delimiter.
+    bool overflow;
+
+    bool haveSequence;
+    uint16_t lastSequence;
+
+    TelemetryStatistics stats;
+
+};
+
+#endif /* TELEMETRY_DECODER_H */
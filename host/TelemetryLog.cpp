@@ -0,0 +1,277 @@
+/**
+ * Chunked on-disk telemetry log.
+ */
+#include "TelemetryLog.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TelemetryLogWriter::TelemetryLogWriter() : file(NULL), written(0), failed(false) {
+
+    chunk.reserve(TELEMETRY_LOG_CHUNK_SIZE);
+    memset(&header, 0, sizeof(header));
+
+}
+
+TelemetryLogWriter::~TelemetryLogWriter() {
+
+    if (file != NULL) {
+        close();
+    }
+
+}
+
+bool TelemetryLogWriter::open(const char* path) {
+
+    file = fopen(path, "wb");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    //Large stdio buffer; chunks are written whole anyway.
+    setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+    TelemetryLogHeader fileHeader = {TELEMETRY_LOG_MAGIC, TELEMETRY_LOG_VERSION, TELEMETRY_LOG_CHUNK_SIZE, 0};
+    failed = fwrite(&fileHeader, sizeof(fileHeader), 1, file) != 1;
+    written = sizeof(fileHeader);
+
+    return !failed;
+
+}
+
+bool TelemetryLogWriter::append(const TelemetryFrame& frame) {
+
+    if (chunk.size() + 2 + frame.size > TELEMETRY_LOG_CHUNK_SIZE) {
+        flush();
+    }
+
+    if (header.frames == 0) {
+        header.firstTimestamp = frame.timestamp;
+        header.firstSequence = frame.sequence;
+    }
+    header.lastTimestamp = frame.timestamp;
+    header.lastSequence = frame.sequence;
+    header.frames++;
+
+    chunk.push_back((uint8_t) frame.size);
+    chunk.push_back((uint8_t) (frame.size >> 8));
+    chunk.insert(chunk.end(), frame.data, frame.data + frame.size);
+
+    return !failed;
+
+}
+
+bool TelemetryLogWriter::flush() {
+
+    if (header.frames == 0) {
+        return !failed;
+    }
+
+    header.magic = TELEMETRY_LOG_CHUNK_MAGIC;
+    header.bytes = (uint32_t) chunk.size();
+
+    TelemetryLogIndexEntry entry = {written, header.frames, header.firstTimestamp};
+    index.push_back(entry);
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fwrite(chunk.data(), 1, chunk.size(), file) != chunk.size()) {
+        failed = true;
+    }
+
+    written += sizeof(header) + chunk.size();
+    chunk.clear();
+    memset(&header, 0, sizeof(header));
+
+    return !failed;
+
+}
+
+bool TelemetryLogWriter::close() {
+
+    if (file == NULL) {
+        return false;
+    }
+
+    flush();
+
+    TelemetryLogIndex indexHeader = {TELEMETRY_LOG_INDEX_MAGIC, (uint32_t) index.size()};
+    TelemetryLogFooter footer = {written, TELEMETRY_LOG_FOOTER_MAGIC, 0};
+
+    if (fwrite(&indexHeader, sizeof(indexHeader), 1, file) != 1 ||
+        fwrite(index.data(), sizeof(TelemetryLogIndexEntry), index.size(), file) != index.size() ||
+        fwrite(&footer, sizeof(footer), 1, file) != 1) {
+        failed = true;
+    }
+
+    written += sizeof(indexHeader) + index.size() * sizeof(TelemetryLogIndexEntry) + sizeof(footer);
+
+    if (fclose(file) != 0) {
+        failed = true;
+    }
+    file = NULL;
+
+    return !failed;
+
+}
+
+TelemetryLogReader::TelemetryLogReader() : map(NULL), mapSize(0), hasIndex(false) {
+}
+
+TelemetryLogReader::~TelemetryLogReader() {
+
+    close();
+
+}
+
+bool TelemetryLogReader::isLog(const char* path) {
+
+    FILE* file = fopen(path, "rb");
+    TelemetryLogHeader header;
+    bool log = false;
+
+    if (file != NULL) {
+        log = fread(&header, sizeof(header), 1, file) == 1 && header.magic == TELEMETRY_LOG_MAGIC;
+        fclose(file);
+    }
+
+    return log;
+
+}
+
+bool TelemetryLogReader::open(const char* path) {
+
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(TelemetryLogHeader)) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+
+    mapSize = st.st_size;
+    void* mapped = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (mapped == MAP_FAILED) {
+        mapSize = 0;
+        return false;
+    }
+    map = (const uint8_t*) mapped;
+
+    TelemetryLogHeader header;
+    memcpy(&header, map, sizeof(header));
+
+    if (header.magic != TELEMETRY_LOG_MAGIC || header.version != TELEMETRY_LOG_VERSION) {
+        close();
+        return false;
+    }
+
+    //Prefer the index; fall back to walking the chunk headers.
+    TelemetryLogFooter footer;
+    TelemetryLogIndex index;
+
+    if (mapSize >= sizeof(header) + sizeof(index) + sizeof(footer)) {
+
+        memcpy(&footer, map + mapSize - sizeof(footer), sizeof(footer));
+
+        if (footer.magic == TELEMETRY_LOG_FOOTER_MAGIC && footer.indexOffset + sizeof(index) <= mapSize - sizeof(footer)) {
+
+            memcpy(&index, map + footer.indexOffset, sizeof(index));
+            uint64_t end = footer.indexOffset + sizeof(index) + (uint64_t) index.count * sizeof(TelemetryLogIndexEntry);
+
+            if (index.magic == TELEMETRY_LOG_INDEX_MAGIC && end == mapSize - sizeof(footer)) {
+                for (uint32_t i = 0; i < index.count; i++) {
+                    TelemetryLogIndexEntry entry;
+                    memcpy(&entry, map + footer.indexOffset + sizeof(index) + i * sizeof(entry), sizeof(entry));
+                    chunks.push_back(entry.offset);
+                }
+                hasIndex = true;
+                return true;
+            }
+
+        }
+
+    }
+
+    uint64_t offset = sizeof(header);
+
+    while (offset + sizeof(TelemetryLogChunk) <= mapSize) {
+
+        TelemetryLogChunk chunk;
+        memcpy(&chunk, map + offset, sizeof(chunk));
+
+        if (chunk.magic != TELEMETRY_LOG_CHUNK_MAGIC || offset + sizeof(chunk) + chunk.bytes > mapSize) {
+            break;
+        }
+
+        chunks.push_back(offset);
+        offset += sizeof(chunk) + chunk.bytes;
+
+    }
+
+    return true;
+
+}
+
+void TelemetryLogReader::close() {
+
+    if (map != NULL) {
+        munmap((void*) map, mapSize);
+    }
+
+    map = NULL;
+    mapSize = 0;
+    chunks.clear();
+    hasIndex = false;
+
+}
+
+TelemetryLogChunk TelemetryLogReader::chunk(size_t i) const {
+
+    //Frames have any length, so chunk headers are not aligned in the file.
+    TelemetryLogChunk header;
+    memcpy(&header, map + chunks[i], sizeof(header));
+
+    return header;
+
+}
+
+size_t TelemetryLogReader::readChunk(size_t i, const TelemetryDecoder::FrameHandler& handler) const {
+
+    TelemetryLogChunk header = chunk(i);
+    const uint8_t* data = map + chunks[i] + sizeof(TelemetryLogChunk);
+    size_t offset = 0;
+    size_t bad = 0;
+
+    while (offset + 2 <= header.bytes) {
+
+        size_t size = data[offset] | (data[offset + 1] << 8);
+        offset += 2;
+
+        if (offset + size > header.bytes) {
+            bad++;
+            break;
+        }
+
+        TelemetryFrame frame;
+        if (TelemetryDecoder::parseFrame(&data[offset], size, frame) == TelemetryDecoder::Ok) {
+            handler(frame);
+        } else {
+            bad++;
+        }
+
+        offset += size;
+
+    }
+
+    return bad;
+
+}
@@ -0,0 +1,142 @@
+/**
+ * Chunked on-disk telemetry log.
+ *
+ * Frames are stored after COBS decoding (header, records and CRC as sent
+ * by the firmware), each prefixed by its 16-bit length, in chunks of up to
+ * TELEMETRY_LOG_CHUNK_SIZE bytes. Closing the log appends an index of the
+ * chunks and a footer pointing at it, so a reader can mmap the file and
+ * seek straight to any time range. A log that was not closed (e.g. the
+ * recorder was killed) has no index, but its chunks can still be found by
+ * walking their headers from the start.
+ *
+ * Layout, all little-endian:
+ *
+ *   TelemetryLogHeader
+ *   chunk:  TelemetryLogChunk, then frames: u16 length, length bytes
+ *   ...
+ *   index:  TelemetryLogIndex, then count TelemetryLogIndexEntry
+ *   TelemetryLogFooter
+ */
+#ifndef TELEMETRY_LOG_H
+#define TELEMETRY_LOG_H
+
+#include "TelemetryDecoder.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#define TELEMETRY_LOG_VERSION 1
+#define TELEMETRY_LOG_CHUNK_SIZE (256 * 1024)
+
+#define TELEMETRY_LOG_MAGIC       0x474f4c54 //"TLOG"
+#define TELEMETRY_LOG_CHUNK_MAGIC 0x4b4e4843 //"CHNK"
+#define TELEMETRY_LOG_INDEX_MAGIC 0x58444e49 //"INDX"
+#define TELEMETRY_LOG_FOOTER_MAGIC 0x444e4554 //"TEND"
+
+struct TelemetryLogHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t chunkSize;
+    uint32_t reserved;
+};
+
+struct TelemetryLogChunk {
+    uint32_t magic;
+    //Bytes of frames following this header.
+    uint32_t bytes;
+    uint32_t frames;
+    uint32_t firstTimestamp;
+    uint32_t lastTimestamp;
+    uint16_t firstSequence;
+    uint16_t lastSequence;
+};
+
+struct TelemetryLogIndex {
+    uint32_t magic;
+    uint32_t count;
+};
+
+struct TelemetryLogIndexEntry {
+    //Offset of the chunk header from the start of the file.
+    uint64_t offset;
+    uint32_t frames;
+    uint32_t firstTimestamp;
+};
+
+struct TelemetryLogFooter {
+    uint64_t indexOffset;
+    uint32_t magic;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(TelemetryLogHeader) == 16, "log header layout");
+static_assert(sizeof(TelemetryLogChunk) == 24, "log chunk layout");
+static_assert(sizeof(TelemetryLogIndexEntry) == 16, "log index layout");
+static_assert(sizeof(TelemetryLogFooter) == 16, "log footer layout");
+
+//Appends frames to a log file.
+class TelemetryLogWriter {
+
+public:
+
+    TelemetryLogWriter();
+    ~TelemetryLogWriter();
+
+    bool open(const char* path);
+
+    //Append one frame, as passed to a TelemetryDecoder handler.
+    bool append(const TelemetryFrame& frame);
+
+    //Write the last chunk, the index and the footer.
+    bool close();
+
+    uint64_t bytesWritten() const { return written; }
+
+private:
+
+    bool flush();
+
+    FILE* file;
+    std::vector<uint8_t> chunk;
+    TelemetryLogChunk header;
+    std::vector<TelemetryLogIndexEntry> index;
+    uint64_t written;
+    bool failed;
+
+};
+
+//Reads a log through a read-only memory map.
+class TelemetryLogReader {
+
+public:
+
+    TelemetryLogReader();
+    ~TelemetryLogReader();
+
+    bool open(const char* path);
+    void close();
+
+    //Whether the log was closed cleanly and has an index.
+    bool indexed() const { return hasIndex; }
+
+    size_t chunkCount() const { return chunks.size(); }
+    TelemetryLogChunk chunk(size_t i) const;
+
+    //Call handler for every frame of a chunk; returns the number of frames
+    //that failed to parse.
+    size_t readChunk(size_t i, const TelemetryDecoder::FrameHandler& handler) const;
+
+    //Whether a file starts with a log header.
+    static bool isLog(const char* path);
+
+private:
+
+    const uint8_t* map;
+    size_t mapSize;
+    std::vector<uint64_t> chunks;
+    bool hasIndex;
+
+};
+
+#endif /* TELEMETRY_LOG_H */
@@ -0,0 +1,220 @@
+/**
+ * Bit-exactness check and benchmark of the CIC block path.
+ *
+ * Checks that CicDecimator::pushBlock() gives exactly the outputs of
+ * push() on the same samples, for orders 1 to 3, several decimation
+ * ratios and random block lengths, on random readings over the full
+ * 16-bit range (so the integrators wrap). The packed SMLAD kernel from
+ * CicKernel.h is built on a portable SMLAD (CIC_EMULATE_DSP) and also
+ * checked directly against the scalar kernel, including blocks of
+ * CIC_KERNEL_MAX_BLOCK full scale samples.
+ *
+ * Then times push() against pushBlock() per raw sample at increasing
+ * ratios, with blocks of 32 samples as read from the ADXL345 FIFO. On the
+ * host the SMLAD is emulated, so only the trend means anything; the
+ * Cortex-M4 cost needs the firmware profiler.
+ *
+ * Usage: cic_check [samples]
+ *
+ * Exits with 1 on the first mismatch.
+ */
+#define CIC_EMULATE_DSP
+#include "CicDecimator.h"
+
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHANNELS 3
+//Samples per pushBlock() in the benchmark: a full ADXL345 FIFO.
+#define FIFO_DEPTH 32
+
+static unsigned int seed = 1;
+
+static int16_t randomCount(void) {
+
+    seed = seed * 1103515245 + 12345;
+    return (int16_t) (seed >> 8);
+
+}
+
+//Samples of every channel, planar for pushBlock().
+struct Samples {
+    std::vector<int16_t> channel[CHANNELS];
+};
+
+static Samples randomSamples(size_t n) {
+
+    Samples samples;
+
+    for (int c = 0; c < CHANNELS; c++) {
+        samples.channel[c].resize(n);
+        for (size_t i = 0; i < n; i++) {
+            samples.channel[c][i] = randomCount();
+        }
+    }
+
+    return samples;
+
+}
+
+template <int RATIO, int ORDER>
+static bool checkDecimator(const Samples& samples) {
+
+    CicDecimator<RATIO, ORDER, CHANNELS> reference;
+    CicDecimator<RATIO, ORDER, CHANNELS> block;
+    size_t n = samples.channel[0].size();
+    std::vector<int32_t> expected;
+    std::vector<int32_t> actual(CHANNELS * (n / RATIO + 1));
+    int16_t sample[CHANNELS];
+    int32_t output[CHANNELS];
+
+    for (size_t i = 0; i < n; i++) {
+        for (int c = 0; c < CHANNELS; c++) {
+            sample[c] = samples.channel[c][i];
+        }
+        if (reference.push(sample, output)) {
+            expected.insert(expected.end(), output, output + CHANNELS);
+        }
+    }
+
+    //Random block lengths, from single samples to several outputs' worth.
+    size_t produced = 0;
+    for (size_t i = 0; i < n; ) {
+        size_t k = 1 + (unsigned) randomCount() % (3 * RATIO);
+        if (k > n - i) {
+            k = n - i;
+        }
+        const int16_t* channels[CHANNELS];
+        for (int c = 0; c < CHANNELS; c++) {
+            channels[c] = &samples.channel[c][i];
+        }
+        produced += block.pushBlock(channels, (int) k, &actual[CHANNELS * produced]);
+        i += k;
+    }
+
+    if (produced * CHANNELS != expected.size()) {
+        printf("cic %d/%d: %d block outputs, %d expected\n", RATIO, ORDER, (int) produced,
+               (int) (expected.size() / CHANNELS));
+        return false;
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (actual[i] != expected[i]) {
+            printf("cic %d/%d: output %d channel %d is %ld, expected %ld\n", RATIO, ORDER, (int) (i / CHANNELS),
+                   (int) (i % CHANNELS), (long) actual[i], (long) expected[i]);
+            return false;
+        }
+    }
+
+    printf("cic %d/%d: %d outputs match\n", RATIO, ORDER, (int) produced);
+    return true;
+
+}
+
+static bool checkKernel(const int16_t* x, int k) {
+
+    uint32_t sum[2] = {0, 0};
+    uint32_t weighted[2] = {0, 0};
+
+    cicBlockSumsScalar(x, k, &sum[0], &weighted[0]);
+    cicBlockSumsPacked(x, k, &sum[1], &weighted[1]);
+
+    if (sum[0] != sum[1] || weighted[0] != weighted[1]) {
+        printf("kernel, %d samples: packed sums %lu %lu, scalar %lu %lu\n", k, (unsigned long) sum[1],
+               (unsigned long) weighted[1], (unsigned long) sum[0], (unsigned long) weighted[0]);
+        return false;
+    }
+
+    return true;
+
+}
+
+static bool checkKernels(void) {
+
+    std::vector<int16_t> x(CIC_KERNEL_MAX_BLOCK);
+
+    for (int k = 1; k <= 1000; k++) {
+        for (int i = 0; i < k; i++) {
+            x[i] = randomCount();
+        }
+        if (!checkKernel(&x[0], k)) {
+            return false;
+        }
+    }
+
+    //Largest weights and samples, both signs.
+    const int16_t extremes[2] = {-32768, 32767};
+    for (int e = 0; e < 2; e++) {
+        for (int i = 0; i < CIC_KERNEL_MAX_BLOCK; i++) {
+            x[i] = extremes[e];
+        }
+        if (!checkKernel(&x[0], CIC_KERNEL_MAX_BLOCK) || !checkKernel(&x[0], CIC_KERNEL_MAX_BLOCK - 1)) {
+            return false;
+        }
+    }
+
+    printf("kernel: packed matches scalar\n");
+    return true;
+
+}
+
+template <int RATIO>
+static void benchmark(const Samples& samples) {
+
+    CicDecimator<RATIO, 2, CHANNELS> reference;
+    CicDecimator<RATIO, 2, CHANNELS> block;
+    size_t n = samples.channel[0].size() / FIFO_DEPTH * FIFO_DEPTH;
+    std::vector<int32_t> output(CHANNELS * (FIFO_DEPTH / RATIO + 1));
+    int16_t sample[CHANNELS];
+    volatile int32_t sink = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; i++) {
+        for (int c = 0; c < CHANNELS; c++) {
+            sample[c] = samples.channel[c][i];
+        }
+        if (reference.push(sample, &output[0])) {
+            sink = output[0];
+        }
+    }
+    double perSample = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; i += FIFO_DEPTH) {
+        const int16_t* channels[CHANNELS];
+        for (int c = 0; c < CHANNELS; c++) {
+            channels[c] = &samples.channel[c][i];
+        }
+        if (block.pushBlock(channels, FIFO_DEPTH, &output[0]) > 0) {
+            sink = output[0];
+        }
+    }
+    double perBlock = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+
+    printf("cic %3d/2: push %5.2f ns/sample, pushBlock(%d) %5.2f ns/sample\n", RATIO, perSample, FIFO_DEPTH, perBlock);
+    (void) sink;
+
+}
+
+int main(int argc, char* argv[]) {
+
+    size_t n = (argc > 1) ? atol(argv[1]) : 1000000;
+    Samples samples = randomSamples(n);
+
+    bool ok = checkKernels() &&
+        checkDecimator<1, 1>(samples) && checkDecimator<4, 1>(samples) && checkDecimator<64, 1>(samples) &&
+        checkDecimator<4, 2>(samples) && checkDecimator<16, 2>(samples) && checkDecimator<256, 2>(samples) &&
+        checkDecimator<4, 3>(samples) && checkDecimator<16, 3>(samples);
+    if (!ok) {
+        return 1;
+    }
+
+    benchmark<4>(samples);
+    benchmark<16>(samples);
+    benchmark<64>(samples);
+    benchmark<256>(samples);
+
+    return 0;
+
+}
@@ -0,0 +1,212 @@
+/**
+ * Host benchmark of the orientation engines.
+ *
+ * Every engine is fed the same synthetic motion (smooth rotation about all
+ * three axes, with gyroscope bias, noise and a little linear acceleration)
+ * and reports its cost per update and its attitude error against the true
+ * orientation, then the cost per update when fed blocks of samples at once
+ * and how far that drifts from updating one sample at a time.
+ *
+ * Usage: filter_bench [rate_hz] [seconds]
+ */
+#include "MARGfilter.h"
+#include "MahonyFilter.h"
+#include "MEKFfilter.h"
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+//One set of sensor readings and the true orientation.
+struct BenchSample {
+    double w[3];
+    double a[3];
+    double m[3];
+    double q[4];
+};
+
+//Rotate the earth frame vector d into the sensor frame (q* d q).
+static void toSensor(const double* q, const double* d, double* v) {
+
+    v[0] = 2 * d[0] * (0.5 - q[2] * q[2] - q[3] * q[3]) + 2 * d[1] * (q[1] * q[2] + q[0] * q[3]) + 2 * d[2] * (q[1] * q[3] - q[0] * q[2]);
+    v[1] = 2 * d[0] * (q[1] * q[2] - q[0] * q[3]) + 2 * d[1] * (0.5 - q[1] * q[1] - q[3] * q[3]) + 2 * d[2] * (q[0] * q[1] + q[2] * q[3]);
+    v[2] = 2 * d[0] * (q[0] * q[2] + q[1] * q[3]) + 2 * d[1] * (q[2] * q[3] - q[0] * q[1]) + 2 * d[2] * (0.5 - q[1] * q[1] - q[2] * q[2]);
+
+}
+
+static std::vector<BenchSample> makeMotion(double rate, double seconds) {
+
+    std::mt19937 rng(42);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    const double gravity[3] = {0, 0, 9.81};
+    const double flux[3] = {0.4, 0, -0.3};
+    const double bias[3] = {0.01, -0.02, 0.015};
+    const int substeps = 10;
+    double q[4] = {1, 0, 0, 0};
+    double dt = 1.0 / rate;
+    int n = (int) (seconds * rate);
+    std::vector<BenchSample> samples(n);
+
+    for (int i = 0; i < n; i++) {
+        double t = i * dt;
+        double w[3] = {0.6 * sin(0.7 * t), 0.4 * sin(0.5 * t + 1.0), 0.8 * sin(0.3 * t + 2.0)};
+        //Integrate the true orientation finely, q' = 0.5 q w.
+        for (int s = 0; s < substeps; s++) {
+            double h = 0.5 * dt / substeps;
+            double q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+            q[0] += (-q1 * w[0] - q2 * w[1] - q3 * w[2]) * h;
+            q[1] += (q0 * w[0] + q2 * w[2] - q3 * w[1]) * h;
+            q[2] += (q0 * w[1] - q1 * w[2] + q3 * w[0]) * h;
+            q[3] += (q0 * w[2] + q1 * w[1] - q2 * w[0]) * h;
+            double norm = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+            for (int k = 0; k < 4; k++) {
+                q[k] /= norm;
+            }
+        }
+        BenchSample& sample = samples[i];
+        toSensor(q, gravity, sample.a);
+        toSensor(q, flux, sample.m);
+        for (int k = 0; k < 3; k++) {
+            sample.w[k] = w[k] + bias[k] + 0.005 * noise(rng);
+            sample.a[k] += 0.05 * noise(rng) + 0.3 * sin(2.0 * t + k);
+            sample.m[k] += 0.005 * noise(rng);
+        }
+        for (int k = 0; k < 4; k++) {
+            sample.q[k] = q[k];
+        }
+    }
+
+    return samples;
+
+}
+
+//Angle in degrees between two orientations.
+static double attitudeError(const double* p, const double* q) {
+
+    double dot = fabs(p[0] * q[0] + p[1] * q[1] + p[2] * q[2] + p[3] * q[3]);
+    //A diverged engine's NaN would otherwise pass every comparison as no
+    //error at all; count it as half a turn.
+    if (!isfinite(dot)) {
+        return 180.0;
+    }
+    if (dot > 1.0) {
+        dot = 1.0;
+    }
+    return 2.0 * acos(dot) * 57.2957795;
+
+}
+
+//Samples per block update, e.g. a drained ADXL345 FIFO.
+#define BENCH_BLOCK 32
+
+template <class Engine>
+static void bench(const char* name, Engine& engine, const std::vector<BenchSample>& samples) {
+
+    const int repeats = 20;
+    double sumSquares = 0;
+    double maxError = 0;
+    int counted = 0;
+    double q[4];
+
+    //Accuracy pass, skipping the first 10% while the engine converges.
+    engine.reset();
+    for (size_t i = 0; i < samples.size(); i++) {
+        const BenchSample& s = samples[i];
+        engine.update(s.w[0], s.w[1], s.w[2], s.a[0], s.a[1], s.a[2], s.m[0], s.m[1], s.m[2]);
+        if (i >= samples.size() / 10) {
+            engine.getQuaternion(q);
+            double error = attitudeError(q, s.q);
+            sumSquares += error * error;
+            if (error > maxError) {
+                maxError = error;
+            }
+            counted++;
+        }
+    }
+
+    //Timing pass.
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        engine.reset();
+        for (size_t i = 0; i < samples.size(); i++) {
+            const BenchSample& s = samples[i];
+            engine.update(s.w[0], s.w[1], s.w[2], s.a[0], s.a[1], s.a[2], s.m[0], s.m[1], s.m[2]);
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%-8s %8.1f ns/update  rms %6.2f deg  max %6.2f deg\n",
+           name, ns / (repeats * samples.size()), sqrt(sumSquares / counted), maxError);
+
+    //Block updates of the same samples, against one sample at a time.
+    std::vector<OrientationSample> block(samples.size());
+    std::vector<OrientationOutput> out(samples.size() / BENCH_BLOCK);
+    for (size_t i = 0; i < samples.size(); i++) {
+        for (int k = 0; k < 3; k++) {
+            block[i].w[k] = samples[i].w[k];
+            block[i].a[k] = samples[i].a[k];
+            block[i].m[k] = samples[i].m[k];
+        }
+    }
+
+    std::vector<double> single;
+    engine.reset();
+    for (size_t i = 0; i < samples.size(); i++) {
+        const BenchSample& s = samples[i];
+        engine.update(s.w[0], s.w[1], s.w[2], s.a[0], s.a[1], s.a[2], s.m[0], s.m[1], s.m[2]);
+        if ((i + 1) % BENCH_BLOCK == 0) {
+            engine.getQuaternion(q);
+            single.insert(single.end(), q, q + 4);
+        }
+    }
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        engine.reset();
+        for (size_t i = 0; i + BENCH_BLOCK <= samples.size(); i += BENCH_BLOCK) {
+            engine.update(&block[i], BENCH_BLOCK, &out[i / BENCH_BLOCK], BENCH_BLOCK);
+        }
+    }
+    ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    double difference = 0;
+    for (size_t i = 0; i < out.size(); i++) {
+        for (int k = 0; k < 4; k++) {
+            difference = fmax(difference, fabs(out[i].q[k] - single[4 * i + k]));
+        }
+    }
+
+    printf("%-8s %8.1f ns/update  blocks of %d, max difference %g\n",
+           name, ns / (repeats * out.size() * BENCH_BLOCK), BENCH_BLOCK, difference);
+
+}
+
+int main(int argc, char* argv[]) {
+
+    double rate = (argc > 1) ? atof(argv[1]) : 100.0;
+    double seconds = (argc > 2) ? atof(argv[2]) : 600.0;
+    std::vector<BenchSample> samples = makeMotion(rate, seconds);
+
+    printf("%d samples at %.0f Hz\n", (int) samples.size(), rate);
+
+    MARGfilter marg(1.0 / rate, 5.0, 0.2);
+    MahonyFilter mahony(1.0 / rate, 1.0, 0.05);
+    MEKFfilter mekf(1.0 / rate, 0.3, 0.01, 0.1, 0.05);
+
+    bench("marg", marg, samples);
+    bench("mahony", mahony, samples);
+    bench("mekf", mekf, samples);
+
+    double covariance[9];
+    double bias[3];
+    mekf.getAttitudeCovariance(covariance);
+    mekf.getGyroBias(bias);
+    printf("mekf attitude sigma %.2f %.2f %.2f deg, bias %.4f %.4f %.4f rad/s\n",
+           sqrt(covariance[0]) * 57.2957795, sqrt(covariance[4]) * 57.2957795, sqrt(covariance[8]) * 57.2957795,
+           bias[0], bias[1], bias[2]);
+
+    return 0;
+
+}
@@ -0,0 +1,407 @@
+/**
+ * Replay one long dataset through the MARG filter on every core.
+ *
+ * The log is split into consecutive chunks, one per worker at a time. A
+ * chunk cannot know the filter state at its start, so it either warms up
+ * from a fresh filter over the updates just before it (-w), or restores
+ * the latest checkpoint at or before its start from a file written by an
+ * earlier serial pass (-l). Checkpoints are MARGsnapshot records, so they
+ * can come from a run with a different tuning: the restored state is then
+ * only a starting point and the warm-up still applies after it.
+ *
+ * At every seam it reports how far the state the next chunk starts from
+ * is from where the previous chunk ended, and, with -c, how far each
+ * chunk's output strays from a plain serial replay, and for how long.
+ *
+ * Usage: filter_replay [options] dataset
+ *
+ *   -r hz     filter rate, rounded to divide the dataset's rate (dataset)
+ *   -e deg/s  gyroscope measurement error (5)
+ *   -d deg/s/s gyroscope measurement drift (0.2)
+ *   -n chunks number of chunks (4 per thread)
+ *   -j n      worker threads (all cores)
+ *   -w secs   warm-up before every chunk (30)
+ *   -s secs   skip the first seconds when scoring against the truth (5)
+ *   -c        also replay serially and compare every update with it
+ *   -k n      with -c, write a checkpoint every n updates of the serial
+ *             replay to the file given by -o
+ *   -o file   checkpoint file to write
+ *   -l file   checkpoint file to start the chunks from
+ *   -t deg    divergence below which a chunk has rejoined the serial
+ *             replay (0.01)
+ */
+#include "Dataset.h"
+#include "MARGfilter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define CHECKPOINT_MAGIC "MARGckp1"
+
+//Start of a checkpoint file.
+struct CheckpointHeader {
+    char magic[8];
+    //Tuning of the run that wrote it.
+    double period;
+    double error;
+    double drift;
+    uint64_t interval;
+    uint64_t count;
+};
+
+//State before update index of the replay.
+struct Checkpoint {
+    uint64_t index;
+    MARGsnapshot snapshot;
+};
+
+struct Chunk {
+    size_t begin;
+    size_t end;
+    //Where the replay of the chunk started, and the orientation it had
+    //reached when it got to begin.
+    size_t start;
+    double q[4];
+    //Against the serial replay: largest divergence in the chunk, and the
+    //updates after begin until it stayed below the threshold.
+    double maxDivergence;
+    size_t rejoined;
+};
+
+//Angle in degrees between two orientations.
+static double attitudeError(const double* p, const double* q) {
+
+    double dot = fabs(p[0] * q[0] + p[1] * q[1] + p[2] * q[2] + p[3] * q[3]);
+    //A diverged engine's NaN would otherwise pass every comparison as no
+    //error at all; count it as half a turn.
+    if (!isfinite(dot)) {
+        return 180.0;
+    }
+    if (dot > 1.0) {
+        dot = 1.0;
+    }
+    return 2.0 * acos(dot) * 57.2957795;
+
+}
+
+static bool readCheckpoints(const char* name, CheckpointHeader& header, std::vector<Checkpoint>& checkpoints) {
+
+    FILE* file = fopen(name, "rb");
+    if (file == 0) {
+        perror(name);
+        return false;
+    }
+
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, CHECKPOINT_MAGIC, 8) == 0;
+    if (ok) {
+        checkpoints.resize(header.count);
+        ok = header.count == 0 || fread(&checkpoints[0], sizeof(Checkpoint), header.count, file) == header.count;
+    }
+    fclose(file);
+
+    if (!ok) {
+        fprintf(stderr, "%s: not a checkpoint file\n", name);
+    }
+    return ok;
+
+}
+
+static bool writeCheckpoints(const char* name, const CheckpointHeader& header, const std::vector<Checkpoint>& checkpoints) {
+
+    FILE* file = fopen(name, "wb");
+    if (file == 0) {
+        perror(name);
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (ok && !checkpoints.empty()) {
+        ok = fwrite(&checkpoints[0], sizeof(Checkpoint), checkpoints.size(), file) == checkpoints.size();
+    }
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok) {
+        perror(name);
+    }
+    return ok;
+
+}
+
+static double rmsError(const std::vector<OrientationOutput>& q, const std::vector<DatasetInput>& inputs, double settle) {
+
+    double sumSquares = 0;
+    long counted = 0;
+
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (inputs[i].t < settle) {
+            continue;
+        }
+        double error = attitudeError(q[i].q, inputs[i].q);
+        sumSquares += error * error;
+        counted++;
+    }
+
+    return counted ? sqrt(sumSquares / counted) : NAN;
+
+}
+
+int main(int argc, char* argv[]) {
+
+    double filterRate = 0;
+    double error = 5.0;
+    double drift = 0.2;
+    int chunkCount = 0;
+    int threads = (int) std::thread::hardware_concurrency();
+    double warmup = 30.0;
+    double settle = 5.0;
+    bool compare = false;
+    size_t interval = 0;
+    const char* output = 0;
+    const char* input = 0;
+    double threshold = 0.01;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-' && argv[arg][1] != 0; arg += 2) {
+        if (argv[arg][1] == 'c') {
+            compare = true;
+            arg--;
+            continue;
+        }
+        if (arg + 1 >= argc) {
+            fprintf(stderr, "%s: %s needs a value\n", argv[0], argv[arg]);
+            return 1;
+        }
+        const char* value = argv[arg + 1];
+        switch (argv[arg][1]) {
+            case 'r': filterRate = atof(value); break;
+            case 'e': error = atof(value); break;
+            case 'd': drift = atof(value); break;
+            case 'n': chunkCount = atoi(value); break;
+            case 'j': threads = atoi(value); break;
+            case 'w': warmup = atof(value); break;
+            case 's': settle = atof(value); break;
+            case 'k': interval = (size_t) atol(value); break;
+            case 'o': output = value; break;
+            case 'l': input = value; break;
+            case 't': threshold = atof(value); break;
+            default:
+                fprintf(stderr, "%s: bad option %s\n", argv[0], argv[arg]);
+                return 1;
+        }
+    }
+
+    if (arg + 1 != argc) {
+        fprintf(stderr, "usage: %s [-r hz] [-e deg/s] [-d deg/s/s] [-n chunks] [-j n] [-w secs] [-s secs] "
+                        "[-c [-k n -o checkpoints]] [-l checkpoints] [-t deg] dataset\n", argv[0]);
+        return 1;
+    }
+    if (output && (!compare || interval == 0)) {
+        fprintf(stderr, "%s: checkpoints are written by the serial replay: -o needs -c and -k\n", argv[0]);
+        return 1;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (chunkCount < 1) {
+        chunkCount = 4 * threads;
+    }
+
+    FILE* file = fopen(argv[arg], "r");
+    if (file == 0) {
+        perror(argv[arg]);
+        return 1;
+    }
+    Dataset dataset;
+    bool ok = dataset.read(file);
+    fclose(file);
+    if (!ok || dataset.samples.empty() || dataset.rate <= 0) {
+        fprintf(stderr, "%s: not a dataset\n", argv[arg]);
+        return 1;
+    }
+
+    if (filterRate <= 0) {
+        filterRate = dataset.rate;
+    }
+    int ratio = (int) floor(dataset.rate / filterRate + 0.5);
+    if (ratio < 1) {
+        ratio = 1;
+    }
+    filterRate = dataset.rate / ratio;
+    double period = 1.0 / filterRate;
+
+    std::vector<DatasetInput> inputs = dataset.inputs(ratio);
+    std::vector<OrientationSample> samples(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        memcpy(samples[i].w, inputs[i].w, sizeof(samples[i].w));
+        memcpy(samples[i].a, inputs[i].a, sizeof(samples[i].a));
+        memcpy(samples[i].m, inputs[i].m, sizeof(samples[i].m));
+    }
+    size_t n = samples.size();
+    if (n == 0) {
+        fprintf(stderr, "%s: no updates at %g Hz\n", argv[arg], filterRate);
+        return 1;
+    }
+    size_t warmupUpdates = (size_t) (warmup * filterRate + 0.5);
+
+    std::vector<Checkpoint> checkpoints;
+    if (input) {
+        CheckpointHeader header;
+        if (!readCheckpoints(input, header, checkpoints)) {
+            return 1;
+        }
+        if (header.period != period || header.error != error || header.drift != drift) {
+            printf("checkpoints from %g Hz, %g deg/s, %g deg/s/s: warming up after them\n",
+                   1.0 / header.period, header.error, header.drift);
+        } else {
+            warmupUpdates = 0;
+        }
+    }
+
+    printf("%s", dataset.description.c_str());
+    printf("%d updates at %.1f Hz (%.1f h), %d chunks on %d threads, %g s warm-up%s\n", (int) n, filterRate,
+           n / filterRate / 3600.0, chunkCount, threads, warmupUpdates / filterRate, input ? " after checkpoints" : "");
+
+    //Serial replay for comparison, checkpointed on the way.
+    std::vector<OrientationOutput> serial;
+    double serialSeconds = 0;
+    if (compare) {
+        MARGfilter filter(period, error, drift);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        serial.resize(n);
+        size_t step = interval ? interval : n;
+        for (size_t i = 0; i < n; i += step) {
+            if (interval) {
+                Checkpoint checkpoint;
+                checkpoint.index = i;
+                filter.getSnapshot(&checkpoint.snapshot);
+                checkpoints.push_back(checkpoint);
+            }
+            filter.update(&samples[i], std::min(step, n - i), &serial[i]);
+        }
+        serialSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (output) {
+            CheckpointHeader header;
+            memcpy(header.magic, CHECKPOINT_MAGIC, 8);
+            header.period = period;
+            header.error = error;
+            header.drift = drift;
+            header.interval = interval;
+            header.count = checkpoints.size();
+            if (!writeCheckpoints(output, header, checkpoints)) {
+                return 1;
+            }
+            printf("wrote %d checkpoints of %d bytes to %s\n", (int) checkpoints.size(), (int) sizeof(Checkpoint), output);
+        }
+        //Written for another run; the chunks start from -l only.
+        if (!input) {
+            checkpoints.clear();
+        }
+    }
+
+    std::vector<Chunk> chunks(chunkCount);
+    for (int k = 0; k < chunkCount; k++) {
+        chunks[k].begin = n * k / chunkCount;
+        chunks[k].end = n * (k + 1) / chunkCount;
+    }
+
+    std::vector<OrientationOutput> parallel(n);
+    std::atomic<size_t> next(0);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&]() {
+            for (size_t k = next++; k < chunks.size(); k = next++) {
+                Chunk& chunk = chunks[k];
+                MARGfilter filter(period, error, drift);
+
+                //Latest checkpoint at or before the warm-up.
+                size_t from = chunk.begin > warmupUpdates ? chunk.begin - warmupUpdates : 0;
+                chunk.start = 0;
+                for (size_t c = 0; c < checkpoints.size() && checkpoints[c].index <= from; c++) {
+                    chunk.start = (size_t) checkpoints[c].index;
+                    filter.restoreSnapshot(&checkpoints[c].snapshot);
+                }
+                if (checkpoints.empty()) {
+                    chunk.start = from;
+                }
+
+                filter.update(&samples[chunk.start], chunk.begin - chunk.start);
+                filter.getQuaternion(chunk.q);
+                filter.update(&samples[chunk.begin], chunk.end - chunk.begin, &parallel[chunk.begin]);
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+    double parallelSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("parallel replay %.3f s", parallelSeconds);
+    if (compare) {
+        printf(", serial %.3f s, speedup %.2fx", serialSeconds, serialSeconds / parallelSeconds);
+    }
+    printf("\n");
+
+    //Seams: the state a chunk started from against where the previous
+    //chunk ended.
+    printf("seam,update,t_s,warmup_updates,seam_deg");
+    if (compare) {
+        printf(",max_vs_serial_deg,rejoined_s");
+    }
+    printf("\n");
+    double worstSeam = 0;
+    double worstSerial = 0;
+    for (size_t k = 1; k < chunks.size(); k++) {
+        Chunk& chunk = chunks[k];
+        if (chunk.begin == chunk.end) {
+            continue;
+        }
+        double seam = attitudeError(parallel[chunk.begin - 1].q, chunk.q);
+        worstSeam = fmax(worstSeam, seam);
+        printf("%d,%d,%.2f,%d,%.4f", (int) k, (int) chunk.begin, inputs[chunk.begin].t,
+               (int) (chunk.begin - chunk.start), seam);
+
+        if (compare) {
+            chunk.maxDivergence = 0;
+            chunk.rejoined = 0;
+            for (size_t i = chunk.begin; i < chunk.end; i++) {
+                double divergence = attitudeError(parallel[i].q, serial[i].q);
+                chunk.maxDivergence = fmax(chunk.maxDivergence, divergence);
+                if (divergence > threshold) {
+                    chunk.rejoined = i + 1 - chunk.begin;
+                }
+            }
+            worstSerial = fmax(worstSerial, chunk.maxDivergence);
+            if (chunk.begin + chunk.rejoined < chunk.end) {
+                printf(",%.4f,%.2f", chunk.maxDivergence, chunk.rejoined / filterRate);
+            } else {
+                printf(",%.4f,never", chunk.maxDivergence);
+            }
+        }
+        printf("\n");
+    }
+
+    printf("worst seam %.4f deg", worstSeam);
+    if (compare) {
+        printf(", worst divergence from serial %.4f deg", worstSerial);
+    }
+    printf("\n");
+
+    printf("rms error against truth after %g s: parallel %.3f deg", settle, rmsError(parallel, inputs, settle));
+    if (compare) {
+        printf(", serial %.3f deg", rmsError(serial, inputs, settle));
+    }
+    printf("\n");
+
+    return 0;
+
+}
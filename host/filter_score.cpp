@@ -0,0 +1,138 @@
+/**
+ * Score the orientation engines on a dataset from trajectory_gen.
+ *
+ * Every engine gets the same readings, converted from raw counts the way
+ * main.cpp does (SensorMounting.h axes, count scales from the dataset
+ * header) and box averaged down to the filter rate. For each engine it
+ * prints the cost per update, the time until the attitude error settles
+ * below the threshold for good, and the rms and maximum error from then
+ * on.
+ *
+ * Usage: filter_score dataset [filter_rate_hz] [threshold_deg]
+ */
+#include "Dataset.h"
+#include "MARGfilter.h"
+#include "MahonyFilter.h"
+#include "MEKFfilter.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+//Angle in degrees between two orientations.
+static double attitudeError(const double* p, const double* q) {
+
+    double dot = fabs(p[0] * q[0] + p[1] * q[1] + p[2] * q[2] + p[3] * q[3]);
+    //A diverged engine's NaN would otherwise pass every comparison as no
+    //error at all; count it as half a turn.
+    if (!isfinite(dot)) {
+        return 180.0;
+    }
+    if (dot > 1.0) {
+        dot = 1.0;
+    }
+    return 2.0 * acos(dot) * 57.2957795;
+
+}
+
+template <class Engine>
+static void score(const char* name, Engine& engine, const std::vector<DatasetInput>& inputs, double threshold) {
+
+    const int repeats = 20;
+    std::vector<double> errors(inputs.size());
+    double q[4];
+
+    //Accuracy pass.
+    engine.reset();
+    for (size_t i = 0; i < inputs.size(); i++) {
+        const DatasetInput& s = inputs[i];
+        engine.update(s.w[0], s.w[1], s.w[2], s.a[0], s.a[1], s.a[2], s.m[0], s.m[1], s.m[2]);
+        engine.getQuaternion(q);
+        errors[i] = attitudeError(q, s.q);
+    }
+
+    //Converged after the last update over the threshold.
+    size_t settled = 0;
+    for (size_t i = 0; i < errors.size(); i++) {
+        if (errors[i] > threshold) {
+            settled = i + 1;
+        }
+    }
+
+    //Timing pass.
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        engine.reset();
+        for (size_t i = 0; i < inputs.size(); i++) {
+            const DatasetInput& s = inputs[i];
+            engine.update(s.w[0], s.w[1], s.w[2], s.a[0], s.a[1], s.a[2], s.m[0], s.m[1], s.m[2]);
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    if (settled >= errors.size()) {
+        printf("%-8s %8.1f ns/update  never below %.1f deg, final error %6.2f deg\n",
+               name, ns / (repeats * inputs.size()), threshold, errors.back());
+        return;
+    }
+
+    double sumSquares = 0;
+    double maxError = 0;
+    for (size_t i = settled; i < errors.size(); i++) {
+        sumSquares += errors[i] * errors[i];
+        maxError = fmax(maxError, errors[i]);
+    }
+
+    printf("%-8s %8.1f ns/update  converged %7.2f s  rms %6.2f deg  max %6.2f deg\n",
+           name, ns / (repeats * inputs.size()), settled == 0 ? 0.0 : inputs[settled].t,
+           sqrt(sumSquares / (errors.size() - settled)), maxError);
+
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s dataset [filter_rate_hz] [threshold_deg]\n", argv[0]);
+        return 1;
+    }
+
+    FILE* file = fopen(argv[1], "r");
+    if (file == 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    Dataset dataset;
+    bool ok = dataset.read(file);
+    fclose(file);
+    if (!ok || dataset.samples.empty() || dataset.rate <= 0) {
+        fprintf(stderr, "%s: not a dataset\n", argv[1]);
+        return 1;
+    }
+
+    double filterRate = (argc > 2) ? atof(argv[2]) : dataset.rate;
+    double threshold = (argc > 3) ? atof(argv[3]) : 2.0;
+    int ratio = (int) floor(dataset.rate / filterRate + 0.5);
+    if (ratio < 1) {
+        ratio = 1;
+    }
+    filterRate = dataset.rate / ratio;
+
+    std::vector<DatasetInput> inputs = dataset.inputs(ratio);
+
+    printf("%s", dataset.description.c_str());
+    printf("%d updates at %.1f Hz (%d samples each), threshold %.1f deg\n", (int) inputs.size(), filterRate, ratio, threshold);
+
+    MARGfilter marg(1.0 / filterRate, 5.0, 0.2);
+    MahonyFilter mahony(1.0 / filterRate, 1.0, 0.05);
+    MEKFfilter mekf(1.0 / filterRate, 0.3, 0.01, 0.1, 0.05);
+
+    score("marg", marg, inputs, threshold);
+    score("mahony", mahony, inputs, threshold);
+    score("mekf", mekf, inputs, threshold);
+
+    return 0;
+
+}
@@ -0,0 +1,300 @@
+/**
+ * Tune the MARG filter over datasets with ground truth.
+ *
+ * Runs a grid over the gyroscope measurement error (beta), measurement
+ * drift (zeta) and filter update rate, scoring each setting by its rms and
+ * maximum attitude error over all the datasets. The datasets are parsed
+ * and converted to filter inputs once per rate, then shared read only by
+ * worker threads on every core, which take trials from a common counter.
+ *
+ * Prints the Pareto front of error against update rate (the best setting
+ * at each rate, where no slower rate does as well), plus the firmware's
+ * own setting for comparison. Every trial can be written to a CSV file.
+ *
+ * Usage: filter_sweep [options] dataset...
+ *
+ *   -e list   gyroscope measurement errors, deg/s (0.05:20:12)
+ *   -d list   gyroscope measurement drifts, deg/s/s (0,0.01,0.03,0.1,0.3,1)
+ *   -r list   filter rates, Hz; rounded to divide each dataset's rate
+ *             (10,20,50,100,200)
+ *   -s secs   skip the first seconds of every dataset while the filter
+ *             converges (5)
+ *   -j n      worker threads (all cores)
+ *   -o file   write every trial as CSV
+ *
+ * A list is comma separated values, or lo:hi:n for n values spaced
+ * logarithmically from lo to hi (linearly if lo is 0).
+ */
+#include "Dataset.h"
+#include "MARGfilter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+//The firmware's setting: FILTER_RATE 0.1, MARGfilter(FILTER_RATE, 0.3, 0.0).
+#define FIRMWARE_RATE  10.0
+#define FIRMWARE_ERROR 0.3
+#define FIRMWARE_DRIFT 0.0
+
+struct Trial {
+    double rate;
+    double error;
+    double drift;
+    //Results, in degrees.
+    double rms;
+    double max;
+};
+
+//Inputs of every dataset at one filter rate.
+struct RateInputs {
+    double rate;
+    std::vector<std::vector<DatasetInput> > datasets;
+};
+
+static bool parseList(const char* text, std::vector<double>& values) {
+
+    double lo, hi;
+    int n;
+
+    values.clear();
+
+    if (sscanf(text, "%lf:%lf:%d", &lo, &hi, &n) == 3) {
+        if (n < 1 || hi < lo || lo < 0) {
+            return false;
+        }
+        for (int i = 0; i < n; i++) {
+            double x = (n == 1) ? 0.0 : (double) i / (n - 1);
+            values.push_back(lo > 0 ? lo * pow(hi / lo, x) : lo + (hi - lo) * x);
+        }
+        return true;
+    }
+
+    for (const char* p = text; *p; ) {
+        char* end;
+        values.push_back(strtod(p, &end));
+        if (end == p) {
+            return false;
+        }
+        p = (*end == ',') ? end + 1 : end;
+    }
+
+    return !values.empty();
+
+}
+
+static double attitudeError(const double* p, const double* q) {
+
+    double dot = fabs(p[0] * q[0] + p[1] * q[1] + p[2] * q[2] + p[3] * q[3]);
+    //A diverged engine's NaN would otherwise pass every comparison as no
+    //error at all; count it as half a turn.
+    if (!isfinite(dot)) {
+        return 180.0;
+    }
+    if (dot > 1.0) {
+        dot = 1.0;
+    }
+    return 2.0 * acos(dot) * 57.2957795;
+
+}
+
+static void evaluate(Trial& trial, const RateInputs& inputs, double settle) {
+
+    double sumSquares = 0;
+    double maxError = 0;
+    long counted = 0;
+    double q[4];
+
+    for (size_t d = 0; d < inputs.datasets.size(); d++) {
+        const std::vector<DatasetInput>& samples = inputs.datasets[d];
+        MARGfilter filter(1.0 / inputs.rate, trial.error, trial.drift);
+
+        for (size_t i = 0; i < samples.size(); i++) {
+            const DatasetInput& s = samples[i];
+            filter.updateFilter(s.w[0], s.w[1], s.w[2], s.a[0], s.a[1], s.a[2], s.m[0], s.m[1], s.m[2]);
+            if (s.t < settle) {
+                continue;
+            }
+            filter.getQuaternion(q);
+            double error = attitudeError(q, s.q);
+            sumSquares += error * error;
+            maxError = fmax(maxError, error);
+            counted++;
+        }
+    }
+
+    trial.rms = counted ? sqrt(sumSquares / counted) : NAN;
+    trial.max = maxError;
+
+}
+
+int main(int argc, char* argv[]) {
+
+    std::vector<double> errors;
+    std::vector<double> drifts;
+    std::vector<double> rates;
+    double settle = 5.0;
+    int threads = (int) std::thread::hardware_concurrency();
+    const char* output = 0;
+
+    parseList("0.05:20:12", errors);
+    parseList("0,0.01,0.03,0.1,0.3,1", drifts);
+    parseList("10,20,50,100,200", rates);
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-' && argv[arg][1] != 0; arg += 2) {
+        if (arg + 1 >= argc) {
+            fprintf(stderr, "%s: %s needs a value\n", argv[0], argv[arg]);
+            return 1;
+        }
+        const char* value = argv[arg + 1];
+        bool ok = true;
+        switch (argv[arg][1]) {
+            case 'e': ok = parseList(value, errors); break;
+            case 'd': ok = parseList(value, drifts); break;
+            case 'r': ok = parseList(value, rates); break;
+            case 's': settle = atof(value); break;
+            case 'j': threads = atoi(value); break;
+            case 'o': output = value; break;
+            default: ok = false; break;
+        }
+        if (!ok) {
+            fprintf(stderr, "%s: bad option %s %s\n", argv[0], argv[arg], value);
+            return 1;
+        }
+    }
+
+    if (arg >= argc) {
+        fprintf(stderr, "usage: %s [-e list] [-d list] [-r list] [-s secs] [-j n] [-o trials.csv] dataset...\n", argv[0]);
+        return 1;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    std::vector<Dataset> datasets(argc - arg);
+    for (int i = arg; i < argc; i++) {
+        FILE* file = fopen(argv[i], "r");
+        if (file == 0) {
+            perror(argv[i]);
+            return 1;
+        }
+        bool ok = datasets[i - arg].read(file);
+        fclose(file);
+        if (!ok || datasets[i - arg].rate <= 0) {
+            fprintf(stderr, "%s: not a dataset\n", argv[i]);
+            return 1;
+        }
+    }
+
+    //Convert once per rate; a rate must divide every dataset's rate.
+    rates.push_back(FIRMWARE_RATE);
+    std::vector<RateInputs> inputs;
+    for (size_t r = 0; r < rates.size(); r++) {
+        int ratio = (int) floor(datasets[0].rate / rates[r] + 0.5);
+        double rate = datasets[0].rate / (ratio < 1 ? 1 : ratio);
+        bool seen = false;
+        for (size_t k = 0; k < inputs.size(); k++) {
+            seen = seen || inputs[k].rate == rate;
+        }
+        if (seen) {
+            continue;
+        }
+        RateInputs at;
+        at.rate = rate;
+        for (size_t d = 0; d < datasets.size(); d++) {
+            int n = (int) floor(datasets[d].rate / rate + 0.5);
+            at.datasets.push_back(datasets[d].inputs(n < 1 ? 1 : n));
+        }
+        inputs.push_back(at);
+    }
+
+    std::vector<Trial> trials;
+    std::vector<int> trialInputs;
+    for (size_t r = 0; r < inputs.size(); r++) {
+        for (size_t e = 0; e < errors.size(); e++) {
+            for (size_t d = 0; d < drifts.size(); d++) {
+                Trial trial = {inputs[r].rate, errors[e], drifts[d], 0, 0};
+                trials.push_back(trial);
+                trialInputs.push_back((int) r);
+            }
+        }
+    }
+    //The firmware's own setting, scored the same way.
+    int firmware = -1;
+    for (size_t r = 0; r < inputs.size(); r++) {
+        if (inputs[r].rate == FIRMWARE_RATE) {
+            Trial trial = {FIRMWARE_RATE, FIRMWARE_ERROR, FIRMWARE_DRIFT, 0, 0};
+            firmware = (int) trials.size();
+            trials.push_back(trial);
+            trialInputs.push_back((int) r);
+        }
+    }
+
+    std::atomic<size_t> next(0);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&]() {
+            for (size_t i = next++; i < trials.size(); i = next++) {
+                evaluate(trials[i], inputs[trialInputs[i]], settle);
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%d trials over %d datasets on %d threads in %.2f s\n", (int) trials.size(), (int) datasets.size(), threads, seconds);
+
+    if (output) {
+        FILE* file = fopen(output, "w");
+        if (file == 0) {
+            perror(output);
+            return 1;
+        }
+        fprintf(file, "rate_hz,gyro_error_dps,gyro_drift_dps2,rms_deg,max_deg\n");
+        for (size_t i = 0; i < trials.size(); i++) {
+            fprintf(file, "%g,%g,%g,%.4f,%.4f\n", trials[i].rate, trials[i].error, trials[i].drift, trials[i].rms, trials[i].max);
+        }
+        fclose(file);
+    }
+
+    //Best trial per rate, then keep those that beat every slower rate.
+    printf("pareto front (error vs update rate):\n");
+    printf("rate_hz,gyro_error_dps,gyro_drift_dps2,rms_deg,max_deg\n");
+    double bestSoFar = INFINITY;
+    std::vector<double> ascending;
+    for (size_t r = 0; r < inputs.size(); r++) {
+        ascending.push_back(inputs[r].rate);
+    }
+    std::sort(ascending.begin(), ascending.end());
+    for (size_t r = 0; r < ascending.size(); r++) {
+        const Trial* best = 0;
+        for (size_t i = 0; i < trials.size(); i++) {
+            if (trials[i].rate == ascending[r] && !isnan(trials[i].rms) && (best == 0 || trials[i].rms < best->rms)) {
+                best = &trials[i];
+            }
+        }
+        if (best && best->rms < bestSoFar) {
+            printf("%g,%g,%g,%.3f,%.3f\n", best->rate, best->error, best->drift, best->rms, best->max);
+            bestSoFar = best->rms;
+        }
+    }
+
+    if (firmware >= 0) {
+        const Trial& setting = trials[firmware];
+        printf("firmware setting: %g Hz, %g deg/s, %g deg/s/s: rms %.3f deg, max %.3f deg\n",
+               setting.rate, setting.error, setting.drift, setting.rms, setting.max);
+    }
+
+    return 0;
+
+}
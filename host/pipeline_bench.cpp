@@ -0,0 +1,182 @@
+/**
+ * Host benchmark of the raw sample pipeline.
+ *
+ * Compares the original per-sample cost of averaging into volatile double
+ * accumulators against the CIC decimator, on the same stream of 16-bit
+ * readings, and checks that both see the same DC level. Then compares the
+ * full conditioning path (average, bias and gain in double) against
+ * SensorChannel (CIC, integer bias, one scale) in ns and, on x86, TSC
+ * cycles per sample.
+ *
+ * Usage: pipeline_bench [samples]
+ */
+#include "CicDecimator.h"
+#include "AxisMap.h"
+#include "SensorChannel.h"
+
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define RATIO 4
+//ITG-3200 sensitivity in rad/s per LSB.
+#define GYROSCOPE_GAIN ((1 / 14.375) * 0.01745329252)
+
+typedef CicDecimator<RATIO, 2> Decimator;
+typedef SensorChannel<AxisMap<AXIS_X, AXIS_Y, AXIS_Z>, Decimator, double> Channel;
+
+//The original scheme: 3 volatile double accumulators, one output every
+//RATIO samples.
+static volatile double accumulator[3];
+static volatile double averaged[3];
+static int accumulated = 0;
+
+static void legacySample(const int16_t* sample) {
+
+    if (accumulated == RATIO) {
+        for (int c = 0; c < 3; c++) {
+            averaged[c] = accumulator[c] / RATIO;
+            accumulator[c] = 0;
+        }
+        accumulated = 0;
+    } else {
+        for (int c = 0; c < 3; c++) {
+            accumulator[c] += sample[c];
+        }
+        accumulated++;
+    }
+
+}
+
+//The original conditioning: average in double, then remove the bias and
+//apply the gain and unit conversion on every output.
+static double bias[3];
+static volatile double conditioned[3];
+
+static void legacyCondition(const int16_t* sample) {
+
+    legacySample(sample);
+    if (accumulated == 0) {
+        for (int c = 0; c < 3; c++) {
+            conditioned[c] = (averaged[c] - bias[c]) * GYROSCOPE_GAIN;
+        }
+    }
+
+}
+
+static unsigned long long cycles(void) {
+
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+
+}
+
+struct Timing {
+    double ns;
+    double cycles;
+};
+
+template <typename F>
+static Timing perSample(F f, size_t n) {
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned long long c0 = cycles();
+    f();
+    unsigned long long c1 = cycles();
+    Timing t;
+    t.ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+    t.cycles = (double) (c1 - c0) / n;
+    return t;
+
+}
+
+int main(int argc, char* argv[]) {
+
+    size_t n = (argc > 1) ? atol(argv[1]) : 10000000;
+    std::vector<int16_t> samples(3 * n);
+    unsigned int seed = 1;
+
+    //DC of (100, -200, 250) counts plus +/-8 counts of noise.
+    for (size_t i = 0; i < n; i++) {
+        for (int c = 0; c < 3; c++) {
+            seed = seed * 1103515245 + 12345;
+            samples[3 * i + c] = (int16_t) ((c == 0 ? 100 : c == 1 ? -200 : 250) + (int) ((seed >> 16) % 17) - 8);
+        }
+    }
+
+    Decimator decimator;
+    int32_t output[3];
+    volatile int32_t sink = 0;
+
+    Timing legacy = perSample([&]() {
+        for (size_t i = 0; i < n; i++) {
+            legacySample(&samples[3 * i]);
+        }
+    }, n);
+
+    Timing cic = perSample([&]() {
+        for (size_t i = 0; i < n; i++) {
+            if (decimator.push(&samples[3 * i], output)) {
+                sink = output[0];
+            }
+        }
+    }, n);
+
+    //Calibrate both conditioning paths on the first samples, as main.cpp
+    //does.
+    Channel channel(GYROSCOPE_GAIN);
+    const size_t calibration = 128;
+    double sum[3] = {0, 0, 0};
+    channel.startCalibration();
+    for (size_t i = 0; i < calibration && i < n; i++) {
+        int raw[3] = {samples[3 * i], samples[3 * i + 1], samples[3 * i + 2]};
+        channel.addCalibrationSample(raw);
+        for (int c = 0; c < 3; c++) {
+            sum[c] += raw[c];
+        }
+    }
+    channel.finishCalibration(0);
+    for (int c = 0; c < 3; c++) {
+        bias[c] = sum[c] / calibration;
+    }
+
+    Timing legacyConditioned = perSample([&]() {
+        for (size_t i = 0; i < n; i++) {
+            legacyCondition(&samples[3 * i]);
+        }
+    }, n);
+
+    double value[3];
+    Timing channelConditioned = perSample([&]() {
+        for (size_t i = 0; i < n; i++) {
+            int raw[3] = {samples[3 * i], samples[3 * i + 1], samples[3 * i + 2]};
+            if (channel.push(raw)) {
+                channel.getOutput(value);
+                sink = (int32_t) value[0];
+            }
+        }
+    }, n);
+    channel.getOutput(value);
+
+    printf("double average: %6.2f ns/sample  %6.1f cycles/sample  last (%.2f %.2f %.2f)\n",
+           legacy.ns, legacy.cycles, (double) averaged[0], (double) averaged[1], (double) averaged[2]);
+    printf("cic %d/%d:       %6.2f ns/sample  %6.1f cycles/sample  last (%.2f %.2f %.2f), group delay %.1f samples\n",
+           RATIO, 2, cic.ns, cic.cycles, (double) output[0] / Decimator::GAIN, (double) output[1] / Decimator::GAIN,
+           (double) output[2] / Decimator::GAIN, Decimator::GROUP_DELAY_2 / 2.0);
+    printf("double conditioning:  %6.2f ns/sample  %6.1f cycles/sample  last (%.5f %.5f %.5f) rad/s\n",
+           legacyConditioned.ns, legacyConditioned.cycles,
+           (double) conditioned[0], (double) conditioned[1], (double) conditioned[2]);
+    printf("integer conditioning: %6.2f ns/sample  %6.1f cycles/sample  last (%.5f %.5f %.5f) rad/s\n",
+           channelConditioned.ns, channelConditioned.cycles, value[0], value[1], value[2]);
+    (void) sink;
+
+    return 0;
+
+}
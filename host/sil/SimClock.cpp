@@ -0,0 +1,105 @@
+/**
+ * Virtual time for software-in-the-loop runs.
+ */
+#include "SimClock.h"
+
+SimClock& SimClock::instance() {
+
+    static SimClock clock;
+    return clock;
+
+}
+
+SimClock::SimClock() : time(0), sequence(0), interrupt(false), deadline(UINT64_MAX) {
+}
+
+SimClock::EventId SimClock::schedule(uint64_t at, const std::function<void ()>& fn) {
+
+    EventId id(at, sequence++);
+    events[id] = fn;
+
+    return id;
+
+}
+
+void SimClock::cancel(const EventId& id) {
+
+    events.erase(id);
+
+}
+
+void SimClock::runDue(uint64_t until) {
+
+    //Events that fell due while an earlier one ran are late, not skipped.
+    while (!events.empty() && events.begin()->first.first <= (until > time ? until : time)) {
+
+        std::map<EventId, std::function<void ()> >::iterator next = events.begin();
+        std::function<void ()> fn = next->second;
+
+        if (next->first.first > time) {
+            time = next->first.first;
+        }
+        events.erase(next);
+
+        interrupt = true;
+        fn();
+        interrupt = false;
+
+        if (time >= deadline) {
+            deadline = UINT64_MAX;
+            onDeadline();
+        }
+
+    }
+
+}
+
+void SimClock::advanceTo(uint64_t at) {
+
+    if (interrupt) {
+        //Busy waiting inside an interrupt holds everything else off.
+        if (at > time) {
+            time = at;
+        }
+        return;
+    }
+
+    runDue(at);
+
+    if (at > time) {
+        time = at;
+    }
+
+    if (time >= deadline) {
+        deadline = UINT64_MAX;
+        onDeadline();
+    }
+
+}
+
+void SimClock::sleep(void) {
+
+    if (interrupt) {
+        return;
+    }
+
+    //With nothing scheduled, sleep until the end of the run.
+    uint64_t wake = events.empty() ? deadline : events.begin()->first.first;
+    if (wake > time) {
+        time = wake;
+    }
+
+}
+
+void SimClock::spend(uint64_t ns) {
+
+    advanceTo(time + ns);
+
+}
+
+void SimClock::setDeadline(uint64_t at, const std::function<void ()>& fn) {
+
+    deadline = at;
+    onDeadline = fn;
+
+}
@@ -0,0 +1,69 @@
+/**
+ * Virtual time for software-in-the-loop runs.
+ *
+ * Time only moves when the firmware waits (wait(), __WFI(), blocking
+ * serial output) or spends time on a bus transfer; code itself takes no
+ * time. Events (Ticker callbacks, UART interrupts) are dispatched in time
+ * order when thread context code waits or unmasks interrupts. Time spent inside an event (e.g. a blocking
+ * I2C read in a Ticker callback) delays later events, as an interrupt of
+ * the same priority would on the target, but never preempts it.
+ */
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <functional>
+#include <map>
+#include <stdint.h>
+#include <utility>
+
+class SimClock {
+
+public:
+
+    typedef std::pair<uint64_t, uint64_t> EventId;
+
+    //The clock shared by everything in the simulation.
+    static SimClock& instance();
+
+    //Virtual time in nanoseconds.
+    uint64_t now() const { return time; }
+
+    //Run fn at the given time; returns a handle for cancel().
+    EventId schedule(uint64_t at, const std::function<void ()>& fn);
+    void cancel(const EventId& id);
+
+    //Thread context waits: move to the given time, running due events.
+    void advanceTo(uint64_t at);
+    void advance(uint64_t ns) { advanceTo(time + ns); }
+
+    //Thread context sleeps until the next event is due (WFI); it runs on
+    //the next advance, e.g. when interrupts are unmasked.
+    void sleep(void);
+
+    //Time spent by the running code itself, e.g. a blocking bus transfer.
+    //Inside an event this only moves the clock; in thread context pending
+    //events run as they fall due.
+    void spend(uint64_t ns);
+
+    bool inInterrupt() const { return interrupt; }
+
+    //Called when the clock first reaches the given time, once.
+    void setDeadline(uint64_t at, const std::function<void ()>& fn);
+
+private:
+
+    SimClock();
+
+    void runDue(uint64_t until);
+
+    uint64_t time;
+    uint64_t sequence;
+    bool interrupt;
+    std::map<EventId, std::function<void ()> > events;
+
+    uint64_t deadline;
+    std::function<void ()> onDeadline;
+
+};
+
+#endif /* SIM_CLOCK_H */
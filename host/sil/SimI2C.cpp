@@ -0,0 +1,183 @@
+/**
+ * Simulated I2C bus and register-level device base class.
+ */
+#include "SimI2C.h"
+#include "SimClock.h"
+
+#include <string.h>
+
+SimI2CDevice::SimI2CDevice(int address7) : reads(0), writes(0), bytes(0), busTime(0), pointer(0), address(address7) {
+}
+
+void SimI2CDevice::write(const uint8_t* data, int length) {
+
+    update(SimClock::instance().now());
+    writes++;
+    bytes += length;
+
+    if (length == 0) {
+        return;
+    }
+
+    pointer = data[0];
+
+    for (int i = 1; i < length; i++) {
+        writeRegister(pointer, data[i]);
+        pointer = nextRegister(pointer);
+    }
+
+}
+
+void SimI2CDevice::read(uint8_t* data, int length) {
+
+    update(SimClock::instance().now());
+    reads++;
+    bytes += length;
+
+    uint8_t first = pointer;
+    beginRead(first);
+
+    for (int i = 0; i < length; i++) {
+        data[i] = readRegister(pointer);
+        pointer = nextRegister(pointer);
+    }
+
+    endRead(first, length);
+
+}
+
+SimI2CBus::SimI2CBus() : transfers(0), nacks(0), busyTime(0), hz(100000), forced(false) {
+}
+
+void SimI2CBus::attach(SimI2CDevice* device) {
+
+    devices.push_back(device);
+
+}
+
+void SimI2CBus::frequency(int frequency) {
+
+    if (!forced) {
+        hz = frequency;
+    }
+
+}
+
+void SimI2CBus::forceFrequency(int frequency) {
+
+    hz = frequency;
+    forced = true;
+
+}
+
+SimI2CDevice* SimI2CBus::find(int address) {
+
+    for (size_t i = 0; i < devices.size(); i++) {
+        if (devices[i]->getAddress() == (address >> 1)) {
+            return devices[i];
+        }
+    }
+
+    return 0;
+
+}
+
+uint64_t SimI2CBus::transferTime(int length, bool repeated) const {
+
+    //Start, 9 bits per byte including the address, then stop.
+    uint64_t bits = 1 + 9 * (1 + length) + (repeated ? 0 : 1);
+
+    return bits * 1000000000ULL / hz;
+
+}
+
+int SimI2CBus::write(int address, const uint8_t* data, int length, bool repeated) {
+
+    SimI2CDevice* device = find(address & 0xFE);
+    //Without an acknowledge the master stops after the address byte.
+    uint64_t duration = transferTime(device ? length : 0, repeated);
+
+    transfers++;
+    busyTime += duration;
+
+    if (device == 0) {
+        nacks++;
+        SimClock::instance().spend(duration);
+        return 1;
+    }
+
+    //The device sees the data as the transfer ends.
+    SimClock::instance().spend(duration);
+    device->busTime += duration;
+    device->write(data, length);
+
+    return 0;
+
+}
+
+int SimI2CBus::read(int address, uint8_t* data, int length, bool repeated) {
+
+    SimI2CDevice* device = find(address | 0x01);
+
+    if (device == 0) {
+        uint64_t duration = transferTime(0, repeated);
+        transfers++;
+        nacks++;
+        busyTime += duration;
+        SimClock::instance().spend(duration);
+        memset(data, 0xFF, length);
+        return 1;
+    }
+
+    uint64_t duration = transferTime(length, repeated);
+
+    transfers++;
+    busyTime += duration;
+    device->busTime += duration;
+
+    //The device is sampled as the first data byte is clocked out.
+    SimClock::instance().spend(transferTime(0, true));
+    device->read(data, length);
+    SimClock::instance().spend(duration - transferTime(0, true));
+
+    return 0;
+
+}
+
+void SimI2CBus::transfer(int address, const uint8_t* tx, int txLength, uint8_t* rx, int rxLength,
+                         const std::function<void (int)>& done) {
+
+    SimClock& clock = SimClock::instance();
+    SimI2CDevice* device = find(address & 0xFE);
+    uint64_t at = clock.now();
+
+    if (device == 0) {
+        uint64_t duration = transferTime(0, false);
+        transfers++;
+        nacks++;
+        busyTime += duration;
+        clock.schedule(at + duration, [done]() { done(1); });
+        return;
+    }
+
+    if (txLength > 0) {
+        uint64_t duration = transferTime(txLength, rxLength > 0);
+        transfers++;
+        busyTime += duration;
+        device->busTime += duration;
+        at += duration;
+        clock.schedule(at, [device, tx, txLength]() { device->write(tx, txLength); });
+    }
+
+    if (rxLength > 0) {
+        uint64_t duration = transferTime(rxLength, false);
+        transfers++;
+        busyTime += duration;
+        device->busTime += duration;
+        clock.schedule(at + transferTime(0, true), [device, rx, rxLength]() { device->read(rx, rxLength); });
+        at += duration;
+    }
+
+    clock.schedule(at, [done]() { done(0); });
+
+}
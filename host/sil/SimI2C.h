@@ -0,0 +1,110 @@
+/**
+ * Simulated I2C bus and register-level device base class.
+ *
+ * A transfer takes the time the bits take on the wire at the bus
+ * frequency: start, address byte, data bytes with their acknowledge bits,
+ * and stop unless a repeated start follows. Devices see the same
+ * transactions as a real part: a write sets the register pointer from its
+ * first byte and writes the rest with auto-increment; a read returns
+ * registers from the pointer on, also with auto-increment.
+ *
+ * Transfers either block the caller for their time on the wire, as mbed's
+ * I2C::read() and write() do, or run on virtual time in the background.
+ * Nothing stops the two from overlapping on one bus; the firmware only
+ * makes blocking transfers while its queue is idle.
+ */
+#ifndef SIM_I2C_H
+#define SIM_I2C_H
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+class SimI2CDevice {
+
+public:
+
+    //address is the 7-bit address.
+    SimI2CDevice(int address);
+    virtual ~SimI2CDevice() {}
+
+    int getAddress() const { return address; }
+
+    //One write or read transaction, already addressed to this device.
+    void write(const uint8_t* data, int length);
+    void read(uint8_t* data, int length);
+
+    //Transaction counts, for the run report.
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t bytes;
+    //Time this device has held the bus, in ns.
+    uint64_t busTime;
+
+protected:
+
+    //Bring the device's internal state up to the current virtual time,
+    //e.g. take the samples that fell due since the last access.
+    virtual void update(uint64_t now) = 0;
+
+    virtual uint8_t readRegister(uint8_t reg) = 0;
+    virtual void writeRegister(uint8_t reg, uint8_t value) = 0;
+
+    //Called around each read transaction, e.g. to latch or pop data.
+    virtual void beginRead(uint8_t reg) { (void) reg; }
+    virtual void endRead(uint8_t first, int length) { (void) first; (void) length; }
+
+    //Register pointer after an access to reg.
+    virtual uint8_t nextRegister(uint8_t reg) { return reg + 1; }
+
+    uint8_t pointer;
+
+private:
+
+    int address;
+
+};
+
+class SimI2CBus {
+
+public:
+
+    SimI2CBus();
+
+    void attach(SimI2CDevice* device);
+
+    //Frequency set by the firmware, unless forced to another value.
+    void frequency(int hz);
+    void forceFrequency(int hz);
+    int getFrequency() const { return hz; }
+
+    //8-bit addresses as passed to mbed's I2C; 0 on acknowledge.
+    int write(int address, const uint8_t* data, int length, bool repeated);
+    int read(int address, uint8_t* data, int length, bool repeated);
+
+    //Non-blocking write then read after a repeated start, either of which
+    //may be empty, as an interrupt driven master does it. The caller's
+    //time is not spent: the device sees the data at the same points of
+    //the transfer as above, on virtual time, and done runs as an event
+    //once the stop has gone out, with 0 on acknowledge. The buffers must
+    //stay valid until then.
+    void transfer(int address, const uint8_t* tx, int txLength, uint8_t* rx, int rxLength,
+                  const std::function<void (int)>& done);
+
+    uint64_t transfers;
+    uint64_t nacks;
+    //Time the bus has been busy, in ns.
+    uint64_t busyTime;
+
+private:
+
+    SimI2CDevice* find(int address);
+    uint64_t transferTime(int length, bool repeated) const;
+
+    std::vector<SimI2CDevice*> devices;
+    int hz;
+    bool forced;
+
+};
+
+#endif /* SIM_I2C_H */
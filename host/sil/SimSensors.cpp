@@ -0,0 +1,570 @@
+/**
+ * Register level models of the ADXL345, ITG-3200 and HMC5843.
+ */
+#include "SimSensors.h"
+#include "SimClock.h"
+#include "SensorMounting.h"
+
+#include <math.h>
+#include <string.h>
+
+#define RAD_TO_DEG 57.29577951308232
+#define NS_PER_S   1000000000.0
+
+static int16_t quantise(double counts, int low, int high) {
+
+    double rounded = floor(counts + 0.5);
+
+    if (rounded < low) {
+        return (int16_t) low;
+    }
+    if (rounded > high) {
+        return (int16_t) high;
+    }
+
+    return (int16_t) rounded;
+
+}
+
+SimSensor::SimSensor(const char* sensorName, int address, const Trajectory& path, const SimSensorErrors& sensorErrors, unsigned int seed) :
+    SimI2CDevice(address), samples(0), lost(0), stale(0), trajectory(path), errors(sensorErrors),
+    name(sensorName), random(seed), normal(0.0, 1.0), walked(0), unread(false), cachedAt(UINT64_MAX) {
+
+    walk[0] = 0.0;
+    walk[1] = 0.0;
+    walk[2] = 0.0;
+
+}
+
+double SimSensor::gaussian(void) {
+
+    return normal(random);
+
+}
+
+const SimTruth& SimSensor::truth(uint64_t t) {
+
+    if (t != cachedAt) {
+        trajectory.sample(t / NS_PER_S, cached);
+        cachedAt = t;
+    }
+
+    return cached;
+
+}
+
+template <class Axes>
+void SimSensor::measure(const double* board, uint64_t t, double* sensor) {
+
+    double axes[3];
+
+    Axes::invert(board, axes);
+
+    //The bias walks for as long as time passes, sampled or not.
+    if (t > walked) {
+        double step = errors.drift * sqrt((t - walked) / NS_PER_S);
+        for (int i = 0; i < 3; i++) {
+            walk[i] += step * gaussian();
+        }
+        walked = t;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        sensor[i] = axes[i] * (1.0 + errors.scale[i]) + errors.bias[i] + walk[i] + errors.noise * gaussian();
+    }
+
+}
+
+void SimSensor::newSample(void) {
+
+    samples++;
+    if (unread) {
+        lost++;
+    }
+    unread = true;
+
+}
+
+void SimSensor::dataRead(void) {
+
+    if (!unread) {
+        stale++;
+    }
+    unread = false;
+
+}
+
+/**
+ * ADXL345: 0x53 (ALT ADDRESS low) or 0x1D (high).
+ */
+#define ADXL345_DEVID       0x00
+#define ADXL345_OFSX        0x1E
+#define ADXL345_BW_RATE     0x2C
+#define ADXL345_POWER_CTL   0x2D
+#define ADXL345_INT_SOURCE  0x30
+#define ADXL345_DATA_FORMAT 0x31
+#define ADXL345_DATAX0      0x32
+#define ADXL345_DATAZ1      0x37
+#define ADXL345_FIFO_CTL    0x38
+#define ADXL345_FIFO_STATUS 0x39
+#define ADXL345_FIFO_SIZE   32
+
+//Fixed 10-bit resolution is 256 LSB/g at +/-2g, halving with each range;
+//full resolution keeps 256 LSB/g (3.9mg/LSB) over the whole range.
+#define ADXL345_LSB_PER_G   256.0
+//Offset registers are 15.6mg/LSB.
+#define ADXL345_OFFSET_G    0.0156
+
+SimADXL345::SimADXL345(const Trajectory& path, const SimSensorErrors& sensorErrors, unsigned int seed, int address) :
+    SimSensor("ADXL345", address, path, sensorErrors, seed), measuring(false), next(0), dataReady(false), overrun(false) {
+
+    memset(registers, 0, sizeof(registers));
+    memset(&latest, 0, sizeof(latest));
+    memset(&output, 0, sizeof(output));
+    registers[ADXL345_DEVID] = 0xE5;
+    registers[ADXL345_BW_RATE] = 0x0A;
+
+}
+
+uint64_t SimADXL345::period(void) const {
+
+    //3200Hz halving with each code below 0xF.
+    int code = registers[ADXL345_BW_RATE] & 0x0F;
+
+    return (uint64_t) (NS_PER_S / 3200.0 * (1 << (15 - code)));
+
+}
+
+void SimADXL345::sample(uint64_t t) {
+
+    double g[3];
+    double board[3];
+    const SimTruth& now = truth(t);
+
+    for (int i = 0; i < 3; i++) {
+        board[i] = now.f[i] / trajectory.gravity;
+    }
+    measure<AccelerometerAxes>(board, t, g);
+
+    uint8_t format = registers[ADXL345_DATA_FORMAT];
+    int range = format & 0x03;
+    bool fullResolution = (format & 0x08) != 0;
+    double lsbPerG = fullResolution ? ADXL345_LSB_PER_G : ADXL345_LSB_PER_G / (1 << range);
+    int limit = fullResolution ? (512 << range) : 512;
+
+    Entry entry;
+    for (int i = 0; i < 3; i++) {
+        double offset = (int8_t) registers[ADXL345_OFSX + i] * ADXL345_OFFSET_G;
+        entry.data[i] = quantise((g[i] + offset) * lsbPerG, -limit, limit - 1);
+    }
+
+    newSample();
+
+    if (mode() == 0) {
+        //Bypass: the data registers always hold the latest sample.
+        overrun = overrun || dataReady;
+        latest = entry;
+        dataReady = true;
+        return;
+    }
+
+    if ((int) fifo.size() == ADXL345_FIFO_SIZE) {
+        overrun = true;
+        if (mode() == 1) {
+            //FIFO mode stops collecting when full.
+            return;
+        }
+        //Stream mode keeps the newest.
+        fifo.pop_front();
+    }
+    fifo.push_back(entry);
+
+}
+
+void SimADXL345::update(uint64_t now) {
+
+    if (!measuring) {
+        return;
+    }
+
+    uint64_t step = period();
+
+    //Only the last FIFO's worth of samples can still be seen.
+    if (next + (ADXL345_FIFO_SIZE + 1) * step < now) {
+        uint64_t skipped = (now - next) / step - ADXL345_FIFO_SIZE;
+        samples += skipped;
+        lost += skipped;
+        next += skipped * step;
+    }
+
+    while (next <= now) {
+        sample(next);
+        next += step;
+    }
+
+}
+
+uint8_t SimADXL345::readRegister(uint8_t reg) {
+
+    if (reg >= ADXL345_DATAX0 && reg <= ADXL345_DATAZ1) {
+        int index = (reg - ADXL345_DATAX0) >> 1;
+        uint16_t value = (uint16_t) output.data[index];
+        return (reg & 1) ? (uint8_t) (value >> 8) : (uint8_t) value;
+    }
+
+    if (reg == ADXL345_INT_SOURCE) {
+        uint8_t source = 0;
+        if (mode() == 0) {
+            source |= dataReady ? 0x80 : 0;
+        } else {
+            int samples = registers[ADXL345_FIFO_CTL] & 0x1F;
+            source |= fifo.empty() ? 0 : 0x80;
+            source |= (samples > 0 && (int) fifo.size() >= samples) ? 0x02 : 0;
+        }
+        return source | (overrun ? 0x01 : 0);
+    }
+
+    if (reg == ADXL345_FIFO_STATUS) {
+        return (uint8_t) fifo.size();
+    }
+
+    return reg < sizeof(registers) ? registers[reg] : 0;
+
+}
+
+void SimADXL345::writeRegister(uint8_t reg, uint8_t value) {
+
+    //DEVID, the status registers and the data are read only.
+    if (reg < 0x1D || reg == 0x2B || reg == ADXL345_INT_SOURCE || (reg >= ADXL345_DATAX0 && reg <= ADXL345_DATAZ1) || reg >= ADXL345_FIFO_STATUS) {
+        return;
+    }
+
+    registers[reg] = value;
+
+    if (reg == ADXL345_POWER_CTL) {
+        bool measure = (value & 0x08) != 0;
+        if (measure && !measuring) {
+            next = SimClock::instance().now() + period();
+        }
+        measuring = measure;
+    } else if (reg == ADXL345_FIFO_CTL) {
+        //Changing mode empties the FIFO.
+        fifo.clear();
+        overrun = false;
+    }
+
+}
+
+void SimADXL345::beginRead(uint8_t reg) {
+
+    //A burst from INT_SOURCE runs on into the data registers.
+    if (reg < ADXL345_INT_SOURCE || reg > ADXL345_DATAZ1) {
+        return;
+    }
+
+    if (mode() == 0) {
+        output = latest;
+    } else if (!fifo.empty()) {
+        output = fifo.front();
+    }
+
+}
+
+void SimADXL345::endRead(uint8_t first, int length) {
+
+    if (first > ADXL345_DATAZ1 || first + length <= ADXL345_DATAX0) {
+        return;
+    }
+
+    dataRead();
+    overrun = false;
+
+    if (mode() == 0) {
+        dataReady = false;
+    } else if (!fifo.empty()) {
+        //Reading the data pops the oldest entry.
+        fifo.pop_front();
+    }
+
+}
+
+/**
+ * ITG-3200: 0x68 (AD0 low) or 0x69 (high).
+ */
+#define ITG3200_WHO_AM_I   0x00
+#define ITG3200_SMPLRT_DIV 0x15
+#define ITG3200_DLPF_FS    0x16
+#define ITG3200_INT_CFG    0x17
+#define ITG3200_INT_STATUS 0x1A
+#define ITG3200_TEMP_OUT_H 0x1B
+#define ITG3200_GYRO_XOUT_H 0x1D
+#define ITG3200_GYRO_ZOUT_L 0x22
+#define ITG3200_PWR_MGM    0x3E
+
+#define ITG3200_LSB_PER_DPS 14.375
+//Die temperature, counts: -13200 at 35 degrees C, 280 per degree.
+#define ITG3200_TEMPERATURE 25.0
+
+SimITG3200::SimITG3200(const Trajectory& path, const SimSensorErrors& sensorErrors, unsigned int seed, int address) :
+    SimSensor("ITG3200", address, path, sensorErrors, seed), dataReady(false) {
+
+    memset(registers, 0, sizeof(registers));
+    memset(data, 0, sizeof(data));
+    registers[ITG3200_WHO_AM_I] = 0x68;
+    next = period();
+
+}
+
+uint64_t SimITG3200::period(void) const {
+
+    //8kHz internal rate with the low pass filter off, 1kHz otherwise.
+    double internal = (registers[ITG3200_DLPF_FS] & 0x07) == 0 ? 8000.0 : 1000.0;
+
+    return (uint64_t) (NS_PER_S * (registers[ITG3200_SMPLRT_DIV] + 1) / internal);
+
+}
+
+void SimITG3200::sample(uint64_t t) {
+
+    double rate[3];
+    const SimTruth& now = truth(t);
+
+    measure<GyroscopeAxes>(now.w, t, rate);
+
+    for (int i = 0; i < 3; i++) {
+        data[i + 1] = quantise(rate[i] * RAD_TO_DEG * ITG3200_LSB_PER_DPS, -32768, 32767);
+    }
+    data[0] = quantise(-13200 + 280 * (ITG3200_TEMPERATURE - 35.0), -32768, 32767);
+
+    newSample();
+    dataReady = true;
+
+}
+
+void SimITG3200::update(uint64_t now) {
+
+    if (registers[ITG3200_PWR_MGM] & 0x40) {
+        //Asleep.
+        next = now + period();
+        return;
+    }
+
+    if (next > now) {
+        return;
+    }
+
+    //Registers only ever show the newest sample.
+    uint64_t step = period();
+    uint64_t count = (now - next) / step + 1;
+    uint64_t last = next + (count - 1) * step;
+
+    samples += count - 1;
+    lost += count - 1;
+    sample(last);
+    next = last + step;
+
+}
+
+uint8_t SimITG3200::readRegister(uint8_t reg) {
+
+    if (reg >= ITG3200_TEMP_OUT_H && reg <= ITG3200_GYRO_ZOUT_L) {
+        //Big endian, high byte first.
+        uint16_t value = (uint16_t) data[(reg - ITG3200_TEMP_OUT_H) >> 1];
+        return (reg & 1) ? (uint8_t) (value >> 8) : (uint8_t) value;
+    }
+
+    if (reg == ITG3200_INT_STATUS) {
+        //ITG_RDY is set once the PLL is up, which the model skips.
+        uint8_t status = 0x04 | (dataReady ? 0x01 : 0);
+        dataReady = false;
+        return status;
+    }
+
+    return reg < sizeof(registers) ? registers[reg] : 0;
+
+}
+
+void SimITG3200::writeRegister(uint8_t reg, uint8_t value) {
+
+    if (reg == ITG3200_WHO_AM_I) {
+        registers[reg] = (registers[reg] & 0x81) | (value & 0x7E);
+        return;
+    }
+
+    if (reg != ITG3200_SMPLRT_DIV && reg != ITG3200_DLPF_FS && reg != ITG3200_INT_CFG && reg != ITG3200_PWR_MGM) {
+        return;
+    }
+
+    if (reg == ITG3200_PWR_MGM && (value & 0x80)) {
+        //H_RESET.
+        memset(registers, 0, sizeof(registers));
+        registers[ITG3200_WHO_AM_I] = 0x68;
+        next = SimClock::instance().now() + period();
+        return;
+    }
+
+    registers[reg] = value;
+
+    if (reg == ITG3200_SMPLRT_DIV || reg == ITG3200_DLPF_FS) {
+        next = SimClock::instance().now() + period();
+    }
+
+}
+
+void SimITG3200::endRead(uint8_t first, int length) {
+
+    if (first > ITG3200_GYRO_ZOUT_L || first + length <= ITG3200_GYRO_XOUT_H) {
+        return;
+    }
+
+    //One reading per transfer that starts at or before the X axis: a
+    //burst from INT_STATUS, or getGyroX() on its own.
+    if (first <= ITG3200_GYRO_XOUT_H) {
+        dataRead();
+    }
+
+    //INT_ANYRD_2CLEAR.
+    if (registers[ITG3200_INT_CFG] & 0x10) {
+        dataReady = false;
+    }
+
+}
+
+/**
+ * HMC5843: 0x1E.
+ */
+#define HMC5843_CONFIG_A 0x00
+#define HMC5843_CONFIG_B 0x01
+#define HMC5843_MODE     0x02
+#define HMC5843_X_MSB    0x03
+#define HMC5843_Z_LSB    0x08
+#define HMC5843_STATUS   0x09
+#define HMC5843_IDENT_C  0x0C
+//Output on overflow.
+#define HMC5843_OVERFLOW -4096
+
+static const double hmc5843Rates[8] = {0.5, 1.0, 2.0, 5.0, 10.0, 20.0, 50.0, 50.0};
+static const double hmc5843Gains[8] = {1620.0, 1300.0, 970.0, 780.0, 530.0, 460.0, 390.0, 280.0};
+
+SimHMC5843::SimHMC5843(const Trajectory& path, const SimSensorErrors& sensorErrors, unsigned int seed) :
+    SimSensor("HMC5843", 0x1E, path, sensorErrors, seed), next(0), sampling(false), ready(false) {
+
+    memset(registers, 0, sizeof(registers));
+    memset(data, 0, sizeof(data));
+    registers[HMC5843_CONFIG_A] = 0x10;
+    registers[HMC5843_CONFIG_B] = 0x20;
+    //Idle until told otherwise.
+    registers[HMC5843_MODE] = 0x02;
+    registers[0x0A] = 'H';
+    registers[0x0B] = '4';
+    registers[0x0C] = '3';
+
+}
+
+uint64_t SimHMC5843::period(void) const {
+
+    return (uint64_t) (NS_PER_S / hmc5843Rates[(registers[HMC5843_CONFIG_A] >> 2) & 0x07]);
+
+}
+
+void SimHMC5843::sample(uint64_t t) {
+
+    double field[3];
+    const SimTruth& now = truth(t);
+    double gain = hmc5843Gains[registers[HMC5843_CONFIG_B] >> 5];
+
+    measure<MagnetometerAxes>(now.m, t, field);
+
+    for (int i = 0; i < 3; i++) {
+        double counts = floor(field[i] * gain + 0.5);
+        data[i] = (counts < -2048 || counts > 2047) ? HMC5843_OVERFLOW : (int16_t) counts;
+    }
+
+    newSample();
+    ready = true;
+
+}
+
+void SimHMC5843::update(uint64_t now) {
+
+    if (!sampling || next > now) {
+        return;
+    }
+
+    if ((registers[HMC5843_MODE] & 0x03) == 1) {
+        //Single measurement, then back to idle.
+        sample(next);
+        registers[HMC5843_MODE] = 0x02;
+        sampling = false;
+        return;
+    }
+
+    uint64_t step = period();
+    uint64_t count = (now - next) / step + 1;
+    uint64_t last = next + (count - 1) * step;
+
+    samples += count - 1;
+    lost += count - 1;
+    sample(last);
+    next = last + step;
+
+}
+
+uint8_t SimHMC5843::readRegister(uint8_t reg) {
+
+    if (reg >= HMC5843_X_MSB && reg <= HMC5843_Z_LSB) {
+        uint16_t value = (uint16_t) data[(reg - HMC5843_X_MSB) >> 1];
+        return (reg & 1) ? (uint8_t) (value >> 8) : (uint8_t) value;
+    }
+
+    if (reg == HMC5843_STATUS) {
+        return ready ? 0x01 : 0x00;
+    }
+
+    return reg < sizeof(registers) ? registers[reg] : 0;
+
+}
+
+void SimHMC5843::writeRegister(uint8_t reg, uint8_t value) {
+
+    if (reg > HMC5843_MODE) {
+        return;
+    }
+
+    registers[reg] = value;
+
+    if (reg == HMC5843_MODE) {
+        int mode = value & 0x03;
+        sampling = mode <= 1;
+        if (mode == 0) {
+            next = SimClock::instance().now() + period();
+        } else if (mode == 1) {
+            //A single measurement takes a few milliseconds.
+            next = SimClock::instance().now() + 10000000ULL;
+        }
+    } else if (reg == HMC5843_CONFIG_A && sampling) {
+        next = SimClock::instance().now() + period();
+    }
+
+}
+
+void SimHMC5843::endRead(uint8_t first, int length) {
+
+    if (first > HMC5843_Z_LSB || first + length <= HMC5843_X_MSB) {
+        return;
+    }
+
+    //One read per sample from X on, whether of all axes or just X.
+    if (first <= HMC5843_X_MSB) {
+        dataRead();
+    }
+    ready = false;
+
+}
+
+uint8_t SimHMC5843::nextRegister(uint8_t reg) {
+
+    //The pointer wraps after the identification registers.
+    return reg >= HMC5843_IDENT_C ? 0 : reg + 1;
+
+}
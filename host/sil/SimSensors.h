@@ -0,0 +1,166 @@
+/**
+ * Register level models of the ADXL345, ITG-3200 and HMC5843.
+ *
+ * Each model samples the ground truth trajectory at its own output data
+ * rate, as set through its registers, maps the board frame truth back to
+ * the sensor's own axes (the inverse of SensorMounting.h) and applies
+ * scale, bias, random walk and white noise errors before quantising to
+ * counts. Only what the datasheets specify for register access is
+ * modelled; internal low pass filters, self test and interrupt pins are
+ * not.
+ */
+#ifndef SIM_SENSORS_H
+#define SIM_SENSORS_H
+
+#include <deque>
+#include <random>
+
+#include "SimI2C.h"
+#include "Trajectory.h"
+
+//Error model of one sensor, in the sensor's own units and axes.
+struct SimSensorErrors {
+    //White noise, rms.
+    double noise;
+    //Fixed bias.
+    double bias[3];
+    //Bias random walk, per square root second.
+    double drift;
+    //Scale factor error, e.g. 0.01 for 1% too large.
+    double scale[3];
+};
+
+class SimSensor : public SimI2CDevice {
+
+public:
+
+    SimSensor(const char* name, int address, const Trajectory& trajectory, const SimSensorErrors& errors, unsigned int seed);
+
+    const char* getName() const { return name; }
+
+    //Samples taken, samples overwritten before they were read, and data
+    //reads that returned a sample already read.
+    uint64_t samples;
+    uint64_t lost;
+    uint64_t stale;
+
+protected:
+
+    //Sample the truth at virtual time t (ns); the measurement is in the
+    //sensor's axes, with errors applied. Board frame truth is mapped with
+    //the inverse of the firmware's AxisMap for this sensor.
+    template <class Axes>
+    void measure(const double* board, uint64_t t, double* sensor);
+
+    const SimTruth& truth(uint64_t t);
+
+    //Book keeping for samples and data reads.
+    void newSample(void);
+    void dataRead(void);
+
+    const Trajectory& trajectory;
+    SimSensorErrors errors;
+
+private:
+
+    double gaussian(void);
+
+    const char* name;
+    std::mt19937 random;
+    std::normal_distribution<double> normal;
+    double walk[3];
+    uint64_t walked;
+    bool unread;
+    SimTruth cached;
+    uint64_t cachedAt;
+
+};
+
+class SimADXL345 : public SimSensor {
+
+public:
+
+    SimADXL345(const Trajectory& trajectory, const SimSensorErrors& errors, unsigned int seed, int address = 0x53);
+
+protected:
+
+    void update(uint64_t now);
+    uint8_t readRegister(uint8_t reg);
+    void writeRegister(uint8_t reg, uint8_t value);
+    void beginRead(uint8_t reg);
+    void endRead(uint8_t first, int length);
+
+private:
+
+    struct Entry {
+        int16_t data[3];
+    };
+
+    void sample(uint64_t t);
+    uint64_t period(void) const;
+    int mode(void) const { return registers[0x38] >> 6; }
+
+    uint8_t registers[0x40];
+    bool measuring;
+    uint64_t next;
+    Entry latest;
+    Entry output;
+    std::deque<Entry> fifo;
+    bool dataReady;
+    bool overrun;
+
+};
+
+class SimITG3200 : public SimSensor {
+
+public:
+
+    SimITG3200(const Trajectory& trajectory, const SimSensorErrors& errors, unsigned int seed, int address = 0x68);
+
+protected:
+
+    void update(uint64_t now);
+    uint8_t readRegister(uint8_t reg);
+    void writeRegister(uint8_t reg, uint8_t value);
+    void endRead(uint8_t first, int length);
+
+private:
+
+    void sample(uint64_t t);
+    uint64_t period(void) const;
+
+    uint8_t registers[0x40];
+    uint64_t next;
+    int16_t data[4];
+    bool dataReady;
+
+};
+
+class SimHMC5843 : public SimSensor {
+
+public:
+
+    SimHMC5843(const Trajectory& trajectory, const SimSensorErrors& errors, unsigned int seed);
+
+protected:
+
+    void update(uint64_t now);
+    uint8_t readRegister(uint8_t reg);
+    void writeRegister(uint8_t reg, uint8_t value);
+    void endRead(uint8_t first, int length);
+    uint8_t nextRegister(uint8_t reg);
+
+private:
+
+    void sample(uint64_t t);
+    uint64_t period(void) const;
+
+    uint8_t registers[13];
+    uint64_t next;
+    bool sampling;
+    int16_t data[3];
+    bool ready;
+
+};
+
+#endif /* SIM_SENSORS_H */
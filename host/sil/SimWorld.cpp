@@ -0,0 +1,293 @@
+/**
+ * The simulated board the firmware runs on in software-in-the-loop runs.
+ */
+#include "SimWorld.h"
+#include "SimClock.h"
+#include "mbed.h"
+#include "SensorBuses.h"
+
+#include <math.h>
+#include <random>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NS_PER_S 1000000000.0
+
+static double envNumber(const char* name, double fallback) {
+
+    const char* value = getenv(name);
+
+    return (value && *value) ? atof(value) : fallback;
+
+}
+
+static double wallClock(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec * 1e-9;
+
+}
+
+//Errors drawn once per run; k scales everything.
+static SimSensorErrors drawErrors(std::mt19937& random, double k, double noise, double bias, double drift, double scale) {
+
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    SimSensorErrors errors;
+
+    errors.noise = k * noise;
+    errors.drift = k * drift;
+    for (int i = 0; i < 3; i++) {
+        errors.bias[i] = k * bias * uniform(random);
+        errors.scale[i] = k * scale * uniform(random);
+    }
+
+    return errors;
+
+}
+
+//Earth z in the board frame, for the tilt part of the error.
+static void boardUp(const double* q, double* v) {
+
+    v[0] = 2 * (q[1] * q[3] - q[0] * q[2]);
+    v[1] = 2 * (q[0] * q[1] + q[2] * q[3]);
+    v[2] = 1 - 2 * (q[1] * q[1] + q[2] * q[2]);
+
+}
+
+SimWorld& SimWorld::instance() {
+
+    static SimWorld world;
+    return world;
+
+}
+
+SimWorld::SimWorld() : serialFile(0), serialBytes(0), haveOrigin(false), origin(0), timestamp(0),
+    firstEstimate(-1.0),
+    scored(0), invalid(0), sumSquared(0.0), sumTiltSquared(0.0), maxError(0.0), maxTilt(0.0), lastError(0.0) {
+
+    unsigned int seed = (unsigned int) envNumber("SIL_SEED", 1);
+    double k = envNumber("SIL_NOISE", 1.0);
+    std::mt19937 random(seed);
+
+    duration = envNumber("SIL_DURATION", 60.0);
+    settle = envNumber("SIL_SETTLE", 5.0);
+    maxRms = envNumber("SIL_MAX_ERROR", 0.0);
+    minSpeed = envNumber("SIL_MIN_SPEED", 0.0);
+
+    const char* motion = getenv("SIL_TRAJECTORY");
+    if (motion && !trajectory.configure(motion)) {
+        fprintf(stderr, "sil: bad SIL_TRAJECTORY entry in %s\n", motion);
+    }
+
+    //Accelerometer in g, gyroscope in rad/s, magnetometer in gauss; in the
+    //order of the datasheet typicals, hard iron for the magnetometer.
+    SimSensorErrors accelerometerErrors = drawErrors(random, k, 0.004, 0.04, 0.0, 0.01);
+    SimSensorErrors gyroscopeErrors = drawErrors(random, k, 0.005, 0.03, 0.0005, 0.02);
+    SimSensorErrors magnetometerErrors = drawErrors(random, k, 0.002, 0.02, 0.0, 0.02);
+
+    //The first IMU draws as a single one always has, so its readings do
+    //not change with IMU_COUNT; every other IMU is another part.
+    for (int imu = 0; imu < IMU_COUNT; imu++) {
+        unsigned int imuSeed = (seed + 1000 * imu) * 3;
+        if (imu > 0) {
+            accelerometerErrors = drawErrors(random, k, 0.004, 0.04, 0.0, 0.01);
+            gyroscopeErrors = drawErrors(random, k, 0.005, 0.03, 0.0005, 0.02);
+        }
+        attach(new SimADXL345(trajectory, accelerometerErrors, imuSeed + 0, IMU_ALTERNATE(imu) ? 0x1D : 0x53),
+               IMU_ACCELEROMETER_BUS(imu));
+        attach(new SimITG3200(trajectory, gyroscopeErrors, imuSeed + 1, IMU_ALTERNATE(imu) ? 0x69 : 0x68),
+               IMU_GYROSCOPE_BUS(imu));
+    }
+    attach(new SimHMC5843(trajectory, magnetometerErrors, seed * 3 + 2), MAGNETOMETER_BUS);
+
+    int hz = (int) envNumber("SIL_I2C_HZ", 0);
+    if (hz > 0) {
+        sensorBuses[0].forceFrequency(hz);
+        sensorBuses[1].forceFrequency(hz);
+    }
+
+    const char* serial = getenv("SIL_SERIAL");
+    if (serial && *serial) {
+        serialFile = fopen(serial, "wb");
+        if (serialFile == 0) {
+            perror(serial);
+        }
+    }
+
+    onFrame = [this](const TelemetryFrame& f) { frame(f); };
+
+    wallStart = wallClock();
+    SimClock::instance().setDeadline((uint64_t) (duration * NS_PER_S), [this]() { report(); });
+
+}
+
+void SimWorld::attach(SimSensor* sensor, int bus) {
+
+    sensors.push_back(sensor);
+    sensorBus.push_back(bus);
+    sensorBuses[bus].attach(sensor);
+
+}
+
+SimI2CBus* SimWorld::bus(int sda) {
+
+    if (sda == SENSOR_BUS0_SDA) {
+        return &sensorBuses[0];
+    }
+
+    return sda == SENSOR_BUS1_SDA ? &sensorBuses[1] : 0;
+
+}
+
+void SimWorld::serialOutput(int port, uint8_t byte) {
+
+    //Only the USB serial port carries telemetry.
+    if (port != 0) {
+        return;
+    }
+
+    serialBytes++;
+    if (serialFile) {
+        fputc(byte, serialFile);
+    }
+
+    decoder.feed(&byte, 1, onFrame);
+
+}
+
+void SimWorld::timerStarted(uint64_t at) {
+
+    if (!haveOrigin) {
+        origin = at;
+        haveOrigin = true;
+    }
+
+}
+
+void SimWorld::frame(const TelemetryFrame& f) {
+
+    if (!f.hasQuaternion) {
+        return;
+    }
+
+    //Frames arrive in order, so the wrap is the forward difference.
+    timestamp += (uint32_t) (f.timestamp - (uint32_t) timestamp);
+
+    double t = (origin + timestamp * 1000ULL) / NS_PER_S;
+    double truth[4];
+    double estimate[4];
+
+    trajectory.orientation(t, truth);
+    for (int i = 0; i < 4; i++) {
+        estimate[i] = f.quaternion[i];
+    }
+
+    if (firstEstimate < 0) {
+        firstEstimate = t;
+    }
+
+    //Angle of the rotation between the two, either sign of q.
+    double dot = 0.0;
+    for (int i = 0; i < 4; i++) {
+        dot += truth[i] * estimate[i];
+    }
+
+    double up[3];
+    double estimatedUp[3];
+    boardUp(truth, up);
+    boardUp(estimate, estimatedUp);
+    double cosTilt = up[0] * estimatedUp[0] + up[1] * estimatedUp[1] + up[2] * estimatedUp[2];
+
+    //fmin() and fmax() would turn NaN into a perfect score.
+    double error = M_PI;
+    double tilt = M_PI;
+    if (isfinite(dot) && isfinite(cosTilt)) {
+        error = 2.0 * acos(fmin(1.0, fabs(dot)));
+        tilt = acos(fmax(-1.0, fmin(1.0, cosTilt)));
+    } else {
+        invalid++;
+    }
+
+    lastError = error;
+    if (t < firstEstimate + settle) {
+        return;
+    }
+
+    scored++;
+    sumSquared += error * error;
+    sumTiltSquared += tilt * tilt;
+    maxError = fmax(maxError, error);
+    maxTilt = fmax(maxTilt, tilt);
+
+}
+
+void SimWorld::report(void) {
+
+    const double degrees = 57.29577951308232;
+    double wall = wallClock() - wallStart;
+    uint64_t now = SimClock::instance().now();
+    const TelemetryStatistics& stats = decoder.statistics();
+
+    double speed = wall > 0 ? now / NS_PER_S / wall : 0.0;
+
+    printf("\nsil: %.1f s virtual in %.2f s wall (%.0fx)\n", now / NS_PER_S, wall, speed);
+    for (int b = 0; b < SENSOR_BUSES; b++) {
+        const SimI2CBus& bus = sensorBuses[b];
+        printf("i2c bus %d: %d Hz, %llu transfers, %llu nacks, %.1f%% busy\n", b, bus.getFrequency(),
+               (unsigned long long) bus.transfers, (unsigned long long) bus.nacks, 100.0 * bus.busyTime / now);
+
+        for (size_t i = 0; i < sensors.size(); i++) {
+            SimSensor* s = sensors[i];
+            if (sensorBus[i] != b) {
+                continue;
+            }
+            printf("  %-8s 0x%02x %8llu reads %8llu writes %6.1f%% bus  samples %llu lost %llu stale reads %llu\n", s->getName(),
+                   s->getAddress(), (unsigned long long) s->reads, (unsigned long long) s->writes, 100.0 * s->busTime / now,
+                   (unsigned long long) s->samples, (unsigned long long) s->lost, (unsigned long long) s->stale);
+        }
+    }
+
+    printf("serial: %llu bytes, %llu frames, %llu crc errors, %llu framing errors, %llu dropped\n",
+           (unsigned long long) serialBytes, (unsigned long long) stats.frames, (unsigned long long) stats.crcErrors,
+           (unsigned long long) stats.framingErrors, (unsigned long long) stats.droppedFrames);
+
+    if (scored == 0) {
+        printf("attitude: no quaternions after %.1f s settling\n", settle);
+    } else {
+        printf("attitude: first estimate at %.2f s, scored from %.2f s over %llu quaternions\n", firstEstimate,
+               firstEstimate + settle, (unsigned long long) scored);
+        printf("  error rms %.2f max %.2f final %.2f deg; tilt rms %.2f max %.2f deg\n",
+               sqrt(sumSquared / scored) * degrees, maxError * degrees, lastError * degrees,
+               sqrt(sumTiltSquared / scored) * degrees, maxTilt * degrees);
+    }
+    if (invalid > 0) {
+        printf("attitude: %llu quaternions not finite\n", (unsigned long long) invalid);
+    }
+
+    int status = 0;
+    if (maxRms > 0 && (scored == 0 || sqrt(sumSquared / scored) * degrees > maxRms)) {
+        printf("FAIL: rms attitude error above %.2f deg\n", maxRms);
+        status = 1;
+    }
+    if (maxRms > 0 && invalid > 0) {
+        printf("FAIL: the filter diverged\n");
+        status = 1;
+    }
+    if (minSpeed > 0 && wall > 0 && speed < minSpeed) {
+        printf("FAIL: %.0fx real time, below %.0fx\n", speed, minSpeed);
+        status = 1;
+    }
+
+    fflush(stdout);
+    if (serialFile) {
+        fclose(serialFile);
+    }
+
+    //The firmware never returns from main; leave without running static
+    //destructors that would touch its objects mid-call.
+    _exit(status);
+
+}
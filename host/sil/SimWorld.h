@@ -0,0 +1,101 @@
+/**
+ * The simulated board the firmware runs on in software-in-the-loop runs.
+ *
+ * Wires the ground truth trajectory to the simulated sensors, the sensors
+ * to the I2C buses on p28/p27 and p9/p10 as SensorBuses.h assigns them
+ * (built with the same flags as the firmware, IMU_COUNT IMUs included,
+ * each with errors of its own), and the USB serial port to a telemetry
+ * decoder that scores the firmware's quaternion output against the truth.
+ * The run ends after a fixed virtual time with a report on stdout.
+ *
+ * Configured through the environment:
+ *
+ *   SIL_DURATION  virtual seconds to run (60)
+ *   SIL_I2C_HZ    force the bus frequencies, whatever the firmware asks for
+ *   SIL_SEED      seed for the sensor errors and noise (1)
+ *   SIL_NOISE     multiplier on all sensor errors, 0 for ideal sensors (1)
+ *   SIL_TRAJECTORY motion parameters, see Trajectory::configure()
+ *   SIL_SETTLE    seconds after the first quaternion before scoring (5)
+ *   SIL_MAX_ERROR fail (exit status 1) if the rms attitude error in
+ *                 degrees is above this, or if any quaternion is not
+                 finite, for CI
+ *   SIL_MIN_SPEED fail if virtual time ran less than this many times
+ *                 faster than the wall clock
+ *   SIL_SERIAL    file to write the raw serial stream to, for
+ *                 telemetry_dump
+ */
+#ifndef SIM_WORLD_H
+#define SIM_WORLD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "SimI2C.h"
+#include "SimSensors.h"
+#include "TelemetryDecoder.h"
+#include "Trajectory.h"
+
+class SimWorld {
+
+public:
+
+    static SimWorld& instance();
+
+    //The bus on the given data pin, 0 if there is none.
+    SimI2CBus* bus(int sda);
+
+    //A byte leaving the UART with the given index.
+    void serialOutput(int port, uint8_t byte);
+
+    //Telemetry timestamps count from the first Timer started.
+    void timerStarted(uint64_t at);
+
+private:
+
+    SimWorld();
+
+    //Put a sensor on bus 0 or 1.
+    void attach(SimSensor* sensor, int bus);
+    void frame(const TelemetryFrame& frame);
+    void report(void);
+
+    Trajectory trajectory;
+    //Bus 0 and bus 1 of SensorBuses.h.
+    SimI2CBus sensorBuses[2];
+    //Every sensor and its bus, in the order they were attached.
+    std::vector<SimSensor*> sensors;
+    std::vector<int> sensorBus;
+
+    TelemetryDecoder decoder;
+    TelemetryDecoder::FrameHandler onFrame;
+    FILE* serialFile;
+    uint64_t serialBytes;
+
+    double duration;
+    double settle;
+    double maxRms;
+    double minSpeed;
+    bool haveOrigin;
+    uint64_t origin;
+    //Latest telemetry timestamp in microseconds, unwrapped past the 71.6
+    //minutes of the 32 bit field.
+    uint64_t timestamp;
+
+    //Attitude error of the quaternion stream, in rad. A quaternion that is
+    //not finite counts as half a turn off and is counted on its own.
+    double firstEstimate;
+    uint64_t scored;
+    uint64_t invalid;
+    double sumSquared;
+    double sumTiltSquared;
+    double maxError;
+    double maxTilt;
+    double lastError;
+
+    //Wall clock at start, for the speed up.
+    double wallStart;
+
+};
+
+#endif /* SIM_WORLD_H */
@@ -0,0 +1,143 @@
+/**
+ * Ground truth motion for software-in-the-loop runs.
+ */
+#include "Trajectory.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TWO_PI 6.283185307179586
+
+//Rotate the earth frame vector d into the board frame (q* d q).
+static void toBoard(const double* q, const double* d, double* v) {
+
+    v[0] = 2 * d[0] * (0.5 - q[2] * q[2] - q[3] * q[3]) + 2 * d[1] * (q[1] * q[2] + q[0] * q[3]) + 2 * d[2] * (q[1] * q[3] - q[0] * q[2]);
+    v[1] = 2 * d[0] * (q[1] * q[2] - q[0] * q[3]) + 2 * d[1] * (0.5 - q[1] * q[1] - q[3] * q[3]) + 2 * d[2] * (q[0] * q[1] + q[2] * q[3]);
+    v[2] = 2 * d[0] * (q[0] * q[2] + q[1] * q[3]) + 2 * d[1] * (q[2] * q[3] - q[0] * q[1]) + 2 * d[2] * (0.5 - q[1] * q[1] - q[2] * q[2]);
+
+}
+
+Trajectory::Trajectory() {
+
+    stillTime = 6.0;
+    rampTime = 2.0;
+    heading = 0.0;
+    amplitude[0] = 0.6;
+    amplitude[1] = 0.4;
+    amplitude[2] = 1.5;
+    frequency[0] = 0.11;
+    frequency[1] = 0.07;
+    frequency[2] = 0.03;
+    acceleration = 0.5;
+    gravity = 9.80665;
+    //0.5 gauss, dipping 60 degrees.
+    flux[0] = 0.25;
+    flux[1] = 0.0;
+    flux[2] = -0.433;
+
+}
+
+bool Trajectory::configure(const char* spec) {
+
+    struct {
+        const char* name;
+        double* value;
+    } parameters[] = {
+        {"still", &stillTime}, {"ramp", &rampTime}, {"heading", &heading},
+        {"roll", &amplitude[0]}, {"pitch", &amplitude[1]}, {"yaw", &amplitude[2]},
+        {"roll_hz", &frequency[0]}, {"pitch_hz", &frequency[1]}, {"yaw_hz", &frequency[2]},
+        {"accel", &acceleration}, {"gravity", &gravity},
+        {"flux_x", &flux[0]}, {"flux_y", &flux[1]}, {"flux_z", &flux[2]}
+    };
+    const int count = sizeof(parameters) / sizeof(parameters[0]);
+    bool ok = true;
+
+    while (spec && *spec) {
+        const char* end = strchr(spec, ',');
+        size_t length = end ? (size_t) (end - spec) : strlen(spec);
+        const char* equals = (const char*) memchr(spec, '=', length);
+        bool found = false;
+
+        for (int i = 0; equals && i < count; i++) {
+            if (strlen(parameters[i].name) == (size_t) (equals - spec) && strncmp(parameters[i].name, spec, equals - spec) == 0) {
+                *parameters[i].value = atof(equals + 1);
+                found = true;
+            }
+        }
+        ok = ok && found;
+
+        spec = end ? end + 1 : 0;
+    }
+
+    return ok;
+
+}
+
+double Trajectory::envelope(double t) const {
+
+    if (t <= stillTime) {
+        return 0.0;
+    }
+    if (t >= stillTime + rampTime) {
+        return 1.0;
+    }
+
+    //Smoothstep, so rates start from zero without a jerk.
+    double x = (t - stillTime) / rampTime;
+    return x * x * (3.0 - 2.0 * x);
+
+}
+
+void Trajectory::orientation(double t, double* q) const {
+
+    double e = envelope(t);
+    double moving = t - stillTime;
+    double roll = e * amplitude[0] * sin(TWO_PI * frequency[0] * moving);
+    double pitch = e * amplitude[1] * sin(TWO_PI * frequency[1] * moving);
+    double yaw = heading + e * amplitude[2] * sin(TWO_PI * frequency[2] * moving);
+
+    //Board to earth rotation Rz(yaw) Ry(pitch) Rx(roll).
+    double cr = cos(0.5 * roll), sr = sin(0.5 * roll);
+    double cp = cos(0.5 * pitch), sp = sin(0.5 * pitch);
+    double cy = cos(0.5 * yaw), sy = sin(0.5 * yaw);
+
+    q[0] = cy * cp * cr + sy * sp * sr;
+    q[1] = cy * cp * sr - sy * sp * cr;
+    q[2] = cy * sp * cr + sy * cp * sr;
+    q[3] = sy * cp * cr - cy * sp * sr;
+
+}
+
+void Trajectory::sample(double t, SimTruth& truth) const {
+
+    const double h = 1e-5;
+    double before[4];
+    double after[4];
+    double* q = truth.q;
+
+    orientation(t, q);
+    orientation(t - h, before);
+    orientation(t + h, after);
+
+    //(0, w) = 2 q* q'.
+    double d[4];
+    for (int i = 0; i < 4; i++) {
+        d[i] = (after[i] - before[i]) / (2 * h);
+    }
+    truth.w[0] = 2 * (q[0] * d[1] - q[1] * d[0] - q[2] * d[3] + q[3] * d[2]);
+    truth.w[1] = 2 * (q[0] * d[2] + q[1] * d[3] - q[2] * d[0] - q[3] * d[1]);
+    truth.w[2] = 2 * (q[0] * d[3] - q[1] * d[2] + q[2] * d[1] - q[3] * d[0]);
+
+    double e = envelope(t);
+    double moving = t - stillTime;
+    double specific[3] = {
+        e * acceleration * sin(TWO_PI * 0.3 * moving),
+        e * acceleration * cos(TWO_PI * 0.2 * moving) - e * acceleration,
+        gravity + 0.5 * e * acceleration * sin(TWO_PI * 0.5 * moving)
+    };
+
+    toBoard(q, specific, truth.f);
+    toBoard(q, flux, truth.m);
+
+}
@@ -0,0 +1,66 @@
+/**
+ * Ground truth motion for software-in-the-loop runs.
+ *
+ * The board sits still and level for stillTime seconds (the firmware
+ * calibrates then), then eases into smooth rotation about all three axes
+ * plus some linear acceleration. Orientation is a closed form function of
+ * time, so any sensor can sample it at any instant and rate.
+ *
+ * Conventions match the filters: q is the orientation of the earth frame
+ * relative to the board frame, an earth vector d reads q* d q in the board
+ * frame, and the body rate satisfies q' = 0.5 q (0, w). The earth frame is
+ * x north, z up.
+ */
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+//Everything a board frame sensor could measure at one instant.
+struct SimTruth {
+    double q[4];
+    //Body rate in rad/s.
+    double w[3];
+    //Specific force in m/s/s, +g on z when level and still.
+    double f[3];
+    //Magnetic flux in gauss.
+    double m[3];
+};
+
+class Trajectory {
+
+public:
+
+    Trajectory();
+
+    void sample(double t, SimTruth& truth) const;
+
+    //True orientation only.
+    void orientation(double t, double* q) const;
+
+    //Override parameters from a comma separated list of name=value, e.g.
+    //"yaw=3.0,yaw_hz=0.2,accel=2". Names are still, ramp, heading, roll,
+    //pitch, yaw, roll_hz, pitch_hz, yaw_hz, accel, gravity, flux_x, flux_y
+    //and flux_z. Returns false, leaving the rest set, on a bad entry.
+    bool configure(const char* spec);
+
+    //Still, level time at the start, in s.
+    double stillTime;
+    //Time to ease into the full motion, in s.
+    double rampTime;
+    //Constant heading, in rad, so the engines have to find it.
+    double heading;
+    //Roll, pitch and yaw amplitudes in rad and frequencies in Hz.
+    double amplitude[3];
+    double frequency[3];
+    //Peak linear acceleration, m/s/s.
+    double acceleration;
+    //Earth frame gravity and field.
+    double gravity;
+    double flux[3];
+
+private:
+
+    double envelope(double t) const;
+
+};
+
+#endif /* TRAJECTORY_H */
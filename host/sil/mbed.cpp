@@ -0,0 +1,435 @@
+/**
+ * Host stand-in for the parts of mbed.h the firmware uses.
+ */
+#include "mbed.h"
+#include "SimWorld.h"
+
+#include <stdarg.h>
+#include <vector>
+
+#define NS_PER_S 1000000000.0
+
+void wait(float s) {
+
+    SimClock::instance().advance((uint64_t) (s * NS_PER_S));
+
+}
+
+void wait_ms(int ms) {
+
+    SimClock::instance().advance((uint64_t) ms * 1000000ULL);
+
+}
+
+void wait_us(int us) {
+
+    SimClock::instance().advance((uint64_t) us * 1000ULL);
+
+}
+
+uint32_t us_ticker_read(void) {
+
+    return (uint32_t) (SimClock::instance().now() / 1000ULL);
+
+}
+
+/**
+ * I2C
+ */
+static SimI2CBus* busFor(int index) {
+
+    return SimWorld::instance().bus(index);
+
+}
+
+I2C::I2C(PinName sda, PinName scl) : _hz(100000), _bus(sda) {
+
+    (void) scl;
+
+}
+
+void I2C::frequency(int hz) {
+
+    _hz = hz;
+
+}
+
+int I2C::read(int address, char* data, int length, bool repeated) {
+
+    SimI2CBus* bus = busFor(_bus);
+
+    if (bus == 0) {
+        return 1;
+    }
+
+    //The frequency belongs to the peripheral; every driver sets it once,
+    //so apply it on each transfer.
+    bus->frequency(_hz);
+
+    return bus->read(address, (uint8_t*) data, length, repeated);
+
+}
+
+int I2C::write(int address, const char* data, int length, bool repeated) {
+
+    SimI2CBus* bus = busFor(_bus);
+
+    if (bus == 0) {
+        return 1;
+    }
+
+    bus->frequency(_hz);
+
+    return bus->write(address, (const uint8_t*) data, length, repeated);
+
+}
+
+int I2C::transfer(int address, const char* tx, int txLength, char* rx, int rxLength, const event_callback_t& callback,
+                  int event, bool repeated) {
+
+    SimI2CBus* bus = busFor(_bus);
+
+    //A stop always follows; the queue never holds the bus between
+    //transactions.
+    (void) repeated;
+
+    if (bus == 0) {
+        return -1;
+    }
+
+    bus->frequency(_hz);
+    bus->transfer(address, (const uint8_t*) tx, txLength, (uint8_t*) rx, rxLength, [callback, event](int nack) {
+        int happened = nack ? I2C_EVENT_ERROR | I2C_EVENT_ERROR_NO_SLAVE : I2C_EVENT_TRANSFER_COMPLETE;
+        if (happened & event) {
+            callback(happened);
+        }
+    });
+
+    return 0;
+
+}
+
+int I2C::read(int ack) {
+
+    (void) ack;
+    return 0xFF;
+
+}
+
+int I2C::write(int data) {
+
+    (void) data;
+    return 0;
+
+}
+
+void I2C::start(void) {
+}
+
+void I2C::stop(void) {
+}
+
+/**
+ * Serial
+ *
+ * A 16 byte transmit FIFO drained at the baud rate, 10 bits per byte. The
+ * transmit interrupt fires when the FIFO runs empty, as the LPC1768's THRE
+ * interrupt does.
+ */
+#define UART_FIFO_DEPTH 16
+
+namespace {
+
+struct SimUart {
+    //0 for the USB serial port, which carries the telemetry.
+    int port;
+    //Nanoseconds on the line per byte.
+    uint64_t byteTime;
+    //When the last byte in the FIFO finishes on the line. Bytes queued
+    //while it is busy follow each other back to back, so that also gives
+    //how many are left.
+    uint64_t lineFree;
+    std::function<void ()> txHandler;
+    bool txPending;
+};
+
+std::vector<SimUart>& uarts() {
+
+    static std::vector<SimUart> all;
+    return all;
+
+}
+
+SimUart& uart(serial_t* obj) {
+
+    return uarts()[obj->index];
+
+}
+
+//Bytes still in the FIFO at the given time.
+uint64_t queued(const SimUart& port, uint64_t now) {
+
+    return port.lineFree > now ? (port.lineFree - now + port.byteTime - 1) / port.byteTime : 0;
+
+}
+
+void transmitEmpty(int index) {
+
+    SimUart& port = uarts()[index];
+    SimClock& clock = SimClock::instance();
+
+    //Bytes queued since the interrupt was scheduled: it is due when they
+    //are out.
+    if (port.lineFree > clock.now()) {
+        clock.schedule(port.lineFree, [index]() { transmitEmpty(index); });
+        return;
+    }
+
+    port.txPending = false;
+    if (port.txHandler) {
+        port.txHandler();
+    }
+
+}
+
+void transmit(serial_t* obj, int c) {
+
+    SimUart& port = uart(obj);
+    SimClock& clock = SimClock::instance();
+
+    port.lineFree = (port.lineFree > clock.now() ? port.lineFree : clock.now()) + port.byteTime;
+    SimWorld::instance().serialOutput(port.port, (uint8_t) c);
+
+    //The FIFO empty interrupt, if not already on its way; when it comes
+    //early because more bytes were queued, it moves itself to the new end
+    //of transmission, rather than every byte moving it.
+    if (port.txHandler && !port.txPending) {
+        int index = obj->index;
+        clock.schedule(port.lineFree, [index]() { transmitEmpty(index); });
+        port.txPending = true;
+    }
+
+}
+
+}
+
+int serial_writable(serial_t* obj) {
+
+    return queued(uart(obj), SimClock::instance().now()) < UART_FIFO_DEPTH;
+
+}
+
+void serial_putc(serial_t* obj, int c) {
+
+    SimUart& port = uart(obj);
+    SimClock& clock = SimClock::instance();
+
+    //Blocks until the oldest byte is out, as the mbed C API does.
+    while (!serial_writable(obj)) {
+        clock.advanceTo(port.lineFree - (queued(port, clock.now()) - 1) * port.byteTime);
+    }
+
+    transmit(obj, c);
+
+}
+
+Serial::Serial(PinName tx, PinName rx, const char* name) {
+
+    (void) rx;
+    (void) name;
+
+    SimUart port;
+    port.port = tx == USBTX ? 0 : (int) uarts().size() + 1;
+    port.byteTime = (uint64_t) (10 * NS_PER_S / 9600);
+    port.lineFree = 0;
+    port.txPending = false;
+
+    _serial.index = (int) uarts().size();
+    uarts().push_back(port);
+
+}
+
+void Serial::baud(int baudrate) {
+
+    uart(&_serial).byteTime = (uint64_t) (10 * NS_PER_S / baudrate);
+
+}
+
+int Serial::putc(int c) {
+
+    serial_putc(&_serial, c);
+
+    return c;
+
+}
+
+int Serial::getc(void) {
+
+    //Nothing is ever received.
+    return -1;
+
+}
+
+int Serial::printf(const char* format, ...) {
+
+    char buffer[256];
+    va_list args;
+
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (length > (int) sizeof(buffer) - 1) {
+        length = sizeof(buffer) - 1;
+    }
+    for (int i = 0; i < length; i++) {
+        putc((uint8_t) buffer[i]);
+    }
+
+    return length;
+
+}
+
+int Serial::readable(void) {
+
+    return 0;
+
+}
+
+int Serial::writeable(void) {
+
+    return serial_writable(&_serial);
+
+}
+
+void Serial::attach(void (*fptr)(void), IrqType type) {
+
+    attachHandler(fptr ? std::function<void ()>(fptr) : std::function<void ()>(), type);
+
+}
+
+void Serial::attachHandler(const std::function<void ()>& handler, IrqType type) {
+
+    if (type == TxIrq) {
+        uart(&_serial).txHandler = handler;
+    }
+
+}
+
+/**
+ * Timer
+ */
+Timer::Timer() : running(false), started(0), accumulated(0) {
+}
+
+void Timer::start(void) {
+
+    if (!running) {
+        started = SimClock::instance().now();
+        running = true;
+        SimWorld::instance().timerStarted(started);
+    }
+
+}
+
+void Timer::stop(void) {
+
+    accumulated = elapsed();
+    running = false;
+
+}
+
+void Timer::reset(void) {
+
+    started = SimClock::instance().now();
+    accumulated = 0;
+
+}
+
+uint64_t Timer::elapsed(void) {
+
+    return accumulated + (running ? SimClock::instance().now() - started : 0);
+
+}
+
+float Timer::read(void) {
+
+    return (float) (elapsed() / NS_PER_S);
+
+}
+
+int Timer::read_ms(void) {
+
+    return (int) (elapsed() / 1000000ULL);
+
+}
+
+int Timer::read_us(void) {
+
+    return (int) (elapsed() / 1000ULL);
+
+}
+
+/**
+ * Ticker
+ */
+Ticker::Ticker() : once(false), period(0), next(0), attached(false) {
+}
+
+Ticker::~Ticker() {
+
+    detach();
+
+}
+
+void Ticker::attach(void (*fptr)(void), float t) {
+
+    start(fptr, (uint64_t) (t * NS_PER_S));
+
+}
+
+void Ticker::attach_us(void (*fptr)(void), unsigned int t) {
+
+    start(fptr, (uint64_t) t * 1000ULL);
+
+}
+
+void Ticker::detach(void) {
+
+    if (attached) {
+        SimClock::instance().cancel(event);
+        attached = false;
+    }
+
+}
+
+void Ticker::start(const std::function<void ()>& fn, uint64_t ticks) {
+
+    detach();
+
+    handler = fn;
+    period = ticks;
+    next = SimClock::instance().now() + period;
+    event = SimClock::instance().schedule(next, [this]() { fire(); });
+    attached = true;
+
+}
+
+void Ticker::fire(void) {
+
+    //The handler may attach again, replacing itself.
+    if (once) {
+        std::function<void ()> fn = handler;
+        attached = false;
+        fn();
+        return;
+    }
+
+    //Like mbed, the next event is due a period after this one was due,
+    //not after it ran, and is queued before the handler runs.
+    next += period;
+    event = SimClock::instance().schedule(next, [this]() { fire(); });
+
+    handler();
+
+}
@@ -0,0 +1,236 @@
+/**
+ * Host stand-in for the parts of mbed.h the firmware uses, for
+ * software-in-the-loop runs.
+ *
+ * The drivers and main.cpp compile against this header unmodified. Time is
+ * virtual (see SimClock.h), I2C transfers go to simulated devices on a
+ * simulated bus (SimI2C.h) and serial output goes to the simulation's
+ * telemetry sink (SimWorld.h). Build with -funsigned-char, as char is
+ * unsigned on ARM and the drivers rely on it.
+ */
+#ifndef SIM_MBED_H
+#define SIM_MBED_H
+
+#include <functional>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SimClock.h"
+
+//Only the pins the firmware names.
+typedef enum {
+    p9 = 9,
+    p10 = 10,
+    p13 = 13,
+    p14 = 14,
+    p27 = 27,
+    p28 = 28,
+    USBTX = 0x100,
+    USBRX = 0x101,
+    NC = -1
+} PinName;
+
+//Events (the simulated interrupts) only run when thread context code
+//waits, so masking is a no-op and PRIMASK always reads clear. Unmasking
+//runs any that fell due, as pending interrupts are taken on the target,
+//and __WFI() moves the clock to the next event without running it.
+inline void __disable_irq(void) {}
+inline void __enable_irq(void) { SimClock::instance().advance(0); }
+inline uint32_t __get_PRIMASK(void) { return 0; }
+inline void __WFI(void) { SimClock::instance().sleep(); }
+
+void wait(float s);
+void wait_ms(int ms);
+void wait_us(int us);
+
+//The free running microsecond counter under Timer and Ticker; it wraps
+//every 71.6 minutes, as on the target.
+uint32_t us_ticker_read(void);
+
+//Asynchronous I2C as in later mbed versions, used by I2CQueue: the
+//transfer runs on virtual time and the callback fires as an event when it
+//has finished.
+#define DEVICE_I2C_ASYNCH 1
+
+#define I2C_EVENT_ERROR               (1 << 1)
+#define I2C_EVENT_ERROR_NO_SLAVE      (1 << 2)
+#define I2C_EVENT_TRANSFER_COMPLETE   (1 << 3)
+#define I2C_EVENT_TRANSFER_EARLY_NACK (1 << 4)
+#define I2C_EVENT_ALL (I2C_EVENT_ERROR | I2C_EVENT_TRANSFER_COMPLETE | I2C_EVENT_ERROR_NO_SLAVE | I2C_EVENT_TRANSFER_EARLY_NACK)
+
+//What mbed's Callback<void(int)> is used for.
+class event_callback_t {
+
+public:
+
+    template <typename T>
+    event_callback_t(T* tptr, void (T::*mptr)(int)) : fn(std::bind(mptr, tptr, std::placeholders::_1)) {}
+
+    void operator()(int event) const { fn(event); }
+
+private:
+
+    std::function<void (int)> fn;
+
+};
+
+class I2C {
+
+public:
+
+    enum RxStatus {
+        NoData,
+        MasterGeneralCall,
+        MasterWrite,
+        MasterRead
+    };
+
+    enum Acknowledge {
+        NoACK = 0,
+        ACK = 1
+    };
+
+    I2C(PinName sda, PinName scl);
+
+    void frequency(int hz);
+
+    //0 on success, non-0 if the device did not acknowledge.
+    int read(int address, char* data, int length, bool repeated = false);
+    int write(int address, const char* data, int length, bool repeated = false);
+
+    //Write then read after a repeated start, without waiting; 0 if the
+    //transfer started. The callback gets the I2C_EVENT_* that happened,
+    //if they are in event.
+    int transfer(int address, const char* tx, int txLength, char* rx, int rxLength, const event_callback_t& callback,
+                 int event = I2C_EVENT_TRANSFER_COMPLETE, bool repeated = false);
+
+    //Byte level transfers are not used by the drivers.
+    int read(int ack);
+    int write(int data);
+    void start(void);
+    void stop(void);
+
+protected:
+
+    int _hz;
+    int _bus;
+
+};
+
+//What SerialQueue needs from the C serial API.
+struct serial_s {
+    int index;
+};
+typedef struct serial_s serial_t;
+
+int serial_writable(serial_t* obj);
+void serial_putc(serial_t* obj, int c);
+
+class Serial {
+
+public:
+
+    enum IrqType {
+        RxIrq = 0,
+        TxIrq
+    };
+
+    Serial(PinName tx, PinName rx, const char* name = NULL);
+
+    void baud(int baudrate);
+
+    int putc(int c);
+    int getc(void);
+    int printf(const char* format, ...);
+    int readable(void);
+    int writeable(void);
+
+    void attach(void (*fptr)(void), IrqType type = RxIrq);
+
+    template <typename T>
+    void attach(T* tptr, void (T::*mptr)(void), IrqType type = RxIrq) {
+        attachHandler(std::bind(mptr, tptr), type);
+    }
+
+protected:
+
+    void attachHandler(const std::function<void ()>& handler, IrqType type);
+
+    serial_t _serial;
+
+};
+
+class Timer {
+
+public:
+
+    Timer();
+
+    void start(void);
+    void stop(void);
+    void reset(void);
+    float read(void);
+    int read_ms(void);
+    int read_us(void);
+
+    operator float() { return read(); }
+
+private:
+
+    uint64_t elapsed(void);
+
+    bool running;
+    uint64_t started;
+    uint64_t accumulated;
+
+};
+
+class Ticker {
+
+public:
+
+    Ticker();
+    virtual ~Ticker();
+
+    void attach(void (*fptr)(void), float t);
+    void attach_us(void (*fptr)(void), unsigned int t);
+
+    template <typename T>
+    void attach(T* tptr, void (T::*mptr)(void), float t) {
+        start(std::bind(mptr, tptr), (uint64_t) (t * 1e9));
+    }
+
+    void detach(void);
+
+protected:
+
+    //Fire once and detach, for Timeout.
+    bool once;
+
+private:
+
+    void start(const std::function<void ()>& fn, uint64_t period);
+    void fire(void);
+
+    std::function<void ()> handler;
+    uint64_t period;
+    uint64_t next;
+    bool attached;
+    SimClock::EventId event;
+
+};
+
+//A Ticker that fires once, as in mbed.
+class Timeout : public Ticker {
+
+public:
+
+    Timeout() { once = true; }
+
+};
+
+#endif /* SIM_MBED_H */
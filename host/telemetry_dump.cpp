@@ -0,0 +1,146 @@
+/**
+ * Decode a telemetry stream to CSV.
+ *
+ * Reads the raw byte stream from the board (a capture file, or stdin, e.g.
+ * piped from a configured serial port), or a log written by
+ * telemetry_record, and prints one line per record.
+ * For stream statistics records, the rate each stream achieved since the
+ * previous statistics record is printed too. Profile records are printed
+ * in microseconds, followed by the histogram counts, and job records as
+ * their counters, maxima in microseconds and lateness histogram. Event
+ * records give the idle percentage, then a line per event with its
+ * counters and maximum latency in microseconds. Bus records give the
+ * counters, the maximum wait and transfer time in microseconds and the
+ * busy percentage. Link statistics go to stderr at the end.
+ *
+ * Usage: telemetry_dump [capture | log]
+ */
+#include "TelemetryDecoder.h"
+#include "TelemetryLog.h"
+
+#include <stdio.h>
+
+int main(int argc, char* argv[]) {
+
+    //Previous statistics record, to turn counters into rates.
+    TelemetryFrame previous;
+    bool havePrevious = false;
+
+    TelemetryDecoder::FrameHandler print = [&](const TelemetryFrame& frame) {
+        if (frame.hasQuaternion) {
+            printf("%u,%u,quaternion,%.7f,%.7f,%.7f,%.7f\n", frame.sequence, frame.timestamp,
+                   frame.quaternion[0], frame.quaternion[1], frame.quaternion[2], frame.quaternion[3]);
+        }
+        if (frame.hasEuler) {
+            printf("%u,%u,euler,%.7f,%.7f,%.7f\n", frame.sequence, frame.timestamp,
+                   frame.euler[0], frame.euler[1], frame.euler[2]);
+        }
+        if (frame.hasRawSensors) {
+            printf("%u,%u,raw,%d,%d,%d,%d,%d,%d,%d,%d,%d\n", frame.sequence, frame.timestamp,
+                   frame.accelerometer[0], frame.accelerometer[1], frame.accelerometer[2],
+                   frame.gyroscope[0], frame.gyroscope[1], frame.gyroscope[2],
+                   frame.magnetometer[0], frame.magnetometer[1], frame.magnetometer[2]);
+        }
+        if (frame.hasDiagnostics) {
+            printf("%u,%u,diagnostics,%.7f,%.7f,%.7f,%.7f,%u\n", frame.sequence, frame.timestamp,
+                   frame.diagnostics.gain, frame.diagnostics.gyroBias[0], frame.diagnostics.gyroBias[1],
+                   frame.diagnostics.gyroBias[2], frame.diagnostics.updates);
+        }
+        if (frame.hasProfile) {
+            const TelemetryProfile& profile = frame.profile;
+            double us = profile.tickRate ? 1e6 / profile.tickRate : 0;
+            printf("%u,%u,profile,%u,%.*s,%u,%.3f,%.3f,%.3f", frame.sequence, frame.timestamp, profile.zone,
+                   TELEMETRY_PROFILE_NAME_SIZE, profile.name, profile.count,
+                   profile.min * us, profile.mean * us, profile.max * us);
+            for (int i = 0; i < TELEMETRY_PROFILE_BINS; i++) {
+                printf(",%u", profile.histogram[i]);
+            }
+            printf("\n");
+        }
+        if (frame.hasJob) {
+            const TelemetryJob& job = frame.job;
+            printf("%u,%u,job,%u,%u,%u,%u,%u,%u,%u,%u,%u", frame.sequence, frame.timestamp, job.job, job.period,
+                   job.runs, job.skipped, job.overruns, job.duplicates, job.lost, job.maxLateness, job.maxDuration);
+            for (int i = 0; i < TELEMETRY_JOB_BINS; i++) {
+                printf(",%u", job.lateness[i]);
+            }
+            printf("\n");
+        }
+        if (frame.hasEvents) {
+            printf("%u,%u,idle,%u,%u,%.1f\n", frame.sequence, frame.timestamp, frame.idle, frame.elapsed,
+                   frame.elapsed ? 100.0 * frame.idle / frame.elapsed : 0.0);
+            for (int i = 0; i < frame.eventCount; i++) {
+                const TelemetryEventStatistics& event = frame.events[i];
+                printf("%u,%u,event,%u,%u,%u,%u,%u\n", frame.sequence, frame.timestamp, event.event, event.priority,
+                       event.dispatched, event.coalesced, event.maxLatency);
+            }
+        }
+        if (frame.hasBus) {
+            const TelemetryBus& bus = frame.bus;
+            printf("%u,%u,bus,%u,%u,%u,%u,%u,%u,%u,%.1f\n", frame.sequence, frame.timestamp, bus.bus, bus.transactions,
+                   bus.errors, bus.rejected, bus.maxQueued, bus.maxWait, bus.maxDuration,
+                   bus.elapsed ? 100.0 * bus.busy / bus.elapsed : 0.0);
+        }
+        if (frame.streamCount > 0) {
+            double seconds = havePrevious ? (uint32_t) (frame.timestamp - previous.timestamp) * 1e-6 : 0;
+            for (int i = 0; i < frame.streamCount; i++) {
+                double rate = 0;
+                if (seconds > 0 && i < previous.streamCount && previous.streams[i].type == frame.streams[i].type) {
+                    rate = (frame.streams[i].sent - previous.streams[i].sent) / seconds;
+                }
+                printf("%u,%u,stream,%u,%u,%u,%.1f\n", frame.sequence, frame.timestamp, frame.streams[i].type,
+                       frame.streams[i].sent, frame.streams[i].dropped, rate);
+            }
+            previous = frame;
+            havePrevious = true;
+        }
+    };
+
+    if (argc > 1 && TelemetryLogReader::isLog(argv[1])) {
+
+        TelemetryLogReader log;
+
+        if (!log.open(argv[1])) {
+            fprintf(stderr, "%s: not a readable log\n", argv[1]);
+            return 1;
+        }
+
+        size_t bad = 0;
+        for (size_t i = 0; i < log.chunkCount(); i++) {
+            bad += log.readChunk(i, print);
+        }
+
+        fprintf(stderr, "%zu chunks%s, %zu bad frames\n", log.chunkCount(), log.indexed() ? "" : " (no index)", bad);
+
+        return 0;
+
+    }
+
+    FILE* input = (argc > 1) ? fopen(argv[1], "rb") : stdin;
+
+    if (input == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    TelemetryDecoder decoder;
+    uint8_t chunk[4096];
+    size_t n;
+
+    while ((n = fread(chunk, 1, sizeof(chunk), input)) > 0) {
+        decoder.feed(chunk, n, print);
+    }
+
+    const TelemetryStatistics& stats = decoder.statistics();
+    fprintf(stderr, "%llu bytes, %llu frames, %llu dropped, %llu crc errors, %llu framing errors, %llu version errors\n",
+            (unsigned long long) stats.bytes, (unsigned long long) stats.frames,
+            (unsigned long long) stats.droppedFrames, (unsigned long long) stats.crcErrors,
+            (unsigned long long) stats.framingErrors, (unsigned long long) stats.versionErrors);
+
+    if (input != stdin) {
+        fclose(input);
+    }
+
+    return 0;
+
+}
@@ -0,0 +1,230 @@
+/**
+ * Record the firmware telemetry stream to a log.
+ *
+ * A reader thread does nothing but read() the source into fixed blocks and
+ * hand them to a writer thread through a lock-free ring, so a slow disk
+ * never stalls the serial port. The writer decodes the frames and appends
+ * them to a chunked log (see TelemetryLog.h), readable with
+ * telemetry_dump. If the writer falls behind a serial port and no free
+ * block is left, the reader keeps draining the port and counts the bytes
+ * it had to throw away; a pty, FIFO or file is simply read more slowly.
+ *
+ * The source can be a serial port, which is put in raw mode at the given
+ * baud rate, or a pty or FIFO for testing. Recording stops at end of file
+ * or on Ctrl-C.
+ *
+ * Usage: telemetry_record source log [baud]
+ */
+#include "SpscRing.h"
+#include "TelemetryDecoder.h"
+#include "TelemetryLog.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+//Blocks handed from the reader to the writer.
+#define BLOCK_SIZE  (64 * 1024)
+#define BLOCK_COUNT 256
+
+struct Block {
+    uint8_t* data;
+    size_t size;
+};
+
+static std::atomic<bool> stopping(false);
+
+static void stop(int) {
+
+    stopping = true;
+
+}
+
+static speed_t toSpeed(int baud) {
+
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        case 1000000: return B1000000;
+        case 2000000: return B2000000;
+        default: return 0;
+    }
+
+}
+
+//Put a serial port in raw 8N1 mode; other sources are left alone.
+static bool configure(int fd, int baud) {
+
+    struct termios tty;
+
+    if (!isatty(fd)) {
+        return true;
+    }
+
+    if (tcgetattr(fd, &tty) != 0) {
+        return false;
+    }
+
+    speed_t speed = toSpeed(baud);
+    if (speed == 0) {
+        fprintf(stderr, "unsupported baud rate %d\n", baud);
+        return false;
+    }
+
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
+    tty.c_cflag |= CLOCAL | CREAD;
+    //Return as soon as anything arrives, or every 100ms to check for Ctrl-C.
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 1;
+
+    return tcsetattr(fd, TCSANOW, &tty) == 0;
+
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s source log [baud]\n", argv[0]);
+        return 1;
+    }
+
+    int baud = (argc > 3) ? atoi(argv[3]) : 921600;
+    int fd = open(argv[1], O_RDONLY | O_NOCTTY);
+
+    if (fd < 0 || !configure(fd, baud)) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    TelemetryLogWriter log;
+
+    if (!log.open(argv[2])) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    //No SA_RESTART, so a blocked read() returns on Ctrl-C.
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    //Blocks go round: free -> reader -> full -> writer -> free.
+    static SpscRing<Block, BLOCK_COUNT> freeBlocks;
+    static SpscRing<Block, BLOCK_COUNT> fullBlocks;
+    std::vector<uint8_t> storage((size_t) BLOCK_SIZE * BLOCK_COUNT);
+
+    for (size_t i = 0; i < BLOCK_COUNT; i++) {
+        Block block = {&storage[i * BLOCK_SIZE], 0};
+        freeBlocks.push(block);
+    }
+
+    bool tty = isatty(fd);
+    std::atomic<bool> readerDone(false);
+    uint64_t overrunBytes = 0;
+
+    std::thread reader([&]() {
+
+        uint8_t discard[BLOCK_SIZE];
+        Block block;
+
+        while (!stopping) {
+
+            if (!freeBlocks.pop(block)) {
+                //A FIFO or file can wait for the writer.
+                if (!tty) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                //A serial port cannot: keep it drained and count the loss.
+                ssize_t n = read(fd, discard, sizeof(discard));
+                overrunBytes += (n > 0) ? n : 0;
+                continue;
+            }
+
+            ssize_t n = read(fd, block.data, BLOCK_SIZE);
+
+            if (n <= 0) {
+                freeBlocks.push(block);
+                //Timeouts on a tty are normal; end of file elsewhere is the end.
+                if ((n < 0 && errno != EINTR) || (n == 0 && !tty)) {
+                    break;
+                }
+                continue;
+            }
+
+            block.size = n;
+            while (!fullBlocks.push(block)) {
+                std::this_thread::yield();
+            }
+
+        }
+
+        readerDone = true;
+
+    });
+
+    TelemetryDecoder decoder;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    TelemetryDecoder::FrameHandler append = [&](const TelemetryFrame& frame) {
+        log.append(frame);
+    };
+
+    while (true) {
+
+        Block block;
+
+        if (!fullBlocks.pop(block)) {
+            if (readerDone) {
+                //The reader may have pushed a last block before finishing.
+                if (!fullBlocks.pop(block)) {
+                    break;
+                }
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                continue;
+            }
+        }
+
+        decoder.feed(block.data, block.size, append);
+        freeBlocks.push(block);
+
+    }
+
+    reader.join();
+    close(fd);
+
+    bool written = log.close();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const TelemetryStatistics& stats = decoder.statistics();
+
+    fprintf(stderr, "%llu bytes in %.2fs (%.1f MB/s), %llu frames, %llu dropped sequence numbers\n",
+            (unsigned long long) stats.bytes, seconds, stats.bytes / seconds * 1e-6,
+            (unsigned long long) stats.frames, (unsigned long long) stats.droppedFrames);
+    fprintf(stderr, "%llu crc errors, %llu framing errors, %llu version errors, %llu bytes lost to overrun\n",
+            (unsigned long long) stats.crcErrors, (unsigned long long) stats.framingErrors,
+            (unsigned long long) stats.versionErrors, (unsigned long long) overrunBytes);
+    fprintf(stderr, "log %s: %llu bytes%s\n", argv[2], (unsigned long long) log.bytesWritten(),
+            written ? "" : " (write failed)");
+
+    return written ? 0 : 1;
+
+}
@@ -0,0 +1,153 @@
+/**
+ * Generate a sensor dataset with ground truth from a smooth trajectory.
+ *
+ * Samples the SIL trajectory (sil/Trajectory.h) at the given rate and
+ * writes the true orientation with the gyroscope, accelerometer and
+ * magnetometer readings in the raw counts main.cpp expects (see
+ * Dataset.h). Readings are ideal apart from quantisation unless noise is
+ * given: it scales a white noise floor on every sensor plus a fixed
+ * gyroscope bias, drawn from the seed, so a dataset is reproducible from
+ * its command line, which is recorded in its header.
+ *
+ * Usage: trajectory_gen [rate_hz] [seconds] [motion] [noise] [seed] > dataset
+ *
+ * motion is a Trajectory::configure() list, or - for the default. The rate
+ * and duration must be positive, the noise scale not negative and the
+ * seed a whole number.
+ */
+#include "Dataset.h"
+#include "SensorMounting.h"
+#include "Trajectory.h"
+
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int16_t toCounts(double value) {
+
+    double rounded = floor(value + 0.5);
+
+    if (rounded < -32768) {
+        return -32768;
+    }
+    if (rounded > 32767) {
+        return 32767;
+    }
+
+    return (int16_t) rounded;
+
+}
+
+//The whole of text as a finite number.
+static bool parseNumber(const char* text, double* value) {
+
+    char* end;
+
+    *value = strtod(text, &end);
+
+    return end != text && *end == '\0' && isfinite(*value);
+
+}
+
+//A decimal seed that fits in 32 bits.
+static bool parseSeed(const char* text, unsigned int* seed) {
+
+    char* end;
+    unsigned long value = strtoul(text, &end, 10);
+
+    if (end == text || *end != '\0' || text[0] == '-' || value > 0xFFFFFFFFUL) {
+        return false;
+    }
+    *seed = (unsigned int) value;
+
+    return true;
+
+}
+
+int main(int argc, char* argv[]) {
+
+    double rate = 200.0;
+    double seconds = 120.0;
+    const char* motion = (argc > 3 && strcmp(argv[3], "-") != 0) ? argv[3] : 0;
+    double noise = 0.0;
+    unsigned int seed = 1;
+
+    if (argc > 6 || (argc > 1 && (!parseNumber(argv[1], &rate) || rate <= 0)) ||
+        (argc > 2 && (!parseNumber(argv[2], &seconds) || seconds <= 0)) ||
+        (argc > 4 && (!parseNumber(argv[4], &noise) || noise < 0)) ||
+        (argc > 5 && !parseSeed(argv[5], &seed))) {
+        fprintf(stderr, "usage: %s [rate_hz] [seconds] [motion] [noise] [seed] > dataset\n", argv[0]);
+        return 1;
+    }
+
+    Trajectory trajectory;
+    if (motion && !trajectory.configure(motion)) {
+        fprintf(stderr, "bad motion parameter in %s\n", motion);
+        return 1;
+    }
+
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    //Noise floors in rad/s, g and gauss, as in the SIL sensor models.
+    const double gyroscopeNoise = 0.005 * noise;
+    const double accelerometerNoise = 0.004 * trajectory.gravity * noise;
+    const double magnetometerNoise = 0.002 * noise;
+    double gyroscopeBias[3];
+    for (int k = 0; k < 3; k++) {
+        gyroscopeBias[k] = 0.02 * noise * normal(rng);
+    }
+
+    Dataset dataset;
+    dataset.rate = rate;
+
+    char description[512];
+    snprintf(description, sizeof(description), "trajectory_gen %g %g %s %g %u\ngyroscope bias %.6f %.6f %.6f rad/s",
+             rate, seconds, motion ? motion : "-", noise, seed, gyroscopeBias[0], gyroscopeBias[1], gyroscopeBias[2]);
+    dataset.description = description;
+
+    int n = (int) (seconds * rate);
+    dataset.samples.resize(n);
+
+    for (int i = 0; i < n; i++) {
+        SimTruth truth;
+        DatasetSample& s = dataset.samples[i];
+        double board[3];
+        double sensor[3];
+
+        s.t = i / rate;
+        trajectory.sample(s.t, truth);
+        for (int k = 0; k < 4; k++) {
+            s.q[k] = truth.q[k];
+        }
+
+        //Board frame truth back to each sensor's own axes.
+        for (int k = 0; k < 3; k++) {
+            board[k] = truth.w[k] + gyroscopeBias[k] + gyroscopeNoise * normal(rng);
+        }
+        GyroscopeAxes::invert(board, sensor);
+        for (int k = 0; k < 3; k++) {
+            s.w[k] = toCounts(sensor[k] * dataset.gyroscopeScale);
+        }
+
+        for (int k = 0; k < 3; k++) {
+            board[k] = truth.f[k] + accelerometerNoise * normal(rng);
+        }
+        AccelerometerAxes::invert(board, sensor);
+        for (int k = 0; k < 3; k++) {
+            s.a[k] = toCounts(sensor[k] * dataset.accelerometerScale);
+        }
+
+        for (int k = 0; k < 3; k++) {
+            board[k] = truth.m[k] + magnetometerNoise * normal(rng);
+        }
+        MagnetometerAxes::invert(board, sensor);
+        for (int k = 0; k < 3; k++) {
+            s.m[k] = toCounts(sensor[k] * dataset.magnetometerScale);
+        }
+    }
+
+    return dataset.write(stdout) ? 0 : 1;
+
+}
@@ -22,9 +22,10 @@ void setupSerial()
   println("All serial devices: " + Serial.list());
   println("Selected device: " + Serial.list()[5]);
 
-  // Baud Rates: 9600 - 57600 - 115200
-  serial = new Serial(this, Serial.list()[5], 9600);
-  serial.bufferUntil('\n');
+  // Must match TELEMETRY_BAUD in main.cpp.
+  serial = new Serial(this, Serial.list()[5], 921600);
+  // Telemetry frames are COBS encoded and end in a 0 byte, see Telemetry.h.
+  serial.bufferUntil(0);
 }
 
 void createBox()
@@ -57,35 +58,77 @@ public void draw() {
 void serialEvent (Serial serial) {
   try
   {
-//    String packet = new String(serial.readBytesUntil('\n'));
-//    println("Packet: " + packet);
-    
-    serial.readBytesUntil('R');
-    roll = readFloatUntil(serial, '\t');
-    pitch = readFloatUntil(serial, '\t');
-    yaw = readFloatUntil(serial, '\n');
-    println("Roll:"+roll+" Pitch:"+pitch+" Yaw:"+yaw);
-
-    serial.clear();
+    byte frame[] = serial.readBytesUntil(0);
+    if (frame == null) {
+      return;
+    }
+    byte data[] = cobsDecode(frame, frame.length - 1);
+    if (data == null || data.length < 10) {
+      return;
+    }
+    int size = data.length - 2;
+    if (crc16(data, size) != get2bytes(data, size) || (data[0] & 0xFF) != 1) {
+      println("Bad frame");
+      return;
+    }
+    // Walk the records after the 8 byte header and pick out the Euler angles.
+    int i = 8;
+    while (i + 2 <= size) {
+      int type = data[i] & 0xFF;
+      int length = data[i + 1] & 0xFF;
+      if (type == 0x02 && length >= 12 && i + 2 + length <= size) {
+        roll = degrees(get4bytesFloat(data, i + 2));
+        pitch = degrees(get4bytesFloat(data, i + 6));
+        yaw = degrees(get4bytesFloat(data, i + 10));
+      }
+      i += 2 + length;
+    }
   } catch(Exception e) {
     println( e );
   }
 }
 
-public float readFloatUntil(Serial serial, int inByte) {
-  byte temp[] = serial.readBytesUntil(inByte);
-  println("bytes = " + temp.length);
-  if (temp == null) {
-    return 0.0;
-  } else {
-    float value = get4bytesFloat(temp, 0);
-    return value;
+// COBS decode length bytes of frame, or null if the frame is corrupt.
+byte[] cobsDecode(byte[] frame, int length) {
+  byte out[] = new byte[length];
+  int in = 0;
+  int n = 0;
+  while (in < length) {
+    int run = frame[in++] & 0xFF;
+    if (run == 0 || in + run - 1 > length) {
+      return null;
+    }
+    for (int k = 1; k < run; k++) {
+      out[n++] = frame[in++];
+    }
+    if (run != 0xFF && in < length) {
+      out[n++] = 0;
+    }
+  }
+  byte result[] = new byte[n];
+  arrayCopy(out, result, n);
+  return result;
+}
+
+// CRC-16/CCITT-FALSE.
+int crc16(byte[] data, int length) {
+  int crc = 0xFFFF;
+  for (int k = 0; k < length; k++) {
+    crc ^= (data[k] & 0xFF) << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = ((crc & 0x8000) != 0) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+    }
+    crc &= 0xFFFF;
   }
+  return crc;
+}
+
+int get2bytes(byte[] data, int offset) {
+  return (data[offset] & 0xFF) | ((data[offset + 1] & 0xFF) << 8);
 }
 
 float get4bytesFloat(byte[] data, int offset) {
-//  println("bit4: " + hex(data[offset+3]) );
-  String hexint = hex(data[offset+3])+hex(data[offset+2])+hex(data[offset+1])+hex(data[offset]);
-  println("unhexed: " + unhex(hexint) );
-  return Float.intBitsToFloat(unhex(hexint));
+  int bits = (data[offset] & 0xFF) | ((data[offset + 1] & 0xFF) << 8) |
+             ((data[offset + 2] & 0xFF) << 16) | ((data[offset + 3] & 0xFF) << 24);
+  return Float.intBitsToFloat(bits);
 }
@@ -4,14 +4,29 @@
  * Calculate the roll, pitch and yaw angles.
  */
 #include "MARGfilter.h"
+#include "MahonyFilter.h"
 #include "ADXL345.h"
 #include "ITG3200.h"
 #include "HMC5843.h"
+#include "SensorMounting.h"
+#include "SensorBuses.h"
+#include "CicDecimator.h"
+#include "SensorArray.h"
+#include "HardIronFit.h"
+#include "SensorChannel.h"
+#include "TelemetryScheduler.h"
+#include "SerialQueue.h"
+#include "I2CQueue.h"
+#include "Profiler.h"
+#include "JobMonitor.h"
+#include "EventScheduler.h"
+#include "RamFunction.h"
 
 //Gravity at Earth's surface in m/s/s
 #define g0 9.812865328
-//Number of samples to average.
-#define SAMPLES 4
+//Decimation ratio and order of the CIC filter on the raw samples.
+#define DECIMATION_RATIO 4
+#define DECIMATION_ORDER 2
 //Number of samples to be averaged for a null bias calculation
 //during calibration.
 #define CALIBRATION_SAMPLES 128
@@ -21,8 +36,8 @@
 #define toRadians(x) (x * 0.01745329252)
 //ITG-3200 sensitivity is 14.375 LSB/(degrees/sec).
 #define GYROSCOPE_GAIN (1 / 14.375)
-//Full scale resolution on the ADXL345 is 4mg/LSB.
-#define ACCELEROMETER_GAIN (0.004 * g0)
+//Full resolution on the ADXL345 is 256 LSB/g, i.e. 3.9mg/LSB.
+#define ACCELEROMETER_GAIN (g0 / 256)
 //Note: Not sure what the gain for the magnetometer should be. :(
 #define MAGNETOMETER_GAIN 1.0
 //Sampling gyroscope at 200Hz.
@@ -31,249 +46,435 @@
 #define ACC_RATE    0.005
 //Sampling magnetometer at 10Hz.
 #define MAG_RATE    0.1
-//Updating filter at 40Hz.
+//Refit the magnetometer's hard iron bias every 50 readings, i.e. 5s.
+#define MAGNETOMETER_FIT_INTERVAL 50
+//The IMUs of the array are read in turn, so their Tickers run IMU_COUNT
+//times as fast; each IMU is still read at the rates above.
+#define ACC_READ_RATE  (ACC_RATE / IMU_COUNT)
+#define GYRO_READ_RATE (GYRO_RATE / IMU_COUNT)
+//Updating filter at 10Hz.
 #define FILTER_RATE 0.1
-
-Serial pc(USBTX, USBRX);
+//Adaptive filter gain right after start-up, annealing over ~2 seconds.
+#define ADAPTIVE_INITIAL_GAIN   2.5
+#define ADAPTIVE_ANNEALING_TIME 2.0
+//Telemetry link speed.
+#define TELEMETRY_BAUD 921600
+//Telemetry streams are scheduled at 200Hz.
+#define TELEMETRY_RATE     0.005
+#define TELEMETRY_TICK_HZ  200
+//Ticks between filter updates: the quaternion is sent once per estimate.
+#define TELEMETRY_FILTER_DIVIDER ((int) (FILTER_RATE / TELEMETRY_RATE + 0.5))
+//Event priorities, higher first: a filter update is never held up by
+//telemetry. Calibration runs before any event is posted; refitting the
+//magnetometer's bias can wait behind everything else.
+#define FILTER_PRIORITY           2
+#define TELEMETRY_PRIORITY        1
+#define MAGNETOMETER_FIT_PRIORITY 0
+//Mahony filter gains, used when built with -DMAHONY_FILTER.
+#define MAHONY_KP 0.5
+#define MAHONY_KI 0.01
+
+//Seconds to microseconds, for the job monitor.
+#define toMicroseconds(x) ((uint32_t) (x * 1000000))
+
+//Periodic jobs watched by the job monitor, in the order they are added.
+//Each IMU of the array has a job per sensor, JOB_ACCELEROMETER + member
+//and JOB_GYROSCOPE + member: the reads of the members overlap on the bus.
+enum {
+    JOB_ACCELEROMETER,
+    JOB_GYROSCOPE    = JOB_ACCELEROMETER + IMU_COUNT,
+    JOB_MAGNETOMETER = JOB_GYROSCOPE + IMU_COUNT,
+    JOB_FILTER,
+    JOB_TELEMETRY
+};
+
+//Events dispatched by the scheduler, in the order they are added.
+enum {
+    EVENT_FILTER,
+    EVENT_TELEMETRY,
+    EVENT_MAGNETOMETER_FIT
+};
+
+//Profiling zones, compiled in with make PROFILE=1, see Profiler.h.
+enum {
+    //Queuing the reads; the transfers show in the sensor jobs' durations.
+    ZONE_ACCELEROMETER_READ,
+    ZONE_GYROSCOPE_READ,
+    ZONE_MAGNETOMETER_READ,
+    //Combining the IMUs, decimation and bias correction of all three sensors.
+    ZONE_ACCUMULATE,
+    ZONE_FILTER_UPDATE,
+    ZONE_EULER,
+    //Encoding and queuing the telemetry frame.
+    ZONE_TELEMETRY
+};
+
+//Telemetry is queued and sent from the UART interrupt, so sending a frame
+//never blocks the main loop.
+SerialQueue pc(USBTX, USBRX);
+//The orientation engine is chosen at compile time; engines share the
+//OrientationEngine interface so there is no virtual dispatch.
+#ifdef MAHONY_FILTER
+typedef MahonyFilter OrientationFilter;
+OrientationFilter margFilter(FILTER_RATE, MAHONY_KP, MAHONY_KI);
+#else
+typedef MARGfilter OrientationFilter;
 //At rest the gyroscope is centred around 0 and goes between about
 //-5 and 5 counts. As 1 degrees/sec is ~15 LSB, error is roughly
 //5/15 = 0.3 degrees/sec.
-MARGfilter margFilter(FILTER_RATE, 0.3, 0.0 /* What's the gyro drift?*/);
-// p28 = sda (data pin), p27 = scl (clock pin)
-ADXL345 accelerometer(p28, p27);
-ITG3200 gyroscope(p28, p27);
-HMC5843 magnetometer(p28, p27);
+OrientationFilter margFilter(FILTER_RATE, 0.3, 0.0 /* What's the gyro drift?*/);
+#endif
+//The drivers read and write with blocking transfers, for set-up and
+//calibration, on the buses SensorBuses.h puts them on. The IMUs of the
+//array are created when they are initialized.
+ADXL345* accelerometers[IMU_COUNT];
+ITG3200* gyroscopes[IMU_COUNT];
+HMC5843 magnetometer(SENSOR_BUS_SDA(MAGNETOMETER_BUS), SENSOR_BUS_SCL(MAGNETOMETER_BUS));
 Ticker accelerometerTicker;
 Ticker gyroscopeTicker;
 Ticker magnetometerTicker;
 Ticker filterTicker;
-
-//Offsets for the gyroscope.
-//The readings we take when the gyroscope is stationary won't be 0, so we'll
-//average a set of readings we do get when the gyroscope is stationary and
-//take those away from subsequent readings to ensure the gyroscope is offset
-//or "biased" to 0.
-double w_xBias;
-double w_yBias;
-double w_zBias;
-
-//Offsets for the accelerometer.
-//Same as with the gyroscope.
-double a_xBias;
-double a_yBias;
-double a_zBias;
-
-//Offsets for the magnetometer.
-//Same as with the gyroscope.
-double m_xBias;
-double m_yBias;
-double m_zBias;
-
-//Accumulators used for oversampling and then averaging.
-volatile double a_xAccumulator = 0;
-volatile double a_yAccumulator = 0;
-volatile double a_zAccumulator = 0;
-
-volatile double w_xAccumulator = 0;
-volatile double w_yAccumulator = 0;
-volatile double w_zAccumulator = 0;
-
-volatile double m_xAccumulator = 0;
-volatile double m_yAccumulator = 0;
-volatile double m_zAccumulator = 0;
-
-//Accelerometer, gyroscope and magnetometer readings for x, y, z axes.
-volatile double a_x;
-volatile double a_y;
-volatile double a_z;
-volatile double w_x;
-volatile double w_y;
-volatile double w_z;
-volatile double m_x;
-volatile double m_y;
-volatile double m_z;
-
-//Buffer for accelerometer readings.
+//Time since start-up, for the telemetry timestamps.
+Timer uptime;
+Ticker telemetryTicker;
+//Number of filter updates since start-up.
+volatile uint32_t filterUpdates = 0;
+//Start times, lateness and overruns of the Ticker callbacks.
+uint32_t uptimeMicroseconds(void);
+JobMonitor jobs(uptimeMicroseconds);
+//The sensor Tickers queue a read on the sensor's bus, and the reading is
+//decimated in the bus's interrupt when the read completes; the filter
+//and telemetry Tickers only post an event, and the handlers run in thread
+//context by priority, sleeping in between. Data the interrupts update is
+//read with them masked.
+EventScheduler events(uptimeMicroseconds);
+//Each bus runs its reads by itself, so a read on one never waits for a
+//read on the other.
+I2CQueue sensorBus0(SENSOR_BUS0_SDA, SENSOR_BUS0_SCL, uptimeMicroseconds);
+#if SENSOR_BUSES > 1
+I2CQueue sensorBus1(SENSOR_BUS1_SDA, SENSOR_BUS1_SCL, uptimeMicroseconds);
+I2CQueue* const sensorBuses[SENSOR_BUSES] = {&sensorBus0, &sensorBus1};
+#else
+I2CQueue* const sensorBuses[SENSOR_BUSES] = {&sensorBus0};
+#endif
+
+//Buffer for raw sensor readings.
 int readings[3];
-//Number of accelerometer samples we're on.
-int accelerometerSamples = 0;
-//Number of gyroscope samples we're on.
-int gyroscopeSamples = 0;
-//Number of magnetometer samples we're on.
-int magnetometerSamples = 0;
+
+//Each sensor is remapped into the board frame, decimated by a CIC filter and
+//bias corrected in integer counts; the output is converted to the filter's
+//scalar type once, with the gain, unit conversion and decimator gain folded
+//into one scale factor. That is single precision on cores with a single
+//precision FPU, see MARGfilter.h.
+typedef CicDecimator<DECIMATION_RATIO, DECIMATION_ORDER> SampleDecimator;
+//The magnetometer is read at the filter rate already; decimating it as
+//well would lag its field behind the gyroscope by about half a second.
+typedef CicDecimator<1, 1> MagnetometerDecimator;
+//The IMUs' readings are averaged, or voted on with -DIMU_ARRAY_MEDIAN
+//(make IMU_VOTE=1), before they go into the channels.
+#ifdef IMU_ARRAY_MEDIAN
+typedef ArrayMedian ArrayCombiner;
+#else
+typedef ArrayMean ArrayCombiner;
+#endif
+SensorArray<IMU_COUNT, ArrayCombiner> accelerometerArray;
+SensorArray<IMU_COUNT, ArrayCombiner> gyroscopeArray;
+//Acceleration in m/s/s.
+SensorChannel<AccelerometerAxes, SampleDecimator, MARGreal> accelerometerChannel(ACCELEROMETER_GAIN);
+//Angular velocity in rad/s.
+SensorChannel<GyroscopeAxes, SampleDecimator, MARGreal> gyroscopeChannel(toRadians(GYROSCOPE_GAIN));
+SensorChannel<MagnetometerAxes, MagnetometerDecimator, MARGreal> magnetometerChannel(MAGNETOMETER_GAIN);
+//The magnetometer's hard iron bias, fitted as the board turns; a null
+//bias taken at rest would take the earth's field out with it.
+HardIronFit magnetometerFit;
+
+//Expected readings while calibrating; at 256 LSB/g, 256 LSBs is 1g.
+const int accelerometerAtRest[3] = {0, 0, 256};
 
 /**
  * Prototypes
  */
-//Set up the ADXL345 appropriately.
+//The sensor callbacks and filter() are RAMFUNC: with make RAMFUNC=1 they
+//run from SRAM along with the conditioning and filter code inlined into
+//them, see RamFunction.h.
+//Set up the ADXL345s appropriately.
 void initializeAcceleromter(void);
-//Calculate the null bias.
+//Read every ADXL345 with blocking transfers.
+void readAccelerometers(void);
+//Calculate the null bias, aligning the ADXL345s.
 void calibrateAccelerometer(void);
-//Take a set of samples and average them.
+//Queue a sample from the next ADXL345.
 void sampleAccelerometer(void);
+//Combine and decimate the samples once the last one has been read.
+void accelerometerReadDone(I2CTransaction* transaction);
 
-//Set up the ITG3200 appropriately.
+//Set up the ITG3200s appropriately.
 void initializeGyroscope(void);
-//Calculate the null bias.
+//Read every ITG3200 with blocking transfers.
+void readGyroscopes(void);
+//Calculate the null bias, aligning the ITG3200s.
 void calibrateGyroscope(void);
-//Take a set of samples and average them.
+//Queue a sample from the next ITG3200.
 void sampleGyroscope(void);
+//Combine and decimate the samples once the last one has been read.
+void gyroscopeReadDone(I2CTransaction* transaction);
 
 //Set up the HMC5843 appropriately.
 void initializeMagnetometer(void);
-//Calculate the null bias.
-void calibrateMagnetometer(void);
-//Take a set of samples and average them.
+//Queue a sample.
 void sampleMagnetometer(void);
+//Condition the sample once it has been read and add it to the fit.
+void magnetometerReadDone(I2CTransaction* transaction);
+//Refit the hard iron bias from the readings so far.
+void fitMagnetometer(void);
 
 //Update the filter and calculate the Euler angles.
 void filter(void);
 
+//Telemetry stream producers.
+bool sendQuaternion(TelemetryEncoder& encoder);
+bool sendEuler(TelemetryEncoder& encoder);
+bool sendRawSensors(TelemetryEncoder& encoder);
+bool sendDiagnostics(TelemetryEncoder& encoder);
+bool sendStreamStatistics(TelemetryEncoder& encoder);
+bool sendJob(TelemetryEncoder& encoder);
+bool sendEvents(TelemetryEncoder& encoder);
+bool sendBus(TelemetryEncoder& encoder);
+#ifdef PROFILING
+bool sendProfile(TelemetryEncoder& encoder);
+#endif
+//Queue a finished frame on the serial port.
+bool sendFrame(const uint8_t* frame, int length);
+//Send the telemetry streams that are due.
+void sendTelemetry(void);
+
+//Ticker callbacks posting the filter and telemetry events.
+void postFilter(void);
+void postTelemetry(void);
+
+//Raw sensors for logging at 200Hz, quaternions for control at the filter
+//rate, Euler angles for imu_cube at 10Hz, diagnostics, scheduler events and
+//stream statistics at 1Hz. Under bandwidth pressure the raw stream goes first.
+TelemetryScheduler telemetry(TELEMETRY_TICK_HZ, sendFrame);
+
+//The burst reads getOutputWithSource(), getGyroOutput() and readData()
+//make, queued instead; each sensor has one read in flight at most. The
+//IMUs' reads are filled in when they are initialized.
+const char accelerometerRegister = ADXL345_INT_SOURCE_REG;
+char accelerometerData[IMU_COUNT][ADXL345_OUTPUT_WITH_SOURCE_SIZE];
+I2CTransaction accelerometerReads[IMU_COUNT];
+const char gyroscopeRegister = INT_STATUS;
+char gyroscopeData[IMU_COUNT][ITG3200_GYRO_OUTPUT_SIZE];
+I2CTransaction gyroscopeReads[IMU_COUNT];
+const char magnetometerRegister = HMC5843_X_MSB;
+char magnetometerData[HMC5843_DATA_SIZE];
+I2CTransaction magnetometerRead = {HMC5843_I2C_WRITE, &magnetometerRegister, 1,
+                                   magnetometerData, HMC5843_DATA_SIZE, magnetometerReadDone,
+                                   0, false, 0};
+
 void initializeAccelerometer(void) {
 
-    //Go into standby mode to configure the device.
-    accelerometer.setPowerControl(0x00);
-    //Full resolution, +/-16g, 4mg/LSB.
-    accelerometer.setDataFormatControl(0x0B);
-    //200Hz data rate.
-    accelerometer.setDataRate(ADXL345_200HZ);
-    //Measurement mode.
-    accelerometer.setPowerControl(0x08);
+    for (int k = 0; k < IMU_COUNT; k++) {
+
+        ADXL345* accelerometer = new ADXL345(SENSOR_BUS_SDA(IMU_ACCELEROMETER_BUS(k)), SENSOR_BUS_SCL(IMU_ACCELEROMETER_BUS(k)),
+                                             IMU_ALTERNATE(k) ? ADXL345_ALT_ADDRESS : ADXL345_ADDRESS);
+        accelerometers[k] = accelerometer;
+
+        //Go into standby mode to configure the device.
+        accelerometer->setPowerControl(0x00);
+        //Full resolution, +/-16g, 4mg/LSB.
+        accelerometer->setDataFormatControl(0x0B);
+        //200Hz data rate.
+        accelerometer->setDataRate(ADXL345_200HZ);
+        //Measurement mode.
+        accelerometer->setPowerControl(0x08);
+
+        I2CTransaction& read = accelerometerReads[k];
+        read.address = accelerometer->getAddress();
+        read.tx = &accelerometerRegister;
+        read.txLength = 1;
+        read.rx = accelerometerData[k];
+        read.rxLength = ADXL345_OUTPUT_WITH_SOURCE_SIZE;
+        read.done = accelerometerReadDone;
+
+    }
+
     //See http://www.analog.com/static/imported-files/application_notes/AN-1077.pdf
     wait_ms(22);
 
 }
 
-void sampleAccelerometer(void) {
+RAMFUNC void sampleAccelerometer(void) {
 
-    //Have we taken enough samples?
-    if (accelerometerSamples == SAMPLES) {
+    //Take another sample from the next IMU in turn; the job runs until the
+    //read completes.
+    static int member = 0;
+    I2CTransaction* read = &accelerometerReads[member];
+    bool queued;
 
-        //Average the samples, remove the bias, and calculate the acceleration
-        //in m/s/s.
-        a_x = ((a_xAccumulator / SAMPLES) - a_xBias) * ACCELEROMETER_GAIN;
-        a_y = ((a_yAccumulator / SAMPLES) - a_yBias) * ACCELEROMETER_GAIN;
-        a_z = ((a_zAccumulator / SAMPLES) - a_zBias) * ACCELEROMETER_GAIN;
+    jobs.start(JOB_ACCELEROMETER + member);
+    {
+        PROFILE_SCOPE(ZONE_ACCELEROMETER_READ);
+        queued = sensorBuses[IMU_ACCELEROMETER_BUS(member)]->submit(read);
+    }
+    //Not queued behind the previous read, so no completion is coming.
+    if (!queued && !read->queued) {
+        jobs.finish(JOB_ACCELEROMETER + member);
+    }
+    member = (member + 1) % IMU_COUNT;
 
-        a_xAccumulator = 0;
-        a_yAccumulator = 0;
-        a_zAccumulator = 0;
-        accelerometerSamples = 0;
+}
 
-    } else {
-        //Take another sample.
-        accelerometer.getOutput(readings);
+RAMFUNC void accelerometerReadDone(I2CTransaction* transaction) {
 
-        a_xAccumulator += (int16_t) readings[0];
-        a_yAccumulator += (int16_t) readings[1];
-        a_zAccumulator += (int16_t) readings[2];
+    int member = (int) (transaction - accelerometerReads);
 
-        accelerometerSamples++;
+    if (transaction->status == 0) {
+        char source = ADXL345::decodeOutputWithSource(accelerometerData[member], readings);
+        //DATA_READY.
+        jobs.sample(JOB_ACCELEROMETER + member, (source & 0x80) ? JOB_SAMPLE_NEW : JOB_SAMPLE_STALE);
+        accelerometerArray.add(member, readings);
+    }
+    //The last IMU's read ends the round; every DECIMATION_RATIO rounds a
+    //new acceleration is available.
+    if (member == IMU_COUNT - 1) {
+        PROFILE_SCOPE(ZONE_ACCUMULATE);
+        if (accelerometerArray.combine(readings) > 0) {
+            accelerometerChannel.push(readings);
+        }
     }
+    jobs.finish(JOB_ACCELEROMETER + member);
 
 }
 
-void calibrateAccelerometer(void) {
+void readAccelerometers(void) {
 
-    a_xAccumulator = 0;
-    a_yAccumulator = 0;
-    a_zAccumulator = 0;
+    for (int k = 0; k < IMU_COUNT; k++) {
+        accelerometers[k]->getOutput(readings);
+        accelerometerArray.add(k, readings);
+    }
 
-    //Take a number of readings and average them
-    //to calculate the zero g offset.
-    for (int i = 0; i < CALIBRATION_SAMPLES; i++) {
+}
+
+void calibrateAccelerometer(void) {
 
-        accelerometer.getOutput(readings);
+    //Take a number of readings and average them
+    //to calculate the zero g offset, aligning the IMUs
+    //to each other from the same readings.
+    accelerometerArray.startCalibration();
+    accelerometerChannel.startCalibration();
 
-        a_xAccumulator += (int16_t) readings[0];
-        a_yAccumulator += (int16_t) readings[1];
-        a_zAccumulator += (int16_t) readings[2];
+    for (int i = 0; i < CALIBRATION_SAMPLES; i++) {
 
+        readAccelerometers();
+        accelerometerArray.combine(readings);
+        accelerometerChannel.addCalibrationSample(readings);
         wait(ACC_RATE);
 
     }
 
-    a_xAccumulator /= CALIBRATION_SAMPLES;
-    a_yAccumulator /= CALIBRATION_SAMPLES;
-    a_zAccumulator /= CALIBRATION_SAMPLES;
+    accelerometerArray.finishCalibration();
+    accelerometerChannel.finishCalibration(accelerometerAtRest);
+
+}
+
+void initializeGyroscope(void) {
+
+    for (int k = 0; k < IMU_COUNT; k++) {
+
+        ITG3200* gyroscope = new ITG3200(SENSOR_BUS_SDA(IMU_GYROSCOPE_BUS(k)), SENSOR_BUS_SCL(IMU_GYROSCOPE_BUS(k)),
+                                         IMU_ALTERNATE(k) ? ITG3200_I2C_ALT_ADDRESS : ITG3200_I2C_ADDRESS);
+        gyroscopes[k] = gyroscope;
+
+        //Low pass filter bandwidth of 42Hz.
+        gyroscope->setLpBandwidth(LPFBW_42HZ);
+        //Internal sample rate of 200Hz. (1kHz / 5).
+        gyroscope->setSampleRateDivider(4);
 
-    //At 4mg/LSB, 250 LSBs is 1g.
-    a_xBias = a_xAccumulator;
-    a_yBias = a_yAccumulator;
-    a_zBias = (a_zAccumulator - 250);
+        I2CTransaction& read = gyroscopeReads[k];
+        read.address = gyroscope->getAddress();
+        read.tx = &gyroscopeRegister;
+        read.txLength = 1;
+        read.rx = gyroscopeData[k];
+        read.rxLength = ITG3200_GYRO_OUTPUT_SIZE;
+        read.done = gyroscopeReadDone;
 
-    a_xAccumulator = 0;
-    a_yAccumulator = 0;
-    a_zAccumulator = 0;
+    }
 
 }
 
-void initializeGyroscope(void) {
+void readGyroscopes(void) {
 
-    //Low pass filter bandwidth of 42Hz.
-    gyroscope.setLpBandwidth(LPFBW_42HZ);
-    //Internal sample rate of 200Hz. (1kHz / 5).
-    gyroscope.setSampleRateDivider(4);
+    //One burst per IMU, rather than a read per axis.
+    for (int k = 0; k < IMU_COUNT; k++) {
+        gyroscopes[k]->getGyroOutput(readings);
+        gyroscopeArray.add(k, readings);
+    }
 
 }
 
 void calibrateGyroscope(void) {
 
-    w_xAccumulator = 0;
-    w_yAccumulator = 0;
-    w_zAccumulator = 0;
-
     //Take a number of readings and average them
-    //to calculate the gyroscope bias offset.
+    //to calculate the gyroscope bias offset, aligning the IMUs
+    //to each other from the same readings.
+    gyroscopeArray.startCalibration();
+    gyroscopeChannel.startCalibration();
+
     for (int i = 0; i < CALIBRATION_SAMPLES; i++) {
 
-        w_xAccumulator += gyroscope.getGyroX();
-        w_yAccumulator += gyroscope.getGyroY();
-        w_zAccumulator += gyroscope.getGyroZ();
+        readGyroscopes();
+        gyroscopeArray.combine(readings);
+        gyroscopeChannel.addCalibrationSample(readings);
         wait(GYRO_RATE);
 
     }
 
-    //Average the samples.
-    w_xAccumulator /= CALIBRATION_SAMPLES;
-    w_yAccumulator /= CALIBRATION_SAMPLES;
-    w_zAccumulator /= CALIBRATION_SAMPLES;
-
-    w_xBias = w_xAccumulator;
-    w_yBias = w_yAccumulator;
-    w_zBias = w_zAccumulator;
-
-    w_xAccumulator = 0;
-    w_yAccumulator = 0;
-    w_zAccumulator = 0;
+    gyroscopeArray.finishCalibration();
+    gyroscopeChannel.finishCalibration(0);
 
 }
 
-void sampleGyroscope(void) {
+RAMFUNC void sampleGyroscope(void) {
 
-    //Have we taken enough samples?
-    if (gyroscopeSamples == SAMPLES) {
+    //Take another sample from the next IMU in turn; the job runs until the
+    //read completes.
+    static int member = 0;
+    I2CTransaction* read = &gyroscopeReads[member];
+    bool queued;
 
-        //Average the samples, remove the bias, and calculate the angular
-        //velocity in rad/s.
-        w_x = toRadians(((w_xAccumulator / SAMPLES) - w_xBias) * GYROSCOPE_GAIN);
-        w_y = toRadians(((w_yAccumulator / SAMPLES) - w_yBias) * GYROSCOPE_GAIN);
-        w_z = toRadians(((w_zAccumulator / SAMPLES) - w_zBias) * GYROSCOPE_GAIN);
+    jobs.start(JOB_GYROSCOPE + member);
+    {
+        PROFILE_SCOPE(ZONE_GYROSCOPE_READ);
+        queued = sensorBuses[IMU_GYROSCOPE_BUS(member)]->submit(read);
+    }
+    //Not queued behind the previous read, so no completion is coming.
+    if (!queued && !read->queued) {
+        jobs.finish(JOB_GYROSCOPE + member);
+    }
+    member = (member + 1) % IMU_COUNT;
 
-        w_xAccumulator = 0;
-        w_yAccumulator = 0;
-        w_zAccumulator = 0;
-        gyroscopeSamples = 0;
+}
 
-    } else {
-        //Take another sample.
-        w_xAccumulator += gyroscope.getGyroX();
-        w_yAccumulator += gyroscope.getGyroY();
-        w_zAccumulator += gyroscope.getGyroZ();
+RAMFUNC void gyroscopeReadDone(I2CTransaction* transaction) {
 
-        gyroscopeSamples++;
+    int member = (int) (transaction - gyroscopeReads);
 
+    if (transaction->status == 0) {
+        char status = ITG3200::decodeGyroOutput(gyroscopeData[member], readings);
+        //RAW_DATA_RDY.
+        jobs.sample(JOB_GYROSCOPE + member, (status & 0x01) ? JOB_SAMPLE_NEW : JOB_SAMPLE_STALE);
+        gyroscopeArray.add(member, readings);
+    }
+    //The last IMU's read ends the round; every DECIMATION_RATIO rounds a
+    //new angular velocity is available.
+    if (member == IMU_COUNT - 1) {
+        PROFILE_SCOPE(ZONE_ACCUMULATE);
+        if (gyroscopeArray.combine(readings) > 0) {
+            gyroscopeChannel.push(readings);
+        }
     }
+    jobs.finish(JOB_GYROSCOPE + member);
 
 }
 
@@ -284,83 +485,341 @@ void initializeMagnetometer(void) {
   wait_ms(10);
 }
 
-void calibrateMagnetometer(void) {
-  m_xAccumulator = 0;
-  m_yAccumulator = 0;
-  m_zAccumulator = 0;
-
-  //Take a number of readings and average them
-  //to calculate the gyroscope bias offset.
-  for (int i = 0; i < 20/*2 seconds at 10Hz*/; i++) {
+RAMFUNC void sampleMagnetometer(void) {
+  //Take another sample; the job runs until the read completes.
+  bool queued;
 
-      magnetometer.readData(readings);
-      m_xAccumulator += (int16_t) readings[0];
-      m_yAccumulator += (int16_t) readings[1];
-      m_zAccumulator += (int16_t) readings[2];
-      wait(MAG_RATE);
+  jobs.start(JOB_MAGNETOMETER);
+  {
+      PROFILE_SCOPE(ZONE_MAGNETOMETER_READ);
+      queued = sensorBuses[MAGNETOMETER_BUS]->submit(&magnetometerRead);
+  }
+  //Not queued behind the previous read, so no completion is coming.
+  if (!queued && !magnetometerRead.queued) {
+      jobs.finish(JOB_MAGNETOMETER);
+  }
+}
 
+RAMFUNC void magnetometerReadDone(I2CTransaction* transaction) {
+  if (transaction->status == 0) {
+      HMC5843::decodeData(magnetometerData, readings);
+      //Reading the status as well would cost another transfer.
+      jobs.sample(JOB_MAGNETOMETER);
+      PROFILE_SCOPE(ZONE_ACCUMULATE);
+      magnetometerChannel.push(readings);
+      //Only the sums are kept here; solving waits for the main loop.
+      int16_t counts[3];
+      magnetometerChannel.getCounts(counts);
+      magnetometerFit.add(counts);
+      if (magnetometerFit.getSamples() % MAGNETOMETER_FIT_INTERVAL == 0) {
+          events.post(EVENT_MAGNETOMETER_FIT);
+      }
   }
+  jobs.finish(JOB_MAGNETOMETER);
+}
 
-  //Average the samples.
-  m_xAccumulator /= CALIBRATION_SAMPLES;
-  m_yAccumulator /= CALIBRATION_SAMPLES;
-  m_zAccumulator /= CALIBRATION_SAMPLES;
+void fitMagnetometer(void) {
 
-  m_xBias = m_xAccumulator;
-  m_yBias = m_yAccumulator;
-  m_zBias = m_zAccumulator;
+    HardIronFit fit;
+    double bias[3];
+    double radius;
 
-  m_xAccumulator = 0;
-  m_yAccumulator = 0;
-  m_zAccumulator = 0;
-}
+    //Solve a copy, so readings keep coming in meanwhile.
+    __disable_irq();
+    fit = magnetometerFit;
+    __enable_irq();
+
+    //Until the board has turned far enough the bias stays as it was.
+    if (fit.solve(bias, &radius)) {
+        __disable_irq();
+        magnetometerChannel.setBias(bias);
+        __enable_irq();
+    }
 
-void sampleMagnetometer(void) {
-  //Have we taken enough samples?
-  if (magnetometerSamples == SAMPLES) {
-
-      //Average the samples, remove the bias, and calculate the values
-      //in m/s/s.
-      m_x = ((m_xAccumulator / SAMPLES) - m_xBias) * MAGNETOMETER_GAIN;
-      m_y = ((m_yAccumulator / SAMPLES) - m_yBias) * MAGNETOMETER_GAIN;
-      m_z = ((m_zAccumulator / SAMPLES) - m_zBias) * MAGNETOMETER_GAIN;
-
-      m_xAccumulator = 0;
-      m_yAccumulator = 0;
-      m_zAccumulator = 0;
-      magnetometerSamples = 0;
-
-  } else {
-      //Take another sample.
-      magnetometer.readData(readings);
-      m_xAccumulator += (int16_t) readings[0];
-      m_yAccumulator += (int16_t) readings[1];
-      m_zAccumulator += (int16_t) readings[2];
-
-      magnetometerSamples++;
-  }
 }
 
-void filter(void) {
+RAMFUNC void filter(void) {
+
+    MARGreal w[3];
+    MARGreal a[3];
+    MARGreal m[3];
+
+    jobs.start(JOB_FILTER);
+
+    //Readings are already in the board frame, see SensorMounting.h.
+    __disable_irq();
+    gyroscopeChannel.getOutput(w);
+    accelerometerChannel.getOutput(a);
+    magnetometerChannel.getOutput(m);
+    __enable_irq();
 
     //Update the filter variables.
-    margFilter.updateFilter(w_y, w_x, w_z, a_y, a_x, a_z, m_y, m_x, m_z);
+    {
+        PROFILE_SCOPE(ZONE_FILTER_UPDATE);
+        margFilter.update(w[0], w[1], w[2], a[0], a[1], a[2], m[0], m[1], m[2]);
+    }
     //Calculate the new Euler angles.
-    margFilter.computeEuler();
+    {
+        PROFILE_SCOPE(ZONE_EULER);
+        margFilter.computeEuler();
+    }
+    filterUpdates++;
+
+    jobs.finish(JOB_FILTER);
+
 }
 
-typedef union _data {
-  float f;
-  char  s[4];
-} floatBytes;
+bool sendQuaternion(TelemetryEncoder& encoder) {
+
+    float quaternion[4];
+
+    margFilter.getQuaternion(quaternion);
+
+    return encoder.addQuaternion(quaternion);
+
+}
+
+bool sendEuler(TelemetryEncoder& encoder) {
+
+    return encoder.addEuler((float) margFilter.getRoll(), (float) margFilter.getPitch(), (float) margFilter.getYaw());
+
+}
+
+bool sendRawSensors(TelemetryEncoder& encoder) {
+
+    int16_t a[3];
+    int16_t w[3];
+    int16_t m[3];
+
+    __disable_irq();
+    accelerometerChannel.getCounts(a);
+    gyroscopeChannel.getCounts(w);
+    magnetometerChannel.getCounts(m);
+    __enable_irq();
+
+    return encoder.addRawSensors(a, w, m);
+
+}
+
+bool sendDiagnostics(TelemetryEncoder& encoder) {
+
+    TelemetryDiagnostics diagnostics;
+    double bias[3];
+
+    margFilter.getGyroBias(bias);
+#ifdef MAHONY_FILTER
+    diagnostics.gain = MAHONY_KP;
+#else
+    diagnostics.gain = (float) margFilter.getBeta();
+#endif
+    diagnostics.gyroBias[0] = (float) bias[0];
+    diagnostics.gyroBias[1] = (float) bias[1];
+    diagnostics.gyroBias[2] = (float) bias[2];
+    diagnostics.updates = filterUpdates;
 
-floatBytes roll;
-floatBytes pitch;
-floatBytes yaw;
+    return encoder.addDiagnostics(diagnostics);
+
+}
+
+bool sendStreamStatistics(TelemetryEncoder& encoder) {
+
+    return telemetry.addStatistics(encoder);
+
+}
+
+bool sendJob(TelemetryEncoder& encoder) {
+
+    //One job per record, in turn.
+    static int job = 0;
+    JobStatistics statistics;
+    TelemetryJob record;
+
+    //Taking the statistics clears the window, so only take them if the
+    //record will fit.
+    if (encoder.space() < TELEMETRY_RECORD_HEADER_SIZE + TELEMETRY_JOB_SIZE) {
+        return false;
+    }
+    __disable_irq();
+    bool valid = jobs.getStatistics(job, &statistics);
+    __enable_irq();
+    if (!valid) {
+        job = 0;
+        return true;
+    }
+
+    record.job = (uint8_t) job;
+    record.period = statistics.period;
+    record.runs = statistics.runs;
+    record.skipped = statistics.skipped;
+    record.overruns = statistics.overruns;
+    record.duplicates = statistics.duplicates;
+    record.lost = statistics.lost;
+    record.maxLateness = statistics.maxLateness;
+    record.maxDuration = statistics.maxDuration;
+    for (int i = 0; i < TELEMETRY_JOB_BINS; i++) {
+        record.lateness[i] = statistics.lateness[i];
+    }
+    job = (job + 1) % jobs.getJobs();
+
+    return encoder.addJob(record);
+
+}
+
+bool sendEvents(TelemetryEncoder& encoder) {
+
+    TelemetryEventStatistics records[TELEMETRY_MAX_EVENTS];
+    EventStatistics statistics;
+    uint32_t idle;
+    uint32_t elapsed;
+    int count = events.getEvents();
+
+    //Taking the statistics clears the maximum latencies, so only take
+    //them if the record will fit.
+    if (encoder.space() < TELEMETRY_RECORD_HEADER_SIZE + TELEMETRY_EVENTS_HEADER_SIZE + count * TELEMETRY_EVENTS_ENTRY_SIZE) {
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        events.getStatistics(i, &statistics);
+        records[i].event = (uint8_t) i;
+        records[i].priority = statistics.priority;
+        records[i].dispatched = statistics.dispatched;
+        records[i].coalesced = statistics.coalesced;
+        records[i].maxLatency = statistics.maxLatency;
+    }
+    events.getIdle(&idle, &elapsed);
+
+    return encoder.addEvents(idle, elapsed, records, count);
+
+}
+
+bool sendBus(TelemetryEncoder& encoder) {
+
+    //One bus per record, in turn.
+    static int bus = 0;
+    I2CQueueStatistics statistics;
+    TelemetryBus record;
+
+    //Taking the statistics clears the maxima, so only take them if the
+    //record will fit.
+    if (encoder.space() < TELEMETRY_RECORD_HEADER_SIZE + TELEMETRY_BUS_SIZE) {
+        return false;
+    }
+    __disable_irq();
+    sensorBuses[bus]->getStatistics(&statistics);
+    __enable_irq();
+
+    record.bus = (uint8_t) bus;
+    record.transactions = statistics.transactions;
+    record.errors = statistics.errors;
+    record.rejected = statistics.rejected;
+    record.maxQueued = statistics.maxQueued;
+    record.maxWait = statistics.maxWait;
+    record.maxDuration = statistics.maxDuration;
+    record.busy = statistics.busy;
+    record.elapsed = statistics.elapsed;
+    bus = (bus + 1) % SENSOR_BUSES;
+
+    return encoder.addBus(record);
+
+}
+
+#ifdef PROFILING
+bool sendProfile(TelemetryEncoder& encoder) {
+
+    //One zone per record, in turn.
+    static int zone = 0;
+    ProfileZone window;
+    TelemetryProfile profile;
+
+    //Taking a zone clears it, so only take it if the record will fit.
+    if (encoder.space() < TELEMETRY_RECORD_HEADER_SIZE + TELEMETRY_PROFILE_SIZE) {
+        return false;
+    }
+    if (zone >= profilerZones()) {
+        zone = 0;
+    }
+    __disable_irq();
+    bool taken = profilerTake(zone, &window);
+    __enable_irq();
+    if (!taken) {
+        zone++;
+        return true;
+    }
+
+    profile.zone = (uint8_t) zone;
+    size_t length = strlen(window.name);
+    memset(profile.name, 0, TELEMETRY_PROFILE_NAME_SIZE);
+    memcpy(profile.name, window.name, length < TELEMETRY_PROFILE_NAME_SIZE ? length : TELEMETRY_PROFILE_NAME_SIZE);
+    profile.tickRate = profilerTickRate();
+    profile.count = window.count;
+    profile.min = window.count ? window.min : 0;
+    profile.max = window.max;
+    profile.mean = window.count ? (uint32_t) (window.total / window.count) : 0;
+    for (int i = 0; i < TELEMETRY_PROFILE_BINS; i++) {
+        profile.histogram[i] = window.histogram[i];
+    }
+    zone++;
+
+    return encoder.addProfile(profile);
+
+}
+#endif
+
+bool sendFrame(const uint8_t* frame, int length) {
+
+    //A full queue drops the frame; the sequence number tells the host.
+    return pc.enqueue(frame, length);
+
+}
+
+void sendTelemetry(void) {
+
+    jobs.start(JOB_TELEMETRY);
+    {
+        PROFILE_SCOPE(ZONE_TELEMETRY);
+        telemetry.tick(uptime.read_us());
+    }
+    jobs.finish(JOB_TELEMETRY);
+
+}
+
+void postFilter(void) {
+
+    events.post(EVENT_FILTER);
+
+}
+
+void postTelemetry(void) {
+
+    events.post(EVENT_TELEMETRY);
+
+}
+
+uint32_t uptimeMicroseconds(void) {
+
+    return uptime.read_us();
+
+}
 
 int main() {
 
+#ifdef PROFILING
+    profilerInit();
+    profilerName(ZONE_ACCELEROMETER_READ, "acc_i2c");
+    profilerName(ZONE_GYROSCOPE_READ, "gyro_i2c");
+    profilerName(ZONE_MAGNETOMETER_READ, "mag_i2c");
+    profilerName(ZONE_ACCUMULATE, "accum");
+    profilerName(ZONE_FILTER_UPDATE, "filter");
+    profilerName(ZONE_EULER, "euler");
+    profilerName(ZONE_TELEMETRY, "telem");
+#endif
+
+    pc.baud(TELEMETRY_BAUD);
     pc.printf("Starting MARG filter test...\n");
+    //End the banner with a delimiter so the first frame decodes cleanly.
+    pc.putc(TELEMETRY_DELIMITER);
+    uptime.start();
 
     //Initialize inertial sensors.
     initializeAccelerometer();
@@ -370,32 +829,65 @@ int main() {
     calibrateGyroscope();
 
     initializeMagnetometer();
-    calibrateMagnetometer();
 
-    //Set up timers.
-    //Accelerometer data rate is 200Hz, so we'll sample at this speed.
-    accelerometerTicker.attach(&sampleAccelerometer, ACC_RATE);
+    //Converge quickly from the initial attitude and reject readings taken
+    //under linear acceleration or magnetic disturbances.
+#ifndef MAHONY_FILTER
+    margFilter.setAdaptiveGain(ADAPTIVE_INITIAL_GAIN, ADAPTIVE_ANNEALING_TIME, g0);
+#endif
+
+    //Set up timers, each with its job in the job monitor. A sensor job
+    //lasts from queuing the read to decimating the sample, so its
+    //duration is the sample's latency, waiting for the bus included.
+    //Accelerometer data rate is 200Hz, so we'll sample at this speed; with
+    //an array each read is of the next IMU, so each IMU's job runs at the
+    //data rate.
+    for (int k = 0; k < IMU_COUNT; k++) {
+        jobs.addJob(toMicroseconds(ACC_RATE), toMicroseconds(ACC_RATE));
+    }
+    accelerometerTicker.attach(&sampleAccelerometer, ACC_READ_RATE);
     //Gyroscope data rate is 200Hz, so we'll sample at this speed.
-    gyroscopeTicker.attach(&sampleGyroscope, GYRO_RATE);
+    for (int k = 0; k < IMU_COUNT; k++) {
+        jobs.addJob(toMicroseconds(GYRO_RATE), toMicroseconds(GYRO_RATE));
+    }
+    gyroscopeTicker.attach(&sampleGyroscope, GYRO_READ_RATE);
     //Magnetometer data rate is 10Hz, so we'll sample at this speed.
+    jobs.addJob(toMicroseconds(MAG_RATE), toMicroseconds(MAG_RATE));
     magnetometerTicker.attach(&sampleMagnetometer, MAG_RATE);
     //Update the filter variables at the correct rate.
-    filterTicker.attach(&filter, FILTER_RATE);
-
-    while (1) {
-
-        wait(FILTER_RATE);
-
-        roll.f = (float)toDegrees(margFilter.getRoll());
-        pitch.f = (float)toDegrees(margFilter.getPitch());
-        yaw.f = (float)toDegrees(margFilter.getYaw());
-
-        pc.printf("R%c%c%c%c\t%c%c%c%c\t%c%c%c%c\n",
-          roll.s[0],  roll.s[1],  roll.s[2],  roll.s[3],
-          pitch.s[0], pitch.s[1], pitch.s[2], pitch.s[3],
-          yaw.s[0],   yaw.s[1],   yaw.s[2],   yaw.s[3]
-        );
-
-    }
+    events.addEvent(filter, FILTER_PRIORITY);
+    jobs.addJob(toMicroseconds(FILTER_RATE));
+    filterTicker.attach(&postFilter, FILTER_RATE);
+
+    //Telemetry streams, as dividers of the 200Hz telemetry tick.
+    telemetry.addStream(TELEMETRY_RAW_SENSORS, 1, 1, TELEMETRY_RAW_SENSORS_SIZE, sendRawSensors);
+    //Each new estimate once, the tick after the filter update.
+    telemetry.addStream(TELEMETRY_QUATERNION, TELEMETRY_FILTER_DIVIDER, 4, TELEMETRY_QUATERNION_SIZE, sendQuaternion);
+    telemetry.addStream(TELEMETRY_EULER, 20, 3, TELEMETRY_EULER_SIZE, sendEuler);
+    telemetry.addStream(TELEMETRY_DIAGNOSTICS, 200, 2, TELEMETRY_DIAGNOSTICS_SIZE, sendDiagnostics);
+    //A job every 40 ticks, so each one every 1-2.2s depending on the size of
+    //the array, kept out of the frames of the 1Hz records.
+    telemetry.addStream(TELEMETRY_JOB, 40, 2, TELEMETRY_JOB_SIZE, sendJob, 20);
+#ifdef PROFILING
+    //A zone every 25 ticks, lowest priority: a window that is not sent
+    //keeps accumulating until it is.
+    telemetry.addStream(TELEMETRY_PROFILE, 25, 0, TELEMETRY_PROFILE_SIZE, sendProfile);
+#endif
+    //Idle time and event statistics once a second, half a second after the
+    //other 1Hz records.
+    telemetry.addStream(TELEMETRY_EVENTS, 200, 2, TELEMETRY_EVENTS_HEADER_SIZE + 3 * TELEMETRY_EVENTS_ENTRY_SIZE, sendEvents, 100);
+    //A bus every half second, in turn, between the job records.
+    telemetry.addStream(TELEMETRY_BUS, 100, 2, TELEMETRY_BUS_SIZE, sendBus, 50);
+    telemetry.addStream(TELEMETRY_STREAM_STATISTICS, 200, 2, (telemetry.getStreams() + 1) * TELEMETRY_STREAM_STATISTICS_ENTRY_SIZE, sendStreamStatistics);
+    //8N1, so 10 bits on the line per byte.
+    telemetry.setBandwidth(TELEMETRY_BAUD / 10, SERIAL_QUEUE_SIZE);
+    events.addEvent(sendTelemetry, TELEMETRY_PRIORITY);
+    jobs.addJob(toMicroseconds(TELEMETRY_RATE));
+    telemetryTicker.attach(&postTelemetry, TELEMETRY_RATE);
+    //Posted by the magnetometer's reads.
+    events.addEvent(fitMagnetometer, MAGNETOMETER_FIT_PRIORITY);
+
+    //Dispatch the filter and telemetry, sleeping when there is nothing to do.
+    events.run();
 
 }